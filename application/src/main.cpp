@@ -23,9 +23,14 @@ SOFTWARE.
 
 */
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include "core/include/nes.hpp"
+#include "core/include/movie.hpp"
 
 #include "ppu/include/ppu.hpp"
 #include "input/include/standard_controller.hpp"
@@ -39,40 +44,81 @@ SOFTWARE.
 
 StandardController controller_1;
 
+constexpr unsigned max_run_ahead = 4;
+
 int main(int argc, char* argv[])
 {
-    if (argc < 2)
+    // --record writes the input of the session to a movie, --play runs one back at full speed instead of the keyboard,
+    // --run-ahead shows the frames that many frames ahead (also set with the keys 0 to 4)
+    const char* record_path = nullptr;
+    const char* play_path   = nullptr;
+    unsigned    run_ahead   = 0;
+    bool valid_args = argc >= 2;
+    for (int i { 2 }; valid_args && i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+            valid_args = false;
+        else if (!strcmp(argv[i], "--record"))
+            record_path = argv[i + 1];
+        else if (!strcmp(argv[i], "--play"))
+            play_path = argv[i + 1];
+        else if (!strcmp(argv[i], "--run-ahead"))
+            run_ahead = std::min<unsigned>(atoi(argv[i + 1]), max_run_ahead);
+        else
+            valid_args = false;
+    }
+    if (!valid_args)
     {
-        fprintf(stderr, "usage : <executable> <file.nes>\n");
+        fprintf(stderr, "usage : <executable> <file.nes> [--record movie.nmv | --play movie.nmv] [--run-ahead 0-%u]\n", max_run_ahead);
         return -1;
     }
-    
+
     coroutines_init();
 
-    NES::init();
-    bool result = NES::load_cartridge(argv[1]); // "roms/001/serom.nes"
+    NES::Console nes;
+    nes.init();
+    bool result = nes.load_cartridge(argv[1]); // "roms/001/serom.nes"
     if (!result)
     {
         error("invalid rom\n");
         exit(1);
     }
 
-    NES::input.controller_1 = &controller_1;
+    nes.input.controller_1 = &controller_1;
 
-    if (NES::cart_data.battery_saved_ram)
+    if (nes.cart_data.battery_saved_ram)
     {
-        NES::load_game_battery_save_data();
+        nes.load_game_battery_save_data();
     }
 
-    NES::power_cycle();
+    nes.power_cycle();
+
+    NES::Movie movie;
+    std::unique_ptr<NES::MoviePlayer> player;
+    if (play_path)
+    {
+        if (!movie.load(play_path))
+        {
+            error("invalid movie\n");
+            exit(1);
+        }
+        player = std::make_unique<NES::MoviePlayer>(movie, nes, controller_1);
+        if (player->wrong_game())
+        {
+            error("the movie was recorded on another game\n");
+            exit(1);
+        }
+    }
 
     sf::RenderWindow window(sf::VideoMode(800, 600), "My window");
 
-    sf::Image fb;
-    fb.create(256, 240);
+    // the ppu draws straight into the pixels uploaded to the texture
+    std::vector<uint32_t> fb(256*240, 0xff000000);
+    nes.ppu.set_output(fb.data(), PixelFormat::RGBA8888);
 
     sf::Texture texture;
-    texture.loadFromImage(fb);
+    texture.create(256, 240);
+    texture.update(reinterpret_cast<const sf::Uint8*>(fb.data()));
 
     sf::Sprite sprt;
     sprt.setTexture(texture);
@@ -80,7 +126,14 @@ int main(int argc, char* argv[])
 
     sf::Clock framerate_clock;
 
-    window.setFramerateLimit(60);
+    // the hashes of a movie need the picture of every frame the game goes through, not of the frames ahead
+    const bool can_run_ahead = !player && !record_path;
+
+    // frame times, averaged over a second and shown in the title
+    double   emulation_seconds { 0 };
+    unsigned timed_frames { 0 };
+
+    window.setFramerateLimit(player ? 0 : 60);
 
     // run the program as long as the window is open
     while (window.isOpen())
@@ -102,7 +155,15 @@ int main(int argc, char* argv[])
                     switch (event.key.code)
                     {
                         case sf::Keyboard::R:
-                            NES::soft_reset();
+                            nes.soft_reset();
+                            break;
+                        case sf::Keyboard::Num0:
+                        case sf::Keyboard::Num1:
+                        case sf::Keyboard::Num2:
+                        case sf::Keyboard::Num3:
+                        case sf::Keyboard::Num4:
+                            if (press)
+                                run_ahead = event.key.code - sf::Keyboard::Num0;
                             break;
                         case sf::Keyboard::A:
                             controller_1.state.a = press; break;
@@ -137,16 +198,51 @@ int main(int argc, char* argv[])
             }
         }
 
-        NES::run_frame();
+        if (player)
+        {
+            if (!player->run_frame())
+            {
+                if (player->diverged())
+                    printf("movie diverged at frame %zu\n", player->frame() - 1);
+                else
+                    printf("movie played back, %zu frames matched\n", player->frame());
+                window.close();
+                break;
+            }
+        }
+        else
+        {
+            const auto start = std::chrono::steady_clock::now();
+            if (can_run_ahead && run_ahead)
+                nes.run_frame_ahead(run_ahead);
+            else
+                nes.run_frame();
+            emulation_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (++timed_frames == 60)
+            {
+                // the frame the game is at and the frames ahead of it
+                const double ahead_seconds = nes.run_ahead_seconds;
+                char title[128];
+                if (can_run_ahead && run_ahead)
+                    snprintf(title, sizeof(title), "Nematod - frame %.2f ms, run-ahead %u : +%.2f ms per frame ahead",
+                             (emulation_seconds - ahead_seconds) * 1e3 / timed_frames, run_ahead,
+                             ahead_seconds * 1e3 / (timed_frames * run_ahead));
+                else
+                    snprintf(title, sizeof(title), "Nematod - frame %.2f ms", emulation_seconds * 1e3 / timed_frames);
+                window.setTitle(title);
 
-        uint32_t* pixels_ptr = (uint32_t*)fb.getPixelsPtr();
-        // take overscan in account : copy from line 8 to line 231
-        for (size_t i { 0 }; i < 231*256; ++i)
+                emulation_seconds = nes.run_ahead_seconds = 0;
+                timed_frames = 0;
+            }
+        }
+        if (record_path)
         {
-            pixels_ptr[i + 8*256] = PPU::ppu_palette[NES::ppu.framebuffer[i + 8*256]];
+            movie.record(nes, controller_1.state);
         }
 
-        texture.update(fb);
+        // take overscan in account : upload from line 8 to line 238
+        texture.update(reinterpret_cast<const sf::Uint8*>(&fb[8*256]), 256, 231, 0, 8);
 
         // clear the window with black color
         window.clear(sf::Color::Black);
@@ -158,10 +254,17 @@ int main(int argc, char* argv[])
         window.display();
     }
 
-    if (NES::cart_data.battery_saved_ram)
+    if (nes.cart_data.battery_saved_ram)
+    {
+        nes.save_game_battery_save_data();
+    }
+
+    if (record_path && !movie.save(record_path))
     {
-        NES::save_game_battery_save_data();
+        error("could not save the movie\n");
     }
 
-    printf("crc : 0x%X\n", screen_crc32());
+    printf("crc : 0x%X\n", screen_crc32(nes));
+
+    return player && player->diverged() ? 1 : 0;
 }
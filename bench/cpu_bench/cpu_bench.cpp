@@ -0,0 +1,119 @@
+/*
+cpu_bench.cpp
+
+Copyright (c) 17 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// CPU-only benchmark : runs Klaus Dormann's 6502 functional test on a flat 64KB memory, without any PPU or scheduler,
+// to compare the opcode dispatch strategies (see cpu_dispatch). The results are reported as JSON on stdout.
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <array>
+
+#include "cpu/include/cpu.hpp"
+
+#ifndef NEMATOD_CPU_BENCH_ROM
+#define NEMATOD_CPU_BENCH_ROM "tests/cpu/roms/6502_functional_test.bin"
+#endif
+#ifndef NEMATOD_CPU_BENCH_DISPATCH
+#define NEMATOD_CPU_BENCH_DISPATCH "unknown"
+#endif
+
+namespace
+{
+
+std::array<uint8_t, 0x10000> memory;
+
+uint8_t read(void*, uint16_t addr)
+{
+    return memory[addr];
+}
+void write(void*, uint16_t addr, uint8_t val)
+{
+    memory[addr] = val;
+}
+
+void usage()
+{
+    fprintf(stderr, "usage : nematod_cpu_bench [--cycles N] [--runs N] [rom.bin]\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    size_t cycles = 25'000'000;
+    unsigned runs = 5;
+    std::string rom = NEMATOD_CPU_BENCH_ROM;
+
+    for (int i { 1 }; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--cycles") && has_value)
+            cycles = std::stoul(argv[++i]);
+        else if (!strcmp(argv[i], "--runs") && has_value)
+            runs = std::stoul(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+            rom = argv[i];
+    }
+
+    std::array<uint8_t, 0x10000> image {};
+    FILE* file = fopen(rom.c_str(), "rb");
+    if (!file || fread(image.data(), 1, image.size(), file) != image.size())
+    {
+        fprintf(stderr, "could not load '%s'\n", rom.c_str());
+        if (file)
+            fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    // keep the best run, the others are mostly disturbed by the rest of the system
+    double best_seconds = 0;
+    size_t cpu_cycles = 0;
+    for (unsigned run { 0 }; run < runs; ++run)
+    {
+        memory = image;
+        cpu6502 cpu(read, write);
+        cpu.state.pc = 0x400;
+
+        auto start = std::chrono::steady_clock::now();
+        while (cpu.cycles < cycles)
+            cpu.run(1000);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (run == 0 || elapsed.count() < best_seconds)
+            best_seconds = elapsed.count();
+        cpu_cycles = cpu.cycles;
+    }
+
+    printf("{\"dispatch\": \"%s\", \"cpu_cycles\": %zu, \"seconds\": %.4f, \"mhz\": %.2f, \"ns_per_cpu_cycle\": %.3f}\n",
+           NEMATOD_CPU_BENCH_DISPATCH, cpu_cycles, best_seconds, cpu_cycles / best_seconds / 1e6, best_seconds * 1e9 / cpu_cycles);
+}
@@ -0,0 +1,576 @@
+/*
+main.cpp
+
+Copyright (c) 17 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+// Headless throughput benchmark : runs each rom for a fixed number of frames and reports the results as JSON on stdout
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "core/include/nes.hpp"
+#include "core/include/rewind.hpp"
+#include "core/include/movie.hpp"
+
+#include "input/include/standard_controller.hpp"
+#include "input/include/inputadapter.hpp"
+#include "common/log.hpp"
+
+#ifndef NEMATOD_BENCH_ROM_DIR
+#define NEMATOD_BENCH_ROM_DIR "tests/ppu/roms"
+#endif
+
+namespace
+{
+
+const char* default_roms[] =
+{
+    "smb.nes",
+    "zelda.nes",
+    "metroid.nes",
+    "excitebike.nes",
+    "donkey kong.nes",
+    "mb.nes",
+    "LodeRunner.nes",
+    "KungFu.nes",
+};
+
+struct bench_result
+{
+    std::string rom;
+    bool        loaded { false };
+    std::string error;
+    size_t      frames { 0 };
+    double      seconds { 0 };
+    size_t      cpu_cycles { 0 };
+    size_t      idle_cycles_skipped { 0 };
+    size_t      decoded_instructions { 0 }, interpreted_instructions { 0 };
+    double      interpreted_seconds { 0 }; // the same run without decoding the code in PRG-ROM, see --decode-speedup
+    size_t      compiled_instructions { 0 };
+    double      uncompiled_seconds { 0 };  // the same run without native code, see --jit-speedup
+    size_t      fast_scanlines { 0 }, dot_scanlines { 0 };
+    size_t      reused_backgrounds { 0 };
+    size_t      state_bytes { 0 }, states { 0 };
+    double      save_seconds { 0 }, load_seconds { 0 }, max_save_seconds { 0 };
+    size_t      rewind_frames { 0 }, rewind_bytes { 0 }, rewind_keyframes { 0 };
+    double      capture_seconds { 0 }, rewind_seconds { 0 };
+    double      run_ahead_seconds { 0 };
+    const char* movie { nullptr }; // "recorded", "matched" or "diverged"
+    long        peak_rss_kb { 0 };
+    bool        own_peak_rss { false }; // peak_rss_kb is this rom's, not the process's up to this rom
+};
+
+struct console_options
+{
+    bool skip_idle_loops   { true };
+    bool decode_rom_code   { true };
+    bool decode_speedup    { false }; // also run each rom without decode_rom_code
+    bool compile_rom_code  { false };
+    bool jit_speedup       { false }; // also run each rom without compile_rom_code
+    bool dot_ppu { true };
+    bool scanline_renderer { true };
+    bool simd_compose { true };
+    bool reuse_backgrounds { true };
+    const char* output { nullptr }; // see output_formats
+    unsigned frameskip { 0 };
+    unsigned save_states { 0 }; // save a state and load it back every N frames
+    size_t   rewind_kb { 0 };   // capture every frame in a rewind buffer of that size
+    unsigned run_ahead { 0 };   // frames run ahead of each frame (Console::run_frame_ahead)
+    // directories of the input movies of the roms, to record them or play them back
+    const char* record_movies { nullptr };
+    const char* play_movies   { nullptr };
+};
+
+const struct { const char* name; PixelFormat format; } output_formats[] =
+{
+    { "indexed", PixelFormat::Indexed  },
+    { "rgba",    PixelFormat::RGBA8888 },
+    { "bgra",    PixelFormat::BGRA8888 },
+    { "rgb565",  PixelFormat::RGB565   },
+};
+
+// scripted input so that games get past their title screen and actually play
+void update_input(StandardController& pad, size_t frame)
+{
+    pad.state = {};
+    pad.state.start = (frame % 120) >= 100 && (frame % 120) < 105;
+    pad.state.right = frame > 300;
+    pad.state.a     = frame > 300 && (frame % 40) < 10;
+}
+
+std::string movie_path(const char* dir, const std::string& rom)
+{
+    return std::string(dir) + "/" + rom.substr(0, rom.find_last_of('.')) + ".nmv";
+}
+
+long peak_rss_kb()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // in kilobytes on Linux
+}
+
+// Brings the peak RSS back to the current RSS (Linux only), so that the next peak_rss_kb() is the peak of what ran since.
+// false if it couldn't be reset : the peak is then the one of the whole process.
+bool reset_peak_rss()
+{
+    FILE* clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (!clear_refs)
+        return false;
+    const bool written = fputs("5", clear_refs) >= 0;
+    return fclose(clear_refs) == 0 && written;
+}
+
+bench_result run_rom(const std::string& path, const std::string& name, size_t frames, NES::SyncMode mode, const console_options& options)
+{
+    bench_result result;
+    result.rom = name;
+    result.own_peak_rss = reset_peak_rss(); // before the console is allocated
+
+    NES::Console nes;
+    StandardController pad;
+
+    nes.init();
+    try
+    {
+        if (!nes.load_cartridge(path))
+        {
+            result.error = "could not load rom";
+            return result;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error("%s : %s\n", path.c_str(), e.what());
+        result.error = "could not load rom";
+        return result;
+    }
+
+    // the movie replaces the scripted input, and runs for as long as it was recorded
+    NES::Movie movie;
+    std::unique_ptr<NES::MoviePlayer> player;
+    if (options.play_movies)
+    {
+        if (!movie.load(movie_path(options.play_movies, name)))
+        {
+            result.error = "could not load " + movie_path(options.play_movies, name);
+            return result;
+        }
+        player = std::make_unique<NES::MoviePlayer>(movie, nes, pad);
+        if (player->wrong_game())
+        {
+            result.error = "the movie was recorded on another game";
+            return result;
+        }
+        frames = movie.frames.size();
+    }
+    result.loaded = true;
+
+    nes.input.controller_1 = &pad;
+    nes.dot_ppu = options.dot_ppu; // applied by the power cycle
+    nes.decode_rom_code = options.decode_rom_code;
+    nes.compile_rom_code = options.compile_rom_code;
+    nes.power_cycle();
+    nes.set_sync_mode(mode);
+    nes.skip_idle_loops   = options.skip_idle_loops;
+    nes.ppu.scanline_renderer = options.scanline_renderer;
+    nes.ppu.simd_compose      = options.simd_compose;
+    nes.ppu.frameskip         = options.frameskip;
+    nes.ppu.reuse_backgrounds = options.reuse_backgrounds;
+
+    std::vector<uint8_t> output_pixels(256*240*4);
+    for (const auto& output : output_formats)
+    {
+        if (options.output && !strcmp(options.output, output.name))
+            nes.ppu.set_output(output_pixels.data(), output.format);
+    }
+
+    std::vector<uint8_t> state(nes.state_size());
+    result.state_bytes = state.size();
+
+    std::unique_ptr<NES::RewindBuffer> rewind;
+    if (options.rewind_kb)
+        rewind = std::make_unique<NES::RewindBuffer>(nes, options.rewind_kb * 1024, frames + 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i { 0 }; i < frames; ++i)
+    {
+        if (player)
+        {
+            // stops at the first frame that isn't the same as in the movie
+            if (!player->run_frame())
+                break;
+        }
+        else
+        {
+            update_input(pad, i);
+            nes.run_frame_ahead(options.run_ahead);
+        }
+        if (options.record_movies)
+            movie.record(nes, pad.state);
+
+        if (rewind)
+            rewind->capture();
+
+        if (options.save_states && (i % options.save_states) == 0)
+        {
+            // loading the state just saved doesn't change anything
+            const auto save_start = std::chrono::steady_clock::now();
+            nes.save_state(state.data(), state.size());
+            const auto load_start = std::chrono::steady_clock::now();
+            nes.load_state(state.data(), state.size());
+            const auto load_end = std::chrono::steady_clock::now();
+
+            const double save_seconds = std::chrono::duration<double>(load_start - save_start).count();
+            result.save_seconds += save_seconds;
+            result.max_save_seconds = std::max(result.max_save_seconds, save_seconds);
+            result.load_seconds += std::chrono::duration<double>(load_end - load_start).count();
+            ++result.states;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    result.frames      = player ? player->frame() : frames;
+    result.seconds     = elapsed.count();
+    result.cpu_cycles  = nes.total_cycles / 12; // master clock cycles, OAM DMA stalls included
+    result.idle_cycles_skipped = nes.idle_cycles_skipped;
+    result.decoded_instructions     = nes.cpu.code_stats.decoded;
+    result.interpreted_instructions = nes.cpu.code_stats.interpreted;
+    result.compiled_instructions    = nes.cpu.code_stats.compiled;
+    result.fast_scanlines = nes.ppu.stats.fast_scanlines;
+    result.dot_scanlines  = nes.ppu.stats.dot_scanlines;
+    result.reused_backgrounds = nes.ppu.stats.reused_backgrounds;
+    result.run_ahead_seconds = nes.run_ahead_seconds;
+    result.peak_rss_kb = peak_rss_kb();
+
+    if (rewind)
+    {
+        result.rewind_frames    = rewind->frames();
+        result.rewind_bytes     = rewind->bytes_used();
+        result.rewind_keyframes = rewind->stats.keyframes;
+        result.capture_seconds  = rewind->stats.capture_seconds;
+
+        // back to the oldest frame kept : its keyframe and its delta are decoded, as for any other frame
+        const auto rewind_start = std::chrono::steady_clock::now();
+        rewind->rewind(rewind->frames() - 1);
+        result.rewind_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - rewind_start).count();
+    }
+
+    if (options.record_movies)
+    {
+        if (!movie.save(movie_path(options.record_movies, name)))
+            error("could not save %s\n", movie_path(options.record_movies, name).c_str());
+        result.movie = "recorded";
+    }
+    if (player)
+    {
+        result.movie = player->diverged() ? "diverged" : "matched";
+    }
+
+    return result;
+}
+
+std::string json_escape(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void print_json(const std::vector<bench_result>& results, size_t frames, NES::SyncMode mode, const console_options& options)
+{
+    double total_seconds = 0;
+    size_t total_frames = 0;
+    // the peak is reset for each rom, the process' is the highest of theirs
+    long total_peak_rss_kb = peak_rss_kb();
+
+    printf("{\n");
+    printf("  \"frames_per_rom\": %zu,\n", frames);
+    printf("  \"sync_mode\": \"%s\",\n", mode == NES::SyncMode::CatchUp ? "catchup" : "lockstep");
+    printf("  \"rom_code\": \"%s\",\n", !options.decode_rom_code ? "interpreted" : options.compile_rom_code ? "compiled" : "decoded");
+    printf("  \"ppu_core\": \"%s\",\n", options.dot_ppu ? "dots" : "coroutine");
+    printf("  \"renderer\": \"%s\",\n", options.scanline_renderer ? "scanline" : "dots");
+    printf("  \"pixel_compose\": \"%s\",\n", options.simd_compose && compose_pixels_simd ? "sse4.1" : "scalar");
+    printf("  \"output\": \"%s\",\n", options.output ? options.output : "none");
+    printf("  \"run_ahead\": %u,\n", options.run_ahead);
+    if (options.frameskip == PPU::skip_all_frames)
+        printf("  \"frameskip\": \"all\",\n");
+    else
+        printf("  \"frameskip\": %u,\n", options.frameskip);
+    printf("  \"roms\": [\n");
+    for (size_t i { 0 }; i < results.size(); ++i)
+    {
+        const auto& r = results[i];
+        printf("    {\"rom\": \"%s\", ", json_escape(r.rom).c_str());
+        if (!r.loaded)
+        {
+            printf("\"error\": \"%s\"}", json_escape(r.error).c_str());
+        }
+        else
+        {
+            printf("\"frames\": %zu, \"seconds\": %.4f, \"fps\": %.2f, \"ns_per_cpu_cycle\": %.3f, \"idle_cycles_skipped\": %zu",
+                   r.frames, r.seconds, r.frames / r.seconds, r.seconds * 1e9 / r.cpu_cycles, r.idle_cycles_skipped);
+            // without a reset, the peak so far would be the highest of all the roms run before
+            if (r.own_peak_rss)
+                printf(", \"peak_rss_kb\": %ld", r.peak_rss_kb);
+            // share of the instructions run from the cpu's decoded instructions, natively or not
+            const size_t instructions = r.decoded_instructions + r.compiled_instructions + r.interpreted_instructions;
+            printf(", \"decoded_rate\": %.4f",
+                   instructions ? double(r.decoded_instructions + r.compiled_instructions) / instructions : 0.0);
+            if (r.interpreted_seconds > 0)
+                printf(", \"decode_speedup\": %.3f", r.interpreted_seconds / r.seconds);
+            if (options.compile_rom_code)
+                printf(", \"compiled_rate\": %.4f", instructions ? double(r.compiled_instructions) / instructions : 0.0);
+            if (r.uncompiled_seconds > 0)
+                printf(", \"jit_speedup\": %.3f", r.uncompiled_seconds / r.seconds);
+            // share of the visible lines drawn by the scanline renderer
+            const size_t scanlines = r.fast_scanlines + r.dot_scanlines;
+            printf(", \"fast_scanline_rate\": %.4f", scanlines ? double(r.fast_scanlines) / scanlines : 0.0);
+            // share of those whose background was reused from a previous frame
+            printf(", \"background_reuse_rate\": %.4f", r.fast_scanlines ? double(r.reused_backgrounds) / r.fast_scanlines : 0.0);
+            if (r.states)
+            {
+                printf(", \"state_bytes\": %zu, \"save_state_us\": %.2f, \"max_save_state_us\": %.2f, \"load_state_us\": %.2f",
+                       r.state_bytes, r.save_seconds * 1e6 / r.states, r.max_save_seconds * 1e6, r.load_seconds * 1e6 / r.states);
+            }
+            if (r.rewind_frames)
+            {
+                // history kept, in frames and in seconds of play at 60 fps
+                printf(", \"rewind_frames\": %zu, \"rewind_history_seconds\": %.1f, \"rewind_bytes\": %zu, \"rewind_bytes_per_frame\": %.1f, "
+                       "\"rewind_keyframes\": %zu, \"capture_us\": %.2f, \"rewind_us\": %.2f",
+                       r.rewind_frames, r.rewind_frames / 60.0, r.rewind_bytes, double(r.rewind_bytes) / r.rewind_frames,
+                       r.rewind_keyframes, r.capture_seconds * 1e6 / r.frames, r.rewind_seconds * 1e6);
+            }
+            if (options.run_ahead)
+            {
+                // time taken by each frame run ahead, the rest of the frame time is the frame the game is at
+                printf(", \"run_ahead_us_per_frame\": %.2f", r.run_ahead_seconds * 1e6 / (r.frames * options.run_ahead));
+            }
+            if (r.movie)
+            {
+                printf(", \"movie\": \"%s\"", r.movie);
+                // counting from 0, the hashes of all the frames before it matched
+                if (!strcmp(r.movie, "diverged"))
+                    printf(", \"diverged_at_frame\": %zu", r.frames - 1);
+            }
+            printf("}");
+            total_seconds += r.seconds;
+            total_frames  += r.frames;
+            total_peak_rss_kb = std::max(total_peak_rss_kb, r.peak_rss_kb);
+        }
+        printf("%s\n", i + 1 < results.size() ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"total\": {\"frames\": %zu, \"seconds\": %.4f, \"fps\": %.2f, \"peak_rss_kb\": %ld}\n",
+           total_frames, total_seconds, total_seconds > 0 ? total_frames / total_seconds : 0.0, total_peak_rss_kb);
+    printf("}\n");
+}
+
+void usage()
+{
+    fprintf(stderr, "usage : nematod_bench [--frames N] [--sync lockstep|catchup] [--no-idle-skip] [--no-decode] [--decode-speedup] [--jit] [--jit-speedup] [--coroutine-ppu] [--dot-renderer] [--no-simd] [--no-bg-reuse] [--output indexed|rgba|bgra|rgb565] [--frameskip N|all] [--save-states N] [--rewind KB] [--run-ahead N] [--record-movies dir] [--play-movies dir] [--rom-dir dir] [rom.nes...]\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    global_logger.filter(WARNING);
+
+    size_t frames = 600;
+    NES::SyncMode mode = NES::SyncMode::Lockstep;
+    console_options options;
+    std::string rom_dir = NEMATOD_BENCH_ROM_DIR;
+    std::vector<std::string> roms;
+
+    for (int i { 1 }; i < argc; ++i)
+    {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && has_value)
+        {
+            frames = std::stoul(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--sync") && has_value)
+        {
+            const std::string value = argv[++i];
+            if (value == "lockstep")
+                mode = NES::SyncMode::Lockstep;
+            else if (value == "catchup")
+                mode = NES::SyncMode::CatchUp;
+            else
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--no-idle-skip"))
+        {
+            options.skip_idle_loops = false;
+        }
+        else if (!strcmp(argv[i], "--no-decode"))
+        {
+            options.decode_rom_code = false;
+        }
+        else if (!strcmp(argv[i], "--decode-speedup"))
+        {
+            options.decode_speedup = true;
+        }
+        else if (!strcmp(argv[i], "--jit"))
+        {
+            options.compile_rom_code = true;
+        }
+        else if (!strcmp(argv[i], "--jit-speedup"))
+        {
+            options.compile_rom_code = options.jit_speedup = true;
+        }
+        else if (!strcmp(argv[i], "--coroutine-ppu"))
+        {
+            options.dot_ppu = false;
+        }
+        else if (!strcmp(argv[i], "--dot-renderer"))
+        {
+            options.scanline_renderer = false;
+        }
+        else if (!strcmp(argv[i], "--no-simd"))
+        {
+            options.simd_compose = false;
+        }
+        else if (!strcmp(argv[i], "--no-bg-reuse"))
+        {
+            options.reuse_backgrounds = false;
+        }
+        else if (!strcmp(argv[i], "--output") && has_value)
+        {
+            options.output = argv[++i];
+            bool known = false;
+            for (const auto& output : output_formats)
+                known |= !strcmp(options.output, output.name);
+            if (!known)
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--frameskip") && has_value)
+        {
+            const std::string value = argv[++i];
+            options.frameskip = value == "all" ? PPU::skip_all_frames : std::stoul(value);
+        }
+        else if (!strcmp(argv[i], "--save-states") && has_value)
+        {
+            options.save_states = std::stoul(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--rewind") && has_value)
+        {
+            options.rewind_kb = std::stoul(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--run-ahead") && has_value)
+        {
+            options.run_ahead = std::stoul(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--record-movies") && has_value)
+        {
+            options.record_movies = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--play-movies") && has_value)
+        {
+            options.play_movies = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--rom-dir") && has_value)
+        {
+            rom_dir = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            roms.emplace_back(argv[i]);
+        }
+    }
+
+    // after run_frame_ahead() the framebuffer holds the frame run ahead, not the one the game is at : the movie would
+    // hash the wrong frames, and its playback (which doesn't run ahead) would diverge at once
+    if (options.run_ahead && (options.record_movies || options.play_movies))
+    {
+        fprintf(stderr, "--run-ahead can't be combined with --record-movies or --play-movies\n");
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> paths; // and names
+    if (roms.empty())
+    {
+        for (auto rom : default_roms)
+            paths.emplace_back(rom_dir + "/" + rom, rom);
+    }
+    else
+    {
+        for (const auto& rom : roms)
+            paths.emplace_back(rom, rom.substr(rom.find_last_of('/') + 1));
+    }
+
+    std::vector<bench_result> results;
+    for (const auto& [path, name] : paths)
+    {
+        results.emplace_back(run_rom(path, name, frames, mode, options));
+        if (options.decode_speedup && results.back().loaded)
+        {
+            // the same frames, the code in PRG-ROM being fetched and decoded for each instruction
+            console_options interpreted = options;
+            interpreted.decode_rom_code = false;
+            interpreted.record_movies = nullptr;
+            results.back().interpreted_seconds = run_rom(path, name, frames, mode, interpreted).seconds;
+        }
+        if (options.jit_speedup && results.back().loaded)
+        {
+            // the same frames, all of the code being run by the interpreter
+            console_options uncompiled = options;
+            uncompiled.compile_rom_code = false;
+            uncompiled.record_movies = nullptr;
+            results.back().uncompiled_seconds = run_rom(path, name, frames, mode, uncompiled).seconds;
+        }
+    }
+
+    print_json(results, frames, mode, options);
+
+    // a movie not played back to its end fails the run
+    for (const auto& r : results)
+    {
+        if (options.play_movies && (!r.loaded || !strcmp(r.movie, "diverged")))
+            return 1;
+    }
+}
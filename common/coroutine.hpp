@@ -25,8 +25,13 @@ SOFTWARE.
 #ifndef COROUTINE_HPP
 #define COROUTINE_HPP
 
+#include <algorithm>
+
 #include "external/libaco/aco.h"
 
+// skip_count and aco_reset() are additions to this version of libaco, to be ported when updating it
+static_assert(ACO_VERSION_MAJOR == 1 && ACO_VERSION_MINOR == 2 && ACO_VERSION_PATCH == 4, "libaco was updated");
+
 struct coroutine_group
 {
     aco_share_stack_t* stack;
@@ -37,17 +42,26 @@ struct coroutine
     aco_t* co;
 };
 
-inline aco_t* main_coroutine { nullptr };
+// coroutines are resumed from and yield back to the main coroutine of the thread running them
+inline thread_local aco_t* main_coroutine { nullptr };
 
+// must be called on each thread running coroutines before creating them, calling it again on the same thread is a no-op
 inline void coroutines_init()
 {
+    if (main_coroutine)
+        return;
+
     aco_thread_init(nullptr);
     main_coroutine = aco_create(nullptr, nullptr, 0, nullptr, nullptr);
 }
 
-inline coroutine_group make_co_group()
+constexpr size_t default_co_stack_size = 4096;
+
+// The coroutines of a group run on the same stack, which is copied out and back in whenever another coroutine
+// of the group is resumed. A group with a single coroutine is a private stack : switches don't copy anything.
+inline coroutine_group make_co_group(size_t stack_size = default_co_stack_size)
 {
-    return {aco_share_stack_new(4096)};
+    return {aco_share_stack_new(stack_size)};
 }
 
 inline void destroy_co_group(coroutine_group& group)
@@ -60,11 +74,24 @@ inline coroutine make_co(const coroutine_group& group, void(*func)(), void* arg
     return {aco_create(main_coroutine, group.stack, 64, (void(*)())func, arg)};
 }
 
+// lets a suspended coroutine created on another thread be resumed from the current one
+inline void rebind_co(coroutine& co)
+{
+    co.co->main_co = main_coroutine;
+}
+
 inline void destroy_co(coroutine& co)
 {
     aco_destroy(co.co);
 }
 
+// Starts a suspended coroutine over from its function, as a new one would. Nothing is destroyed on the stack it is
+// leaving, and nothing is allocated.
+inline void restart_co(coroutine& co)
+{
+    aco_reset(co.co);
+}
+
 inline void* get_co_arg()
 {
     return aco_get_arg();
@@ -86,6 +113,23 @@ inline void run_co(const coroutine& resume_co)
     aco_resume(resume_co.co);
 }
 
+// equivalent to calling run_co() 'count' times, but consumes skip counts in bulk
+inline void run_co_for(const coroutine& resume_co, size_t count)
+{
+    while (count)
+    {
+        const size_t skipped = std::min(resume_co.co->skip_count, count);
+        resume_co.co->skip_count -= skipped;
+        count -= skipped;
+
+        if (count)
+        {
+            aco_resume(resume_co.co);
+            --count;
+        }
+    }
+}
+
 inline void co_set_skip(size_t count)
 {
     aco_get_co()->skip_count = count;
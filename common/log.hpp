@@ -19,7 +19,7 @@ public:
             *out_streams[lvl] << m_prefix;
 
              // don't store on the stack; no need to be reentrant and allows coroutines to have a tiny stack
-            static char buff[2048];
+            static thread_local char buff[2048];
             std::snprintf(&buff[0], 2048, fmt, args...); // No buffer overflow there, sir !
 
             *out_streams[lvl] << &buff[0];
@@ -44,15 +44,37 @@ inline void parallel_stepper_trampoline()
 
 using stepper_func = void(*)();
 
+// How the coroutines of a ParallelStepper get their stack
+struct StepperStacks
+{
+    enum Mode
+    {
+        Shared,  // one stack for all of them, libaco saves and restores its contents on every switch
+        Private  // one stack each, a switch only swaps registers
+    };
+
+    Mode   mode { Shared };
+    size_t size { default_co_stack_size };
+};
+
 template <typename... ClockReceivers>
 class ParallelStepper
 {
 public:
     ParallelStepper(ClockReceivers&... args) noexcept
-        : m_grp(make_co_group())
+        : ParallelStepper(StepperStacks{}, args...)
+    {}
+    ParallelStepper(StepperStacks stacks, ClockReceivers&... args) noexcept
+        : m_stacks(stacks)
     {
+        for (size_t i = 0; i < m_groups.size(); ++i)
+        {
+            if (i == 0 || m_stacks.mode == StepperStacks::Private)
+                m_groups[i] = make_co_group(m_stacks.size);
+        }
+
         unsigned idx = 0;
-        ((m_coroutines[idx++] = {make_co(m_grp, &parallel_stepper_trampoline, &args), ClockReceivers::clock_rate, 0}), ...);
+        ((m_coroutines[idx] = {make_co(group(idx), &parallel_stepper_trampoline, &args), ClockReceivers::clock_rate, 0}, ++idx), ...);
     }
     ~ParallelStepper() noexcept
     {
@@ -60,7 +82,11 @@ public:
         {
             destroy_co(entry.co);
         }
-        destroy_co_group(m_grp);
+        for (auto& grp : m_groups)
+        {
+            if (grp.stack)
+                destroy_co_group(grp);
+        }
     }
 
 public:
@@ -73,8 +99,17 @@ public:
         {
             destroy_co(entry.co);
         }
-        unsigned co_idx = 0, receiver_idx = 0;
-        ((m_coroutines[co_idx++] = {make_co(m_grp, &parallel_stepper_trampoline, clock_receivers[receiver_idx++]), ClockReceivers::clock_rate, 0}), ...);
+        unsigned idx = 0;
+        ((m_coroutines[idx] = {make_co(group(idx), &parallel_stepper_trampoline, clock_receivers[idx]), ClockReceivers::clock_rate, 0}, ++idx), ...);
+    }
+
+    // the coroutines can only be resumed from the thread they are bound to
+    void bind_to_current_thread() noexcept
+    {
+        for (auto& entry : m_coroutines)
+        {
+            rebind_co(entry.co);
+        }
     }
 
     void step() noexcept
@@ -100,7 +135,15 @@ public:
         });
     }
 
+    StepperStacks stacks() const noexcept
+    { return m_stacks; }
+
 private:
+    const coroutine_group& group(size_t co_idx) const noexcept
+    {
+        return m_groups[m_stacks.mode == StepperStacks::Private ? co_idx : 0];
+    }
+
     template <typename Receiver, size_t clock>
     inline constexpr void run_if_clock([[maybe_unused]] int co_idx)
     {
@@ -118,7 +161,8 @@ public:
         unsigned cur_clock;
     };
 
-    coroutine_group m_grp;
+    StepperStacks m_stacks;
+    std::array<coroutine_group, sizeof...(ClockReceivers)> m_groups {};
     std::array<CoroutineEntry, sizeof...(ClockReceivers)> m_coroutines;
 };
 
@@ -0,0 +1,94 @@
+/*
+state_stream.hpp
+
+Copyright (c) 28 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef STATE_STREAM_HPP
+#define STATE_STREAM_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Saves the state of components into a caller-provided buffer, or loads it back, without allocating.
+// A component's serialize(StateStream&) goes through its state in the same order in both directions : io() for
+// trivially copyable values, bytes() for raw memory. Values are stored as they are in memory, so states can only be
+// loaded by a build for the same architecture.
+class StateStream
+{
+public:
+    // measures the size of a state without storing it
+    StateStream() = default;
+    // saving
+    StateStream(uint8_t* buffer, size_t capacity)
+        : m_out(buffer), m_end(capacity)
+    {}
+    // loading
+    StateStream(const uint8_t* buffer, size_t size)
+        : m_in(buffer), m_end(size)
+    {}
+
+    template <typename T>
+    void io(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be copied as bytes");
+        bytes(&value, sizeof(T));
+    }
+
+    void bytes(void* data, size_t size)
+    {
+        if (m_failed || size > m_end - m_pos)
+        {
+            m_failed = true;
+            return;
+        }
+
+        if (m_in)
+            std::memcpy(data, m_in + m_pos, size);
+        else if (m_out)
+            std::memcpy(m_out + m_pos, data, size);
+        m_pos += size;
+    }
+
+    bool loading() const
+    { return m_in != nullptr; }
+    // the next 'size' bytes about to be loaded, to compare them with the current state, null when not loading
+    const uint8_t* peek(size_t size) const
+    { return m_in && !m_failed && size <= m_end - m_pos ? m_in + m_pos : nullptr; }
+    // the buffer was too small, or the state being loaded didn't match what was expected
+    bool failed() const
+    { return m_failed; }
+    void fail()
+    { m_failed = true; }
+    // bytes stored or loaded so far
+    size_t size() const
+    { return m_pos; }
+
+private:
+    uint8_t*       m_out { nullptr };
+    const uint8_t* m_in  { nullptr };
+    size_t m_pos { 0 };
+    size_t m_end { SIZE_MAX };
+    bool   m_failed { false };
+};
+
+#endif // STATE_STREAM_HPP
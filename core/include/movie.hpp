@@ -0,0 +1,98 @@
+/*
+movie.hpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef MOVIE_HPP
+#define MOVIE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nes.hpp"
+#include "input/include/standard_controller.hpp"
+
+namespace NES
+{
+
+// Input movies : the buttons held on the first controller during each frame of a run, along with a hash of the
+// console after it. Replaying a movie from power on must give the same hashes on every frame, whatever the sync mode,
+// cpu or ppu core : the first frame that doesn't tells when the emulation started to differ from the recording.
+struct Movie
+{
+    static constexpr uint32_t version = 1;
+
+    struct frame
+    {
+        StandardController::State input;
+        uint64_t hash; // of the console once the frame is run, see hash()
+    };
+
+    uint64_t rom_hash { 0 }; // the game it was recorded on, see hash_rom()
+    std::vector<frame> frames;
+
+    // RAM and framebuffer : frames must be drawn (PPU::frameskip), and not run ahead (Console::run_frame_ahead()), for
+    // the hashes to match
+    static uint64_t hash(const Console& nes);
+    static uint64_t hash_rom(const cartridge_data& cart);
+
+    // to be called after each frame is run from power on, with the input it was run with
+    void record(const Console& nes, const StandardController::State& input);
+
+    bool save(const std::string& path) const;
+    // false if the file isn't a movie of this version
+    bool load(const std::string& path);
+};
+
+// Plays a movie back on a console just powered on, the input being fed to controller, until it ends or diverges
+class MoviePlayer
+{
+public:
+    MoviePlayer(const Movie& movie, Console& nes, StandardController& controller);
+
+    // runs the next frame : false once the movie is over or has diverged, or if the console isn't running its game
+    bool run_frame();
+
+    // frames run
+    size_t frame() const
+    { return m_frame; }
+    bool   finished() const
+    { return m_frame == m_movie.frames.size(); }
+    // the hash of the last frame run, frame() - 1 counting from 0, didn't match the recording
+    bool   diverged() const
+    { return m_diverged; }
+    bool   wrong_game() const
+    { return m_wrong_game; }
+
+private:
+    const Movie& m_movie;
+    Console& m_nes;
+    StandardController& m_controller;
+    size_t m_frame { 0 };
+    bool   m_diverged { false };
+    bool   m_wrong_game { false };
+};
+
+}
+
+#endif // MOVIE_HPP
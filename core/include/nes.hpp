@@ -25,66 +25,177 @@ SOFTWARE.
 #ifndef NES_HPP
 #define NES_HPP
 
+#include <memory>
+#include <vector>
+
 #include "memory/include/memory.hpp"
+#include "ppu/include/ppu.hpp"
+#include "ppu/include/ppu_regs.hpp"
+#include "cpu/include/cpu.hpp"
+#include "cpu/include/io_regs.hpp"
+#include "input/include/inputadapter.hpp"
+#include "nesloader/include/nesloader.hpp"
 
-class InputAdapter;
-class PPU;
-class PPUCtrlRegs;
-class cpu6502;
-class IORegs;
 class Mapper;
-struct cartridge_data;
 
 namespace NES
 {
-void init();
-
-void soft_reset();
-void power_cycle();
-
-void run_frame();
-void run_cpu_cycle();
-void run_ppu_cycle();
-
-bool load_game_battery_save_data();
-bool save_game_battery_save_data();
-
-// actually report errors
-bool load_cartridge(const std::string& path);
-
-bool set_mapper   (unsigned mapper_idx);
-void set_mirroring(const struct mirroring_config& config);
-
-extern Mapper*      mapper;
-extern InputAdapter input;
-extern PPU     ppu;
-extern PPUCtrlRegs ppu_regs;
-extern cpu6502 cpu;
-extern IORegs io_regs;
+enum class SyncMode
+{
+    Lockstep, // the cpu and the ppu are interleaved on every cpu cycle
+    CatchUp   // the cpu runs ahead, the ppu is only brought up to date when the cpu accesses it or when an NMI could be raised
+};
 
-extern AddressSpace cpu_space;
+// nametables, indexes into Console::nametables
+struct mirroring_config
+{
+    uint8_t top_left   , top_right;
+    uint8_t bottom_left, bottom_right;
+};
 
-extern RAM<0x0800> nes_ram;
-extern RAM<0x0100> palette_ram;
+inline constexpr mirroring_config horizontal { 0, 0, 1, 1 };
+inline constexpr mirroring_config vertical   { 0, 1, 0, 1 };
+inline constexpr mirroring_config fourscreen { 0, 1, 2, 3 };
+inline constexpr mirroring_config onescreen_nt1  { 0, 0, 0, 0 };
+inline constexpr mirroring_config onescreen_nt2  { 1, 1, 1, 1 };
 
-extern bool           cart_loaded;
-extern cartridge_data cart_data;
-extern size_t total_cycles;
+class Console;
 
-// nametables
-extern RAM<0x0400> nt1, nt2, nt3, nt4;
-struct mirroring_config
+// The cpu's view of the console. Its members are defined in nes.cpp, where the cpu is instantiated,
+// so that RAM and ROM accesses are inlined into the instructions.
+struct cpu_bus
 {
-    RAM<0x0400>& top_left   , & top_right;
-    RAM<0x0400>& bottom_left, & bottom_right;
+    static constexpr cpu_type flavor = NES6502;
+    static constexpr cpu_dispatch dispatch = SwitchDispatch;
+
+    Console& nes;
+
+    // when free running the cpu only yields to the scheduler once it reaches sync_cycle, otherwise it yields on every cycle
+    bool     free_running { false };
+    unsigned sync_cycle   { 0 };
+    bool     state_requested { false }; // see Console::save_state()
+
+    uint8_t read (uint16_t addr);
+    void    write(uint16_t addr, uint8_t val);
+    void    cycle();
+    void    idle_loop(unsigned iteration_cycles);
+    void    instruction_boundary();
+    void    log(const char*) {}
+
+    const uint8_t* code_page(uint16_t addr);
+    void     latch(uint8_t val);
+    unsigned quiet_cycles() const;
+    const uint8_t* read_page(uint16_t addr);
+    uint8_t*       write_page(uint16_t addr);
 };
+using CPU = basic_cpu6502<cpu_bus>;
 
-inline mirroring_config horizontal { nt1, nt1, nt2, nt2 };
-inline mirroring_config vertical   { nt1, nt2, nt1, nt2 };
-inline mirroring_config fourscreen { nt1, nt2, nt3, nt4 };
-inline mirroring_config onescreen_nt1  { nt1, nt1, nt1, nt1 };
-inline mirroring_config onescreen_nt2  { nt2, nt2, nt2, nt2 };
+// A whole NES : consoles are independent from each other and can be run side by side.
+// A console can be run from any thread once coroutines_init() has been called on it, but only from one thread at a time.
+class Console
+{
+public:
+    Console();
+    ~Console();
+
+    Console(const Console&) = delete;
+    Console& operator=(const Console&) = delete;
+
+public:
+    void init();
+
+    void soft_reset();
+    void power_cycle();
+
+    void run_frame();
+    void run_cpu_cycle();
+    void run_ppu_cycle();
+
+    bool load_game_battery_save_data();
+    bool save_game_battery_save_data();
+
+    // actually report errors
+    bool load_cartridge(const std::string& path);
+    // e.g. another console's cart_data, to run the same game without loading the file again
+    bool load_cartridge(const cartridge_data& cart);
+
+    void     set_sync_mode(SyncMode mode);
+    SyncMode sync_mode() const;
+
+    bool set_mapper   (unsigned mapper_idx);
+    void set_mirroring(const mirroring_config& config);
+
+    // Save states : the whole machine but the frames already drawn, in a versioned binary format. The state is taken
+    // at the next instruction boundary, where the cpu and the ppu resume from known points : save_state() runs the
+    // console up to it (a few cpu cycles at most after run_frame()), the emulation going on exactly as it would have.
+    // A state can only be loaded into a console running the same cartridge with the same controllers connected, and
+    // only the ppu's state machine core is supported (dot_ppu). Neither saving nor loading allocates.
+    static constexpr uint32_t state_version = 3;
+    size_t state_size();
+    // returns the size of the state, 0 if it couldn't be saved (e.g. capacity is smaller than state_size())
+    size_t save_state(uint8_t* buffer, size_t capacity);
+    bool   load_state(const uint8_t* buffer, size_t size);
+    // Clones another console running the same cartridge (e.g. loaded from its cart_data) : both then run on exactly
+    // as the other one would from there, to explore several futures of a game. Only the state is copied, through
+    // a save state kept by this console : the cost of a save and a load, a few µs, with no allocation once the first
+    // one is done. The other console is run up to its next instruction boundary, as by save_state().
+    bool   copy_state_from(Console& other);
+    // Run-ahead, to hide the latency of games that only react to the input a frame or more after reading it : runs the
+    // next frame like run_frame(), then the 'frames' next ones with the same input, drawing only the last one, and
+    // goes back to the state saved after the first one. Costs a save, a load and 'frames' more frames, timed in
+    // run_ahead_seconds. False if the state couldn't be saved, only the first frame being run and shown, or loaded back.
+    // The framebuffer is then the frame drawn 'frames' ahead, not the one of the state the console is back at : a
+    // Movie::hash() taken there won't match the same frame run without run-ahead, movies can't be run ahead.
+    bool   run_frame_ahead(unsigned frames);
+
+public:
+    std::unique_ptr<Mapper> mapper;
+    InputAdapter input;
+    PPU     ppu;
+    PPUCtrlRegs ppu_regs { ppu };
+    CPU     cpu { *this };
+    IORegs io_regs { cpu, nullptr, ppu, input };
+
+    AddressSpace cpu_space;
+
+    RAM<0x0800> nes_ram;
+    RAM<0x0100> palette_ram;
+
+    std::array<RAM<0x0400>, 4> nametables;
+
+    bool           cart_loaded { false };
+    cartridge_data cart_data;
+    size_t total_cycles { 0 };
+
+    // fast-forward through idle loops (e.g. waiting for the NMI), the emulation stays cycle-exact
+    bool   skip_idle_loops { true };
+    // run the code in PRG-ROM from the cpu's decoded instructions (see basic_cpu6502::decoded_op) rather than fetching
+    // and decoding it again each time, both give the same results ; takes effect on the next reset
+    bool   decode_rom_code { true };
+    // also compile the code run most often to native code (see jit6502), where the host supports it ; it only runs in
+    // catch-up mode, between the cpu's syncs with the ppu, and gives the same results ; takes effect on the next reset
+    bool   compile_rom_code { false };
+    size_t idle_cycles_skipped { 0 }; // cpu cycles not emulated thanks to skip_idle_loops
+    double run_ahead_seconds { 0 };   // time spent running ahead by run_frame_ahead(), save and load included
+
+    // run the ppu as a state machine (PPU::run_dots) rather than on a coroutine (PPU::render_frame), both give the same
+    // results ; takes effect on the next init(), soft_reset() or power_cycle()
+    bool   dot_ppu { true };
+
+private:
+    struct Scheduler;
+    friend struct Scheduler;
+    friend struct cpu_bus;
+
+    void serialize(StateStream& stream);
+
+    size_t oam_decay_cycles { 0 };
+    std::unique_ptr<Scheduler> m_scheduler;
+    std::vector<uint8_t> m_scratch_state; // see copy_state_from() and run_frame_ahead()
+};
 
 }
 
+extern template class basic_cpu6502<NES::cpu_bus>;
+
 #endif // NES_HPP
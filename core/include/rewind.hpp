@@ -0,0 +1,100 @@
+/*
+rewind.hpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef REWIND_HPP
+#define REWIND_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "nes.hpp"
+
+namespace NES
+{
+
+// The states of the last frames of a console, to go back in time. Every keyframe_interval captures the state is kept
+// whole (a keyframe), the others only as their difference with the last keyframe (XOR), both run-length encoded :
+// from one frame to the next most of RAM, the nametables and CHR RAM stay the same, so a state takes a few hundred
+// bytes. The states are kept in a ring buffer of a fixed size, the oldest ones making room for the new ones.
+// Nothing is allocated after construction.
+class RewindBuffer
+{
+public:
+    RewindBuffer(Console& nes, size_t capacity, size_t max_frames, unsigned keyframe_interval = 30);
+
+    // to be called once per frame, after run_frame() : false if the state couldn't be saved or is larger than the buffer
+    bool capture();
+    // Loads the state captured 'frames' captures before the last one, which becomes the last one : the newer ones are
+    // dropped. Only decodes the state and its keyframe. False if fewer frames are kept.
+    bool rewind(size_t frames);
+
+    // captured states still kept
+    size_t frames() const
+    { return m_next - m_first; }
+    // bytes used by them, out of capacity()
+    size_t bytes_used() const
+    { return m_used; }
+    size_t capacity() const
+    { return m_ring.size(); }
+
+    struct rewind_stats
+    {
+        size_t captures  { 0 };
+        size_t keyframes { 0 };
+        size_t evicted   { 0 }; // states dropped to make room
+        double capture_seconds { 0 }; // time spent in capture()
+    } stats;
+
+private:
+    struct entry
+    {
+        size_t offset, size; // in m_ring
+        size_t keyframe;     // number of the capture holding its keyframe
+    };
+
+    entry& at(size_t capture)
+    { return m_entries[capture % m_entries.size()]; }
+    static constexpr size_t no_room = SIZE_MAX;
+    size_t make_room(size_t size);
+    void   push(size_t offset, size_t size, size_t keyframe);
+    void   evict_oldest();
+
+private:
+    Console& m_nes;
+    const unsigned m_keyframe_interval;
+
+    std::vector<uint8_t> m_ring;
+    std::vector<entry>   m_entries;
+    size_t m_first { 0 }, m_next { 0 }; // numbers of the oldest capture kept and of the next one
+    size_t m_head  { 0 };               // where the next state goes in m_ring
+    size_t m_used  { 0 };
+
+    std::vector<uint8_t> m_state;    // the state being captured or restored
+    std::vector<uint8_t> m_keyframe; // the state of the keyframe of the last capture
+    std::vector<uint8_t> m_encoded;  // the state being captured, encoded
+};
+
+}
+
+#endif // REWIND_HPP
@@ -0,0 +1,212 @@
+/*
+movie.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#include "movie.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace NES
+{
+namespace
+{
+constexpr uint32_t movie_magic = 0x564D454E; // "NEMV"
+
+// Four interleaved lanes of 64-bit multiply-rotate rounds (as in xxHash64) : hashing the framebuffer on every frame
+// takes a few µs
+class hasher
+{
+public:
+    void update(const uint8_t* data, size_t size)
+    {
+        m_length += size;
+
+        size_t pos { 0 };
+        for (; pos + 32 <= size; pos += 32)
+        {
+            for (unsigned lane { 0 }; lane < 4; ++lane)
+                round(m_lanes[lane], word(data + pos + lane*8));
+        }
+        for (; pos + 8 <= size; pos += 8)
+            round(m_lanes[0], word(data + pos));
+        for (; pos < size; ++pos)
+            round(m_lanes[1], data[pos]);
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t hash = rotl(m_lanes[0], 1) + rotl(m_lanes[1], 7) + rotl(m_lanes[2], 12) + rotl(m_lanes[3], 18);
+        hash ^= m_length;
+
+        hash ^= hash >> 33; hash *= prime2;
+        hash ^= hash >> 29; hash *= prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static constexpr uint64_t prime1 = 0x9E3779B185EBCA87;
+    static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+    static constexpr uint64_t prime3 = 0x165667B19E3779F9;
+
+    static uint64_t rotl(uint64_t value, unsigned bits)
+    { return (value << bits) | (value >> (64 - bits)); }
+    static uint64_t word(const uint8_t* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, 8);
+        return value;
+    }
+    static void round(uint64_t& lane, uint64_t value)
+    { lane = rotl(lane + value*prime2, 31) * prime1; }
+
+private:
+    uint64_t m_lanes[4] { prime1 + prime2, prime2, 0, uint64_t(0) - prime1 };
+    uint64_t m_length { 0 };
+};
+
+// one bit per button, in the order the controller reports them
+uint8_t pack(const StandardController::State& input)
+{
+    const bool buttons[8] { input.a, input.b, input.select, input.start, input.up, input.down, input.left, input.right };
+
+    uint8_t packed { 0 };
+    for (unsigned i { 0 }; i < 8; ++i)
+        packed |= buttons[i] << i;
+    return packed;
+}
+
+StandardController::State unpack(uint8_t packed)
+{
+    const auto button = [packed](unsigned i) { return bool((packed >> i) & 1); };
+    return {button(0), button(1), button(2), button(3), button(4), button(5), button(6), button(7)};
+}
+}
+
+uint64_t Movie::hash(const Console& nes)
+{
+    hasher state;
+    state.update(nes.nes_ram.m_data.data(), nes.nes_ram.m_data.size());
+    state.update(nes.ppu.framebuffer.data(), nes.ppu.framebuffer.size());
+    return state.digest();
+}
+
+uint64_t Movie::hash_rom(const cartridge_data& cart)
+{
+    const uint32_t mapper = cart.mapper;
+
+    hasher state;
+    state.update(reinterpret_cast<const uint8_t*>(&mapper), sizeof(mapper));
+    state.update(cart.prg_rom.data(), cart.prg_rom.size());
+    state.update(cart.chr_rom.data(), cart.chr_rom.size());
+    return state.digest();
+}
+
+void Movie::record(const Console& nes, const StandardController::State& input)
+{
+    if (frames.empty())
+        rom_hash = hash_rom(nes.cart_data);
+
+    frames.push_back({input, hash(nes)});
+}
+
+// Header : magic, version, rom hash and frame count, then for each frame the buttons held and the hash
+bool Movie::save(const std::string& path) const
+{
+    std::vector<uint8_t> data;
+    const auto append = [&data](const auto& value)
+    {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(value));
+    };
+
+    append(movie_magic); append(version);
+    append(rom_hash);
+    append(uint64_t(frames.size()));
+    for (const auto& frame : frames)
+    {
+        append(pack(frame.input));
+        append(frame.hash);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    return bool(file.write(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+bool Movie::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> data { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    size_t pos { 0 };
+    const auto extract = [&data, &pos](auto& value)
+    {
+        if (pos + sizeof(value) > data.size())
+            return false;
+        memcpy(&value, data.data() + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    };
+
+    uint32_t magic, file_version;
+    uint64_t hash, count;
+    if (!extract(magic) || !extract(file_version) || !extract(hash) || !extract(count) ||
+        magic != movie_magic || file_version != version || (data.size() - pos) / 9 != count || (data.size() - pos) % 9)
+    {
+        return false;
+    }
+
+    rom_hash = hash;
+    frames.resize(count);
+    for (auto& frame : frames)
+    {
+        uint8_t buttons { 0 };
+        extract(buttons); extract(frame.hash);
+        frame.input = unpack(buttons);
+    }
+
+    return true;
+}
+
+MoviePlayer::MoviePlayer(const Movie& movie, Console& nes, StandardController& controller)
+    : m_movie(movie), m_nes(nes), m_controller(controller)
+{
+    m_wrong_game = !nes.cart_loaded || Movie::hash_rom(nes.cart_data) != movie.rom_hash;
+}
+
+bool MoviePlayer::run_frame()
+{
+    if (m_wrong_game || m_diverged || finished())
+        return false;
+
+    const auto& frame = m_movie.frames[m_frame++];
+    m_controller.state = frame.input;
+    m_nes.run_frame();
+
+    m_diverged = Movie::hash(m_nes) != frame.hash;
+    return !m_diverged;
+}
+
+}
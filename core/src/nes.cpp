@@ -24,83 +24,442 @@ SOFTWARE.
 */
 
 #include "nes.hpp"
+#include "cpu/include/cpu_impl.hpp"
 
 #include "clock.hpp"
 #include "common/parallel_stepper.hpp"
 #include "common/fsutils.hpp"
 
-#include "ppu/include/ppu.hpp"
-#include "ppu/include/ppu_regs.hpp"
-#include "cpu/include/cpu.hpp"
-#include "cpu/include/io_regs.hpp"
-#include "input/include/inputadapter.hpp"
-#include "nesloader/include/nesloader.hpp"
 #include "mappers/include/mapper_list.hpp"
 #include "mappers/include/mapper_base.hpp"
 
+#include <chrono>
+#include <cstring>
+
 namespace NES
 {
-namespace internal
-{
-static uint8_t cpu6502_read(uint16_t addr)
-{
-    return cpu_space.read(addr);
-}
-static void cpu6502_write(uint16_t addr, uint8_t val)
+namespace
 {
-    cpu_space.write(addr, val);
-}
-}
-
-size_t total_cycles;
-size_t oam_decay_cycles;
-bool cart_loaded = false;
-cartridge_data cart_data;
-
-RAM<0x0400> nt1, nt2, nt3, nt4;
-Mapper* mapper { nullptr };
-InputAdapter input;
-PPU     ppu;
-PPUCtrlRegs ppu_regs { ppu };
-cpu6502 cpu {internal::cpu6502_read, internal::cpu6502_write};
-IORegs io_regs{cpu, nullptr, ppu, input};
-
-AddressSpace cpu_space;
-
-RAM<0x0800> nes_ram;
-RAM<0x0100> palette_ram;
+constexpr size_t oam_decay_period = 12886364; // 600 msec
+constexpr uint32_t state_magic = 0x5453454E; // "NEST"
+// the cpu and the ppu switch several times per cpu cycle : with a stack each, a switch doesn't have to copy stack contents
+constexpr StepperStacks console_stacks { StepperStacks::Private, 64*1024 };
 
 struct CPUReceiver : public DividedClockReceiver<12>
 {
+    CPUReceiver(CPU& cpu) : cpu(cpu) {}
+
     void on_active_clock() override
     {
         cpu.run(1000);
     };
+
+    CPU& cpu;
 };
 struct PPUReceiver : public DividedClockReceiver<4>
 {
+    PPUReceiver(PPU& ppu) : ppu(ppu) {}
+
     void on_active_clock() override
     {
         ppu.render_frame();
     };
+
+    PPU& ppu;
 };
 
-CPUReceiver cpu_rcv;
-PPUReceiver ppu_rcv;
+// copies the pattern tables as the ppu sees them, false if a page of them isn't plain memory
+bool read_pattern_tables(const AddressSpace& space, std::array<uint8_t, 0x2000>& patterns)
+{
+    for (unsigned page { 0 }; page < patterns.size(); page += 0x100)
+    {
+        const uint8_t* data = space.direct_page(page);
+        if (!data)
+            return false;
+        std::memcpy(patterns.data() + page, data, 0x100);
+    }
+    return true;
+}
+}
+
+struct Console::Scheduler
+{
+    Scheduler(Console& console)
+        : nes(console), cpu_rcv{console.cpu}, ppu_rcv{console.ppu}, stepper{console_stacks, cpu_rcv, ppu_rcv}
+    {}
+
+    Console& nes;
+
+    CPUReceiver cpu_rcv;
+    PPUReceiver ppu_rcv;
+
+    ParallelStepper<CPUReceiver, PPUReceiver> stepper;
+
+    SyncMode sync_mode { SyncMode::Lockstep };
+
+    // catch-up scheduling state
+    bool     in_cpu_burst { false };
+    unsigned cpu_cycles_at_reset { 0 }; // value of cpu.cycles when the stepper was last reset
+    unsigned ppu_frames_at_reset { 0 };
+    unsigned ppu_slots { 0 };      // number of cpu cycles the ppu has been brought up to
+    unsigned stalled_slots { 0 };  // cpu cycles spent stalled by OAM DMA
+    unsigned pending_stall { 0 };  // cpu cycles of OAM DMA stall yet to be run
+    unsigned pending_idle { 0 };   // skipped idle loop cycles yet to be run, left over by a switch from lockstep mode
+    bool     idle_stall { false }; // the cpu coroutine's skip count comes from an idle loop skip rather than from OAM DMA
+    bool     ppu_dots { false };   // the ppu runs as a state machine rather than on its coroutine
+
+    coroutine& cpu_co() { return stepper.m_coroutines[0].co; }
+    coroutine& ppu_co() { return stepper.m_coroutines[1].co; }
+
+    // the state requested by save_state(), taken by the cpu coroutine at its next instruction boundary
+    uint8_t* state_buffer   { nullptr };
+    size_t   state_capacity { 0 };
+    size_t   state_saved    { 0 };
+
+    void take_state()
+    {
+        // a stall (OAM DMA, skipped idle loop) isn't over : the cpu can't be resumed from here
+        if (cpu_co().co->skip_count || pending_stall || pending_idle)
+            return;
+
+        sync_ppu();
+        nes.ppu.flush_scanline();
+
+        StateStream stream(state_buffer, state_capacity);
+        nes.serialize(stream);
+        state_saved = stream.failed() ? 0 : stream.size();
+        nes.cpu.bus.state_requested = false;
+    }
+
+    // the cpu starts over from the instruction boundary the loaded state was taken at, the ppu goes on from its dot
+    void restart_from_state(bool lines_known)
+    {
+        restart_co(cpu_co());
+        for (auto& entry : stepper.m_coroutines)
+            entry.cur_clock = 0;
+
+        cpu_cycles_at_reset = nes.cpu.cycles;
+        ppu_frames_at_reset = lines_known ? nes.ppu.frames - 1 : nes.ppu.frames;
+        ppu_slots = stalled_slots = pending_stall = pending_idle = 0;
+        idle_stall = false;
+    }
+
+    void sync_ppu()
+    {
+        // hand control back to the scheduler so it brings the ppu up to date before the access
+        if (in_cpu_burst)
+        {
+            co_yield();
+        }
+    }
+
+    unsigned cpu_slot()
+    {
+        return nes.cpu.cycles - cpu_cycles_at_reset + stalled_slots;
+    }
+
+    void reset()
+    {
+        coroutines_init();
+        stepper.reset(); // reset coroutines state
+        nes.io_regs.m_cpu_co = cpu_co().co;
+        ppu_dots = nes.dot_ppu;
+        nes.ppu.restart_frame();
+
+        cpu_cycles_at_reset = nes.cpu.cycles;
+        ppu_frames_at_reset = nes.ppu.frames;
+        ppu_slots = stalled_slots = pending_stall = pending_idle = 0;
+        idle_stall = false;
+    }
+
+    // consoles can be handed over to another thread between two runs
+    void bind_to_current_thread()
+    {
+        if (cpu_co().co->main_co != main_coroutine)
+        {
+            coroutines_init();
+            stepper.bind_to_current_thread();
+        }
+    }
+
+    // Lower bound of the number of ppu dots left before the ppu enters scanline 241, where vblank is set and NMIs are raised.
+    size_t ppu_dots_until_vblank()
+    {
+        // the scanline counter is only meaningful once the ppu went through a whole frame since the last reset
+        if (nes.ppu.frames == ppu_frames_at_reset)
+            return 0;
+
+        // a scanline takes at least 340 dots
+        const size_t line = nes.ppu.m_current_line;
+        if (line == 241 && nes.ppu.m_clocks == 0) // vblank isn't set yet
+            return 0;
+        else if (line <= 240)
+            return 1 + (240 - line)*340;
+        else
+            return 1 + (261 - line)*340 + 241*340;
+    }
+
+    void catch_up_ppu()
+    {
+        unsigned behind = cpu_slot() - ppu_slots;
+        while (behind)
+        {
+            // oam decay is handled with cpu cycle granularity, as in lockstep mode
+            const size_t slots = std::min<size_t>(behind, (oam_decay_period - nes.oam_decay_cycles + 11) / 12);
+
+            run_ppu(slots*3);
+
+            ppu_slots += slots; behind -= slots;
+            nes.total_cycles += slots*12; nes.oam_decay_cycles += slots*12;
+            if (nes.oam_decay_cycles >= oam_decay_period)
+            {
+                nes.ppu_regs.clear_decay();
+                nes.oam_decay_cycles = 0;
+            }
+        }
+    }
+
+    // the ppu's dots, advancing whichever core runs it
+    void run_ppu(size_t dots)
+    {
+        if (ppu_dots)
+            nes.ppu.run_dots(dots);
+        else
+            run_co_for(ppu_co(), dots);
+    }
+
+    // one master clock
+    void step()
+    {
+        if (!ppu_dots)
+        {
+            stepper.step();
+            return;
+        }
+
+        for (auto& entry : stepper.m_coroutines)
+        {
+            if (++entry.cur_clock == entry.clock_rate)
+            {
+                entry.cur_clock = 0;
+                if (&entry.co == &ppu_co())
+                    nes.ppu.run_dots(1);
+                else
+                    run_co(entry.co);
+            }
+        }
+    }
+
+    void step_whole()
+    {
+        if (ppu_dots)
+        {
+            // what the stepper does over a cpu cycle : the cpu, then the three ppu dots
+            run_co(cpu_co());
+            nes.ppu.run_dots(3);
+        }
+        else
+        {
+            stepper.step_whole();
+        }
+        nes.total_cycles += 12; nes.oam_decay_cycles += 12;
+        // handle oam data decay
+        if (nes.oam_decay_cycles >= oam_decay_period)
+        {
+            nes.ppu_regs.clear_decay();
+            nes.oam_decay_cycles = 0;
+        }
+    }
+
+    // The cpu is spinning in an idle loop : skip as many whole iterations as possible before the ppu could raise an NMI.
+    // The cpu cycle counter is moved forward as if the iterations had been run, so the loop is left on the exact same cycle.
+    void skip_idle_loop(unsigned iteration_cycles)
+    {
+        // in catch-up mode the ppu lags behind the cpu by the current burst
+        const size_t lag  = (sync_mode == SyncMode::CatchUp) ? cpu_slot() - ppu_slots : 0;
+        // keep the cycle being run and the next one out of the skip, so the NMI can't land inside it
+        const size_t safe = lag + 2;
+        size_t left = ppu_dots_until_vblank()/3;
+        if (in_cpu_burst)
+        {
+            // the burst must still end on its last cycle
+            left = std::min<size_t>(left, nes.cpu.bus.sync_cycle - nes.cpu.cycles + lag);
+        }
+        if (left <= safe)
+            return;
+
+        const unsigned skipped = (left - safe) / iteration_cycles * iteration_cycles;
+        if (skipped == 0)
+            return;
+
+        nes.cpu.cycles += skipped;
+        if (sync_mode == SyncMode::Lockstep)
+        {
+            // the cpu sits out the skipped cycles as a stall, like OAM DMA
+            co_set_skip(cpu_co().co, skipped);
+            idle_stall = true;
+        }
+        // in catch-up mode the ppu simply has more cycles to catch up with
+
+        nes.idle_cycles_skipped += skipped;
+    }
+
+    void run_cpu_for(unsigned slots)
+    {
+        const unsigned end = cpu_slot() + slots;
+        while (unsigned remaining = end - cpu_slot())
+        {
+            if (pending_stall)
+            {
+                const unsigned stall = std::min(remaining, pending_stall);
+                pending_stall -= stall; stalled_slots += stall;
+                catch_up_ppu();
+                continue;
+            }
+            if (pending_idle)
+            {
+                const unsigned idle = std::min(remaining, pending_idle);
+                pending_idle -= idle; nes.cpu.cycles += idle;
+                catch_up_ppu();
+                continue;
+            }
+
+            // a burst can't overshoot an NMI : it stops at the latest on the cpu cycle during which vblank could begin
+            const size_t budget = std::min<size_t>(remaining, std::max<size_t>(1, ppu_dots_until_vblank()/3));
+            nes.cpu.bus.sync_cycle = nes.cpu.cycles + budget;
+
+            in_cpu_burst = true;
+            run_co(cpu_co());
+            in_cpu_burst = false;
+
+            catch_up_ppu();
+
+            // OAM DMA stalls are requested through the cpu coroutine's skip count
+            pending_stall += cpu_co().co->skip_count;
+            cpu_co().co->skip_count = 0;
+        }
+    }
+};
+
+uint8_t cpu_bus::read(uint16_t addr)
+{
+    if (addr >= 0x2000 && addr < 0x4000) // PPU registers
+    {
+        nes.m_scheduler->sync_ppu();
+    }
+    if (!nes.cpu_space.side_effect_free(addr))
+    {
+        nes.cpu.note_side_effect();
+    }
+    return nes.cpu_space.read(addr);
+}
+void cpu_bus::write(uint16_t addr, uint8_t val)
+{
+    // PPU registers, OAM DMA and mapper registers (bank switching, mirroring)
+    if ((addr >= 0x2000 && addr < 0x4000) || addr == 0x4014 || addr >= 0x8000)
+    {
+        nes.m_scheduler->sync_ppu();
+    }
+    // cartridge space : anything but a RAM write can remap CHR or the nametables
+    const bool remaps = addr >= 0x4020 && !nes.cpu_space.ram_write(addr);
+    if (remaps)
+    {
+        nes.ppu.flush_scanline();
+    }
+    nes.cpu_space.write(addr, val);
+    if (remaps)
+    {
+        nes.ppu.remap();
+        nes.cpu.remap_code();
+    }
+
+    if (addr == 0x4014)
+    {
+        // the cpu coroutine's skip count is now an OAM DMA stall
+        nes.m_scheduler->idle_stall = false;
+        if (nes.m_scheduler->in_cpu_burst)
+        {
+            // OAM DMA stalls the cpu : end the burst with this cycle so the scheduler can account for it
+            sync_cycle = nes.cpu.cycles + 1;
+        }
+    }
+}
+
+void cpu_bus::cycle()
+{
+    if (!free_running || nes.cpu.cycles == sync_cycle)
+    {
+        co_yield();
+    }
+}
+
+void cpu_bus::idle_loop(unsigned iteration_cycles)
+{
+    if (nes.skip_idle_loops)
+    {
+        nes.m_scheduler->skip_idle_loop(iteration_cycles);
+    }
+}
+
+void cpu_bus::instruction_boundary()
+{
+    if (state_requested)
+    {
+        nes.m_scheduler->take_state();
+    }
+}
+
+const uint8_t* cpu_bus::code_page(uint16_t addr)
+{
+    // PRG-ROM, whose reads have no side-effect and don't need the ppu to be up to date
+    return nes.decode_rom_code ? nes.cpu_space.rom_page(addr) : nullptr;
+}
+
+void cpu_bus::latch(uint8_t val)
+{
+    nes.cpu_space.latch(val);
+}
+
+unsigned cpu_bus::quiet_cycles() const
+{
+    // cycle() only yields on sync_cycle when free running, instruction_boundary() only does something for a state
+    return free_running && !state_requested ? sync_cycle - nes.cpu.cycles - 1 : 0;
+}
+
+const uint8_t* cpu_bus::read_page(uint16_t addr)
+{
+    // RAM and PRG-ROM, the reads from the direct modules have no side-effect and don't need the ppu to be up to date
+    return nes.cpu_space.direct_page(addr);
+}
+
+uint8_t* cpu_bus::write_page(uint16_t addr)
+{
+    // the writes to cartridge space above $8000 sync the ppu first, see write()
+    return addr < 0x8000 ? nes.cpu_space.ram_page(addr) : nullptr;
+}
+
+Console::Console()
+{
+    coroutines_init(); // the scheduler's coroutines are created on this thread
+    m_scheduler = std::make_unique<Scheduler>(*this);
+}
 
-ParallelStepper stepper{cpu_rcv, ppu_rcv};
+Console::~Console() = default;
 
-void init()
+void Console::init()
 {
-    stepper.reset();
+    m_scheduler->reset();
+    mapper.reset();
     cart_loaded = false;
 
-    oam_decay_cycles = total_cycles = 0;
+    oam_decay_cycles = total_cycles = idle_cycles_skipped = 0;
+    cpu.code_stats = {};
+    cpu.clear_decoded();
     cpu_space.clear();
     ppu.addr_space.clear();
+    ppu.chr_cache.clear();
 
     ppu.cpu = &cpu;
-    io_regs.m_cpu_co = stepper.m_coroutines[1].co.co;
 
     nes_ram.m_data.fill(0);
 
@@ -114,85 +473,293 @@ void init()
     ppu.addr_space.add_port(memory_port{&palette_ram, 0x3F00});
 }
 
-void soft_reset()
+void Console::soft_reset()
 {
     total_cycles = 0;
+    cpu.enable_jit(compile_rom_code && decode_rom_code);
+    cpu.remap_code();
     cpu.reset(); ppu_regs.reset(); ppu.reset();
-    stepper.reset(); // reset coroutines state
+    m_scheduler->reset();
 }
 
-void power_cycle()
+void Console::power_cycle()
 {
     oam_decay_cycles = 0;
     soft_reset();
 }
 
-void run_frame()
+void Console::run_frame()
 {
+    m_scheduler->bind_to_current_thread();
+
+    if (m_scheduler->sync_mode == SyncMode::CatchUp)
+    {
+        m_scheduler->run_cpu_for((341*4/12)*241);
+        while (ppu.m_current_line != 241)
+        {
+            m_scheduler->run_cpu_for(std::max<size_t>(1, m_scheduler->ppu_dots_until_vblank()/3));
+        }
+        return;
+    }
+
     // run until vblank then draw frame to prevent rendering artifacts
     for (size_t i { 0 }; i < (341*4/12)*241; ++i) // cpu clocks per scanline * 241
     {
-        run_cpu_cycle();
+        m_scheduler->step_whole();
     }
 
     // run until scanline 241 is actually reached
     while (ppu.m_current_line != 241)
     {
-        run_cpu_cycle();
+        m_scheduler->step_whole();
     }
 }
 
-void run_cpu_cycle()
+void Console::run_cpu_cycle()
 {
-    stepper.step_whole();
-    total_cycles += 12; oam_decay_cycles += 12;
-    // handle oam data decay
-    if (oam_decay_cycles >= 12886364) // 600 msec
+    m_scheduler->bind_to_current_thread();
+
+    if (m_scheduler->sync_mode == SyncMode::CatchUp)
     {
-        ppu_regs.clear_decay();
-        oam_decay_cycles = 0;
+        m_scheduler->run_cpu_for(1);
+        return;
     }
+
+    m_scheduler->step_whole();
 }
 
-void run_ppu_cycle()
+void Console::run_ppu_cycle()
 {
+    m_scheduler->bind_to_current_thread();
+
     // FIXME : further step_whole() will not take in account cycle clocks taken here, fix
-    stepper.step();
+    m_scheduler->step();
+}
+
+void Console::set_sync_mode(SyncMode mode)
+{
+    auto& sched = *m_scheduler;
+
+    // both modes leave the ppu up to date with the cpu between calls, only pending stalls need to be carried over
+    if (mode == SyncMode::CatchUp && sched.sync_mode == SyncMode::Lockstep)
+    {
+        const unsigned skip_count = sched.cpu_co().co->skip_count;
+        if (sched.idle_stall)
+        {
+            // the cpu already counted the skipped idle loop cycles
+            cpu.cycles -= skip_count;
+            sched.pending_idle = skip_count;
+        }
+        else
+        {
+            sched.pending_stall = skip_count;
+        }
+        sched.cpu_co().co->skip_count = 0;
+    }
+    else if (mode == SyncMode::Lockstep && sched.sync_mode == SyncMode::CatchUp)
+    {
+        co_set_skip(sched.cpu_co().co, sched.pending_stall + sched.pending_idle);
+        cpu.cycles += sched.pending_idle;
+        sched.idle_stall = (sched.pending_idle != 0);
+        sched.pending_stall = sched.pending_idle = 0;
+    }
+
+    sched.ppu_slots = sched.cpu_slot();
+    sched.sync_mode = mode;
+    cpu.bus.free_running = (mode == SyncMode::CatchUp);
+}
+
+size_t Console::state_size()
+{
+    if (!cart_loaded)
+        return 0;
+
+    StateStream stream;
+    serialize(stream);
+    return stream.size();
 }
 
-void set_mirroring(const mirroring_config &config)
+size_t Console::save_state(uint8_t* buffer, size_t capacity)
 {
+    auto& sched = *m_scheduler;
+    if (!cart_loaded || !sched.ppu_dots || capacity < state_size())
+        return 0;
+
+    sched.state_buffer = buffer; sched.state_capacity = capacity;
+    cpu.bus.state_requested = true;
+    while (cpu.bus.state_requested)
+    {
+        run_cpu_cycle();
+    }
+
+    return sched.state_saved;
+}
+
+bool Console::load_state(const uint8_t* buffer, size_t size)
+{
+    // checked before anything is loaded
+    if (!cart_loaded || !m_scheduler->ppu_dots || size != state_size())
+        return false;
+
+    // the tiles decoded by the ppu are kept unless the state changes CHR RAM, bank switches are caught by remap()
+    std::array<uint8_t, 0x2000> patterns, loaded_patterns;
+    const bool patterns_known = read_pattern_tables(ppu.addr_space, patterns);
+
+    StateStream stream(buffer, size);
+    serialize(stream);
+    if (stream.failed())
+        return false;
+
+    if (!patterns_known || !read_pattern_tables(ppu.addr_space, loaded_patterns) || patterns != loaded_patterns)
+    {
+        ppu.chr_cache.clear();
+        ppu.remap();
+    }
+    return true;
+}
+
+bool Console::copy_state_from(Console& other)
+{
+    const size_t size = other.state_size();
+    if (m_scratch_state.size() < size)
+        m_scratch_state.resize(size);
+
+    return other.save_state(m_scratch_state.data(), size) && load_state(m_scratch_state.data(), size);
+}
+
+bool Console::run_frame_ahead(unsigned frames)
+{
+    // drawn like any other frame : it stays on screen if the frames ahead can't be run
+    run_frame();
+
+    const size_t size = frames ? state_size() : 0;
+    if (!size)
+        return !frames;
+    if (m_scratch_state.size() < size)
+        m_scratch_state.resize(size);
+
+    const auto start = std::chrono::steady_clock::now();
+    if (save_state(m_scratch_state.data(), size) != size)
+        return false;
+
+    const unsigned frameskip = ppu.frameskip;
+    for (unsigned i { 1 }; i <= frames; ++i)
+    {
+        ppu.frameskip = i == frames ? frameskip : PPU::skip_all_frames;
+        run_frame();
+    }
+    ppu.frameskip = frameskip;
+    const bool loaded = load_state(m_scratch_state.data(), size);
+
+    run_ahead_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return loaded;
+}
+
+void Console::serialize(StateStream& stream)
+{
+    // the format, the cartridge and the controllers the state belongs to : once they match, as the size of the state
+    // was checked, nothing can make the load fail halfway
+    const std::array<uint32_t, 6> expected { state_magic, state_version, cart_data.mapper,
+                                             uint32_t(cart_data.prg_rom.size()), uint32_t(cart_data.chr_rom.size()),
+                                             input.connected() };
+    auto header = expected;
+    stream.io(header);
+    if (header != expected)
+    {
+        stream.fail();
+        return;
+    }
+
+    cpu.serialize(stream);
+    stream.io(total_cycles);
+    stream.io(oam_decay_cycles);
+    stream.io(nes_ram.m_data);
+    stream.io(palette_ram.m_data);
+    for (auto& nametable : nametables)
+    {
+        // only the rows a state load changes are marked as written, the ppu keeps reusing the backgrounds of the others
+        if (const uint8_t* loaded = stream.peek(nametable.m_data.size()))
+        {
+            for (unsigned offset { 0 }; offset < nametable.m_data.size(); offset += 32)
+            {
+                if (std::memcmp(nametable.m_data.data() + offset, loaded + offset, 32))
+                    ppu.nametable_write(nametable.m_data.data() + (offset & 0x300), offset);
+            }
+        }
+        stream.io(nametable.m_data);
+    }
+    ppu.serialize(stream);
+    ppu_regs.serialize(stream);
+    input.serialize(stream);
+    mapper->serialize(stream);
+
+    // whether the ppu's scanline counter can be relied on yet, see Scheduler::ppu_dots_until_vblank()
+    bool lines_known = ppu.frames != m_scheduler->ppu_frames_at_reset;
+    stream.io(lines_known);
+
+    if (stream.loading() && !stream.failed())
+    {
+        // the banks and the mirroring may have changed, CHR RAM is checked by load_state()
+        ppu.remap();
+        cpu.remap_code();
+        m_scheduler->restart_from_state(lines_known);
+    }
+}
+
+SyncMode Console::sync_mode() const
+{
+    return m_scheduler->sync_mode;
+}
+
+void Console::set_mirroring(const mirroring_config &config)
+{
+    // mappers set it again on every bank switch and state load : only rebuild the address space on an actual change
+    const std::array<uint8_t, 4> quadrants { config.top_left, config.top_right, config.bottom_left, config.bottom_right };
+    bool mapped = true;
+    for (unsigned i { 0 }; i < 4; ++i)
+    {
+        mapped &= ppu.addr_space.direct_page(0x2000 + i*0x400) == nametables[quadrants[i]].m_data.data();
+    }
+    if (mapped)
+        return;
+
     // clear existing mirroring configuration
     ppu.addr_space.remove_port(0x2000);
     ppu.addr_space.remove_port(0x2400);
     ppu.addr_space.remove_port(0x2800);
     ppu.addr_space.remove_port(0x2C00);
 
-    ppu.addr_space.add_port(memory_port{&config.top_left, 0x2000});
-    ppu.addr_space.add_port(memory_port{&config.top_right, 0x2400});
-    ppu.addr_space.add_port(memory_port{&config.bottom_left, 0x2800});
-    ppu.addr_space.add_port(memory_port{&config.bottom_right, 0x2C00});
+    ppu.addr_space.add_port(memory_port{&nametables[config.top_left], 0x2000});
+    ppu.addr_space.add_port(memory_port{&nametables[config.top_right], 0x2400});
+    ppu.addr_space.add_port(memory_port{&nametables[config.bottom_left], 0x2800});
+    ppu.addr_space.add_port(memory_port{&nametables[config.bottom_right], 0x2C00});
 }
 
-bool set_mapper(unsigned mapper_idx)
+bool Console::set_mapper(unsigned mapper_idx)
 {
     if (mapper_idx >= mapper_list.size())
         return false;
 
-    mapper = mapper_list[mapper_idx];
-    if (mapper == nullptr)
+    if (mapper_list[mapper_idx] == nullptr)
         return false;
-    else
-        return true;
+
+    mapper = mapper_list[mapper_idx](*this);
+    cpu.clear_decoded(); // what was decoded belonged to the previous mapper's ROM
+    return true;
 }
 
-bool load_cartridge(const std::string &path)
+bool Console::load_cartridge(const std::string &path)
+{
+    return load_cartridge(load_nes_file(path));
+}
+
+bool Console::load_cartridge(const cartridge_data& cart)
 {
-    auto cart = load_nes_file(path);
     if (!set_mapper(cart.mapper))
         return false;
 
     mapper->init(cart);
+    ppu.remap();
 
     cart_data = cart;
     cart_loaded = true;
@@ -200,7 +767,7 @@ bool load_cartridge(const std::string &path)
     return true;
 }
 
-bool load_game_battery_save_data()
+bool Console::load_game_battery_save_data()
 {
     assert(cart_loaded);
     assert(mapper != nullptr);
@@ -223,7 +790,7 @@ bool load_game_battery_save_data()
     return true;
 }
 
-bool save_game_battery_save_data()
+bool Console::save_game_battery_save_data()
 {
     assert(cart_loaded);
     assert(mapper != nullptr);
@@ -244,3 +811,5 @@ bool save_game_battery_save_data()
 }
 
 }
+
+template class basic_cpu6502<NES::cpu_bus>;
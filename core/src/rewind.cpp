@@ -0,0 +1,265 @@
+/*
+rewind.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#include "rewind.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace NES
+{
+namespace
+{
+// Run-length encoding of mostly zero data : a control byte below 0x80 is followed by that many plus one literal bytes,
+// otherwise it starts a run of ((control & 0x7F) << 8 | next byte) + 1 zeros.
+constexpr size_t max_literals = 0x80;
+constexpr size_t max_zero_run = 0x8000;
+
+size_t encoded_size_bound(size_t size)
+{
+    return size + size/max_literals + 4;
+}
+
+size_t zeros_at(const uint8_t* data, size_t pos, size_t size)
+{
+    size_t end = pos;
+    for (uint64_t word; end + 8 <= size; end += 8)
+    {
+        memcpy(&word, data + end, 8);
+        if (word)
+            break;
+    }
+    while (end < size && data[end] == 0)
+        ++end;
+
+    return end - pos;
+}
+
+size_t encode(const uint8_t* data, size_t size, uint8_t* out)
+{
+    size_t pos { 0 }, written { 0 };
+    while (pos < size)
+    {
+        // shorter runs take less room as literals
+        const size_t zeros = zeros_at(data, pos, size);
+        if (zeros >= 3 || pos + zeros == size)
+        {
+            for (size_t left { zeros }; left; )
+            {
+                const size_t run = std::min(left, max_zero_run);
+                out[written++] = 0x80 | ((run - 1) >> 8);
+                out[written++] = (run - 1) & 0xFF;
+                left -= run;
+            }
+            pos += zeros;
+            continue;
+        }
+
+        const size_t start = pos;
+        while (pos < size && pos - start < max_literals &&
+               !(pos + 3 <= size && data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 0))
+        {
+            ++pos;
+        }
+        out[written++] = pos - start - 1;
+        memcpy(out + written, data + start, pos - start);
+        written += pos - start;
+    }
+
+    return written;
+}
+
+// writes the data over out, or XORs it into out
+template <bool Xor>
+void decode(const uint8_t* in, size_t size, uint8_t* out)
+{
+    for (size_t read { 0 }; read < size; )
+    {
+        const uint8_t control = in[read++];
+        if (control & 0x80)
+        {
+            const size_t run = (((control & 0x7F) << 8) | in[read++]) + 1;
+            if constexpr (!Xor)
+                memset(out, 0, run);
+            out += run;
+        }
+        else
+        {
+            const size_t count = control + 1;
+            if constexpr (Xor)
+            {
+                for (size_t i { 0 }; i < count; ++i)
+                    out[i] ^= in[read + i];
+            }
+            else
+            {
+                memcpy(out, in + read, count);
+            }
+            out += count; read += count;
+        }
+    }
+}
+
+void xor_into(std::vector<uint8_t>& data, const std::vector<uint8_t>& other)
+{
+    for (size_t i { 0 }; i < data.size(); ++i)
+        data[i] ^= other[i];
+}
+}
+
+RewindBuffer::RewindBuffer(Console& nes, size_t capacity, size_t max_frames, unsigned keyframe_interval)
+    : m_nes(nes), m_keyframe_interval(std::max(1u, keyframe_interval)), m_ring(capacity), m_entries(max_frames),
+      m_state(nes.state_size()), m_keyframe(m_state.size()), m_encoded(encoded_size_bound(m_state.size()))
+{
+    assert(max_frames > 0);
+}
+
+bool RewindBuffer::capture()
+{
+    const auto start = std::chrono::steady_clock::now();
+    ++stats.captures;
+
+    bool captured = m_nes.save_state(m_state.data(), m_state.size()) == m_state.size();
+    if (captured)
+    {
+        bool delta = frames() && m_next - at(m_next - 1).keyframe < m_keyframe_interval;
+        if (delta)
+        {
+            const size_t keyframe = at(m_next - 1).keyframe;
+            xor_into(m_state, m_keyframe);
+            const size_t size = encode(m_state.data(), m_state.size(), m_encoded.data());
+            const size_t offset = make_room(size);
+            if (offset != no_room && keyframe >= m_first)
+            {
+                push(offset, size, keyframe);
+            }
+            else
+            {
+                // the keyframe had to make room : start a new one
+                xor_into(m_state, m_keyframe);
+                delta = false;
+            }
+        }
+        if (!delta)
+        {
+            const size_t size = encode(m_state.data(), m_state.size(), m_encoded.data());
+            const size_t offset = make_room(size);
+            if (offset != no_room)
+            {
+                push(offset, size, m_next);
+                m_keyframe = m_state;
+                ++stats.keyframes;
+            }
+            else
+            {
+                captured = false;
+            }
+        }
+    }
+
+    stats.capture_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return captured;
+}
+
+bool RewindBuffer::rewind(size_t count)
+{
+    if (count >= frames())
+        return false;
+
+    const size_t target = m_next - 1 - count;
+    const entry& state    = at(target);
+    const entry& keyframe = at(state.keyframe);
+
+    decode<false>(m_ring.data() + keyframe.offset, keyframe.size, m_keyframe.data());
+    m_state = m_keyframe;
+    if (state.keyframe != target)
+        decode<true>(m_ring.data() + state.offset, state.size, m_state.data());
+
+    if (!m_nes.load_state(m_state.data(), m_state.size()))
+    {
+        // the console isn't running the same game anymore
+        m_first = m_next;
+        m_used = 0;
+        return false;
+    }
+
+    // the newer states are dropped
+    for (size_t capture { target + 1 }; capture < m_next; ++capture)
+        m_used -= at(capture).size;
+    m_next = target + 1;
+    m_head = state.offset + state.size;
+
+    return true;
+}
+
+size_t RewindBuffer::make_room(size_t size)
+{
+    if (size > m_ring.size())
+        return no_room;
+
+    while (frames() >= m_entries.size())
+        evict_oldest();
+
+    // States are laid out in the order they are captured, going back to the start of the ring when they don't fit
+    // before its end : those from m_head on are older than those before it, the states in the way are always the
+    // oldest ones.
+    const bool wrap = m_head + size > m_ring.size();
+    while (frames())
+    {
+        const entry& oldest = at(m_first);
+        const bool in_the_way = oldest.offset >= m_head ? (wrap || oldest.offset < m_head + size)
+                                                        : (wrap && oldest.offset < size);
+        if (!in_the_way)
+            break;
+
+        evict_oldest();
+    }
+
+    return wrap ? 0 : m_head;
+}
+
+void RewindBuffer::push(size_t offset, size_t size, size_t keyframe)
+{
+    memcpy(m_ring.data() + offset, m_encoded.data(), size);
+    at(m_next) = {offset, size, keyframe};
+    ++m_next;
+    m_head = offset + size;
+    m_used += size;
+}
+
+void RewindBuffer::evict_oldest()
+{
+    // states can't be restored without their keyframe : they go with it
+    do
+    {
+        m_used -= at(m_first).size;
+        ++m_first;
+        ++stats.evicted;
+    }
+    while (frames() && at(m_first).keyframe != m_first);
+}
+
+}
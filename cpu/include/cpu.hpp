@@ -27,11 +27,18 @@ SOFTWARE.
 
 #include <cstdint>
 #include <array>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include "common/bitops.hpp"
-#include "common/coroutine.hpp"
+#include "common/state_stream.hpp"
 
-struct OpcodeEntry;
+struct jit_block;
+class  jit6502;
+// defined with jit6502, so that the cpus can own one without knowing its definition
+struct jit6502_deleter
+{ void operator()(jit6502* jit) const; };
 
 enum cpu_type
 {
@@ -40,39 +47,51 @@ enum cpu_type
     WDC65c02
 };
 
+// how opcodes are dispatched to their implementation
+enum cpu_dispatch
+{
+    TableDispatch, // indirect call through a table of per-opcode functions
+    SwitchDispatch // switch generated from the opcode table, all instructions are inlined into run()
+};
+
 #ifndef CPU6502_FLAVOR
 #define CPU6502_FLAVOR MOS6502
 #endif
-#ifndef CPU6502_CYCLE_ACTION
-#define CPU6502_CYCLE_ACTION()
+#ifndef CPU6502_DISPATCH
+#define CPU6502_DISPATCH TableDispatch
 #endif
 
-class cpu6502
+// The part of the cpu which doesn't depend on its bus : registers, cycle count and interrupt lines.
+// This is what the other components of the system see of the cpu.
+class cpu6502_base
 {
 public:
-    static constexpr cpu_type flavor = CPU6502_FLAVOR;
     static const std::array<char[4], 256> opcode_mnemos;
 
-public:
-    using ReadCallback  = uint8_t(*)(uint16_t addr);
-    using WriteCallback =    void(*)(uint16_t addr, uint8_t val);
-    using LogCallback   =    void(*)(const char* str);
+    // used by the components reading memory on the behalf of the cpu (e.g. OAM DMA)
+    using BusReadCallback = uint8_t(*)(cpu6502_base& cpu, uint16_t addr);
 
-    cpu6502(ReadCallback in_read_clbk, WriteCallback in_write_clbk, LogCallback in_log_clbk = nullptr)
-        : read_clbk(in_read_clbk), write_clbk(in_write_clbk), log_clbk(in_log_clbk)
+    explicit cpu6502_base(BusReadCallback in_bus_read)
+        : m_bus_read(in_bus_read)
     { }
 
+    cpu6502_base(const cpu6502_base&) = delete;
+    cpu6502_base& operator=(const cpu6502_base&) = delete;
+
 public:
     void pull_nmi_low();
     void pull_nmi_high();
     void pull_irq_low();
 
     void raise_nmi(); // manually raise NMI
-    void reset();
 
     bool     stopped() const { return m_stopped; }
 
-    void run(unsigned steps);
+    uint8_t bus_read(uint16_t addr)
+    { return m_bus_read(*this, addr); }
+
+    // registers, cycle count and interrupt lines ; only meaningful between two instructions
+    void serialize(StateStream& stream);
 
     struct state
     {
@@ -96,24 +115,161 @@ public:
         Neg   = 1<<7
     };
 
+    // to be called by the bus when a read has side-effects, an idle loop can't contain such reads
+    void note_side_effect()
+    { m_idle_loop.clean = false; }
+
+public: /* private */
+    enum AddrModes : unsigned
+    {
+        Implied,
+        Immediate,
+        ZeroPage,
+        ZeroPageX,
+        ZeroPageY,
+        Absolute,
+        AbsoluteX,
+        AbsoluteY,
+        IndZeroX,
+        IndZeroY,
+        IndirectZP,
+        Indirect,
+        IndirectX,
+        BitRelative,
+        BitZP,
+
+        AddrModesCount,
+
+        AbsoluteXWrite,
+        AbsoluteYWrite,
+        IndZeroYWrite,
+
+        BusConflictInvalid
+    };
+
+    bool interrupts_enabled() const
+    { return !(state.flags & IntD); }
+
+    BusReadCallback m_bus_read;
+
+    // An idle loop is a short loop which doesn't write to memory and only reads memory without side-effects :
+    // once an iteration ends with the same registers it started with, every following iteration will be identical until an interrupt happens.
+    static constexpr unsigned max_idle_loop_size = 32;
+    struct idle_loop_state
+    {
+        uint16_t head { 0 }, tail { 0 };
+        unsigned start_cycle { 0 };
+        struct state regs {};
+        bool clean { false };
+    } m_idle_loop;
+
+    int m_nmi_line_state { 1 };
+
+    bool m_stopped { false };
+    bool m_irq_pending { false };
+    bool m_nmi_pending { false };
+    bool m_int_delay   { false };
+    bool m_wait_interrupt { false };
+};
+
+// A 6502 connected to a Bus, which must provide :
+//  - static constexpr cpu_type flavor and static constexpr cpu_dispatch dispatch
+//  - uint8_t read(uint16_t addr) and void write(uint16_t addr, uint8_t val)
+//  - void cycle() : called at the end of every cpu cycle
+//  - void idle_loop(unsigned iteration_cycles) : called at the end of an iteration of an idle loop, see loop_back()
+//  - void instruction_boundary() : called before each instruction, when the registers hold the whole cpu state
+//  - void log(const char* str)
+//  - const uint8_t* code_page(uint16_t addr) : the 256-byte page of ROM addr is in, whose code can then be decoded
+//    once and for all (see decoded_op), or null (RAM, I/O...) ; the bus calls remap_code() when another page may be
+//    mapped there (e.g. a bank switch)
+//  - void latch(uint8_t val) : the last instruction byte of a decoded instruction, which wasn't read through the bus
+//  - unsigned quiet_cycles() : how many of the next cycles are known to do nothing in cycle() nor in
+//    instruction_boundary(), they can be counted at once
+//  - const uint8_t* read_page(uint16_t addr) and uint8_t* write_page(uint16_t addr) : the 256-byte page of memory the
+//    reads at addr are served from without side-effects, and the one the writes at addr only store the value into,
+//    or null (see enable_jit()) ; looked up again on remap_code()
+// The bus is a member of the cpu, its accesses can be inlined into the instructions.
+// The members are defined in cpu_impl.hpp, which is only to be included where the cpu is instantiated for a bus.
+template <class Bus>
+class basic_cpu6502 : public cpu6502_base
+{
+public:
+    static constexpr cpu_type flavor = Bus::flavor;
+    static constexpr cpu_dispatch dispatch = Bus::dispatch;
+
+    // the arguments are forwarded to the bus
+    template <typename... Args>
+    explicit basic_cpu6502(Args&&... args)
+        : cpu6502_base(&bus_read_thunk), bus{std::forward<Args>(args)...}
+    { m_code_pages.fill(&unmapped_code); }
+
+public:
+    void reset();
+
+    // flattened so that the instructions and the bus accesses are inlined into the dispatch
+    [[gnu::flatten]] void run(unsigned steps);
+
+    // Code running from ROM is decoded once : its instructions are then dispatched straight from their opcode and
+    // operands, without fetching their bytes through the bus nor looking them up again. The cycles of those
+    // fetches are still spent before the instruction's other accesses, the emulation stays cycle-exact.
+    struct decoded_op
+    {
+        bool    decoded; // false until decoded
+        uint8_t opcode;
+        uint8_t operands[2];
+    };
+    struct decoded_page
+    {
+        const uint8_t* source; // the ROM page decoded, i.e. its bank and its offset in the bank
+        std::array<decoded_op, 0x100> ops;
+
+        // the native blocks starting at each offset once compiled, and how many times they were reached until then
+        std::array<const jit_block*, 0x100> blocks;
+        std::array<uint8_t, 0x100> heat;
+    };
+
+    // the bus may map other code pages (e.g. a bank switch) : those which changed are looked up again when run
+    void remap_code();
+    // the code itself may have changed (e.g. another cartridge) : everything decoded is dropped
+    void clear_decoded();
+
+    // The blocks of decoded code run most often are also compiled to native code (see jit6502), on NES6502 cpus and
+    // x86-64 unix hosts only ; a block is run natively when nothing else can happen on the bus until it ends.
+    void enable_jit(bool enabled);
+    bool jit_enabled() const
+    { return m_jit != nullptr; }
+
+    struct code_stats
+    {
+        size_t decoded { 0 };     // instructions run from their decoded_op
+        size_t interpreted { 0 }; // instructions fetched and decoded through the bus
+        size_t compiled { 0 };    // instructions run natively, not counted in 'decoded'
+    } code_stats;
+
 public: /* private */
     uint8_t read(uint16_t addr)
-    { return read_clbk(addr); }
+    { return bus.read(addr); }
     void    write(uint16_t addr, uint8_t val)
-    { write_clbk(addr, val); }
+    { m_idle_loop.clean = false; bus.write(addr, val); }
 
     void    log(const char* str)
-    { if (log_clbk) log_clbk(str); }
+    { bus.log(str); }
 
 private:
+    static uint8_t bus_read_thunk(cpu6502_base& cpu, uint16_t addr)
+    { return static_cast<basic_cpu6502&>(cpu).read(addr); }
+
     uint8_t fetch_opcode();
+    // the decoded instruction at pc, decoding it if its page can be, null if it can't
+    [[gnu::noinline]] const decoded_op* decode(uint16_t pc);
+    // runs the native block at pc, compiling it once hot ; false if it wasn't run
+    [[gnu::noinline]] bool run_compiled();
+    void drop_compiled();
 
     bool carry() const
     { return state.flags & Carry; }
     bool zero() const
     { return state.flags & Zero; }
-    bool interrupts_enabled() const
-    { return !(state.flags & IntD); }
     bool decimal() const
     {
         if constexpr (flavor == NES6502) // no decimal mode on the NES's 6502
@@ -128,6 +284,7 @@ private:
     { return state.flags & Neg; }
 
     void branch_on(int8_t disp, bool cond);
+    void loop_back(uint16_t target);
 
     void set_carry(bool val) { bit_change(state.flags, val, 0); }
     void set_int_disable(bool val) { bit_change(state.flags, val, 2); }
@@ -153,42 +310,17 @@ private:
     void switch_to_isr(uint16_t vector, bool brk = false);
 
 public: /* private */
-    enum AddrModes : unsigned
-    {
-        Implied,
-        Immediate,
-        ZeroPage,
-        ZeroPageX,
-        ZeroPageY,
-        Absolute,
-        AbsoluteX,
-        AbsoluteY,
-        IndZeroX,
-        IndZeroY,
-        IndirectZP,
-        Indirect,
-        IndirectX,
-        BitRelative,
-        BitZP,
-
-        AddrModesCount,
-
-        AbsoluteXWrite,
-        AbsoluteYWrite,
-        IndZeroYWrite,
-
-        BusConflictInvalid
-    };
-
-
     void cycle()
     {
         ++cycles;
-        CPU6502_CYCLE_ACTION();
+        bus.cycle();
     }
 
-    template<enum AddrModes>
-    uint16_t addr_mode_get();
+    // decoded : the operands are taken from the decoded instruction, their cycles having been spent beforehand
+    template<AddrModes, bool decoded = false>
+    uint16_t addr_mode_get(const uint8_t* operands = nullptr);
+    template<bool decoded>
+    uint8_t fetch_operand(const uint8_t* operands, unsigned idx);
 
     void invalid_opcode();
 
@@ -286,17 +418,63 @@ public: /* private */
     void xas(uint16_t);
 
 public:
+    Bus bus;
+
+private:
+    // the decoded pages the cpu's pages are mapped onto, null where the code isn't decoded,
+    // unmapped_code where the bus is to be asked again
+    static inline decoded_page unmapped_code {};
+    std::array<decoded_page*, 0x100> m_code_pages;
+    std::unordered_map<const uint8_t*, std::unique_ptr<decoded_page>> m_decoded;
+    std::unique_ptr<jit6502, jit6502_deleter> m_jit;
+};
+
+// forwards every access to function pointers
+struct callback_bus
+{
+    // 'user' is the pointer given to the constructor, so that several cpus can share the same callbacks
+    using ReadCallback  = uint8_t(*)(void* user, uint16_t addr);
+    using WriteCallback =    void(*)(void* user, uint16_t addr, uint8_t val);
+    using LogCallback   =    void(*)(const char* str);
+    using IdleLoopCallback = void(*)(void* user, unsigned iteration_cycles);
+
+    static constexpr cpu_type flavor = CPU6502_FLAVOR;
+    static constexpr cpu_dispatch dispatch = CPU6502_DISPATCH;
+
     ReadCallback read_clbk;
     WriteCallback write_clbk;
-    LogCallback log_clbk;
+    LogCallback log_clbk { nullptr };
+    void* clbk_user { nullptr };
+    IdleLoopCallback idle_loop_clbk { nullptr };
 
-    int m_nmi_line_state { 1 };
+    uint8_t read(uint16_t addr)
+    { return read_clbk(clbk_user, addr); }
+    void    write(uint16_t addr, uint8_t val)
+    { write_clbk(clbk_user, addr, val); }
 
-    bool m_stopped { false };
-    bool m_irq_pending { false };
-    bool m_nmi_pending { false };
-    bool m_int_delay   { false };
-    bool m_wait_interrupt { false };
+    void cycle()
+    { }
+    void idle_loop(unsigned iteration_cycles)
+    { if (idle_loop_clbk) idle_loop_clbk(clbk_user, iteration_cycles); }
+    void instruction_boundary()
+    { }
+    void log(const char* str)
+    { if (log_clbk) log_clbk(str); }
+
+    // the callbacks may map anything anywhere
+    const uint8_t* code_page(uint16_t)
+    { return nullptr; }
+    void latch(uint8_t)
+    { }
+    unsigned quiet_cycles() const
+    { return ~0u; }
+    const uint8_t* read_page(uint16_t)
+    { return nullptr; }
+    uint8_t* write_page(uint16_t)
+    { return nullptr; }
 };
 
+extern template class basic_cpu6502<callback_bus>;
+using cpu6502 = basic_cpu6502<callback_bus>;
+
 #endif // CPU65C02_HPP
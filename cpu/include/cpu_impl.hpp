@@ -0,0 +1,318 @@
+﻿/*
+cpu65c02.cpp
+
+Copyright (c) 27 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef CPU_IMPL_HPP
+#define CPU_IMPL_HPP
+
+// Definitions of basic_cpu6502's members, to be included only by the translation unit instantiating the cpu for a bus :
+//     template class basic_cpu6502<my_bus>;
+
+#include <algorithm>
+
+#include "cpu.hpp"
+#include "jit.hpp"
+
+#include "detail/addr_modes.hpp"
+#include "detail/instructions.hpp"
+#include "detail/opcode_table.hpp"
+
+template <class Bus>
+void basic_cpu6502<Bus>::reset()
+{
+    state.a = state.x = state.y = 0;
+    state.flags = 0b00110100;
+    state.sp = 0xFD;
+
+    state.pc =  read(0xFFFC);
+    state.pc |= read(0xFFFD) << 8;
+
+    m_stopped        = false;
+    m_int_delay      = false;
+    m_wait_interrupt = false;
+    m_idle_loop.clean = false;
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::switch_to_isr(uint16_t vector, bool brk)
+{
+    push(state.pc >> 8);
+    push(state.pc & 0xFF);
+    if constexpr (flavor == WDC65c02)
+    {
+        if (brk)
+            push((state.flags & ~0b01000) | 0b10000); // with D flag unset
+        else
+            push(state.flags & ~0b11000); // with B and D flag unset
+    }
+    else
+    {
+        if (brk)
+            push(state.flags | 0b10000);
+        else
+            push(state.flags & ~0b10000); // with B flag unset
+    }
+
+    uint16_t new_pc = 0;
+    new_pc  = read(vector  ); set_int_disable(true); cycle();
+    new_pc |= read(vector+1) << 8;                   cycle();
+
+    state.pc = new_pc;
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::run(unsigned steps)
+{
+    for (size_t i { 0 }; i < steps; ++i)
+    {
+        if constexpr (flavor == cpu_type::WDC65c02) // other versions don't have STP and WAI
+        {
+            if (stopped() || m_wait_interrupt)
+            {
+                return;
+            }
+        }
+
+        bus.instruction_boundary();
+
+        m_int_delay = false;
+
+        const decoded_page* code = m_code_pages[state.pc >> 8];
+        const decoded_op* decoded = code ? &code->ops[state.pc & 0xFF] : nullptr;
+        if (decoded && !decoded->decoded)
+        {
+            decoded = decode(state.pc);
+        }
+
+        if (decoded && m_jit && run_compiled())
+        {
+            // a whole block was run, it can't have raised an interrupt
+        }
+        else if (decoded)
+        {
+            ++code_stats.decoded;
+
+            if constexpr (dispatch == SwitchDispatch)
+            {
+                switch (decoded->opcode)
+                {
+#define CPU6502_DECODED_CASE(op) case op: execute_decoded<basic_cpu6502, op>(*this, *decoded); break;
+                    CPU6502_OPCODES(CPU6502_DECODED_CASE)
+#undef CPU6502_DECODED_CASE
+                }
+            }
+            else
+            {
+                decoded_callbacks<basic_cpu6502>[decoded->opcode](*this, *decoded);
+            }
+        }
+        else
+        {
+            ++code_stats.interpreted;
+
+            uint8_t opcode = fetch_opcode();
+            cycle(); // first cycle : read opcode, increment PC
+
+            if constexpr (dispatch == SwitchDispatch)
+            {
+                switch (opcode)
+                {
+#define CPU6502_OPCODE_CASE(op) case op: execute_opcode<basic_cpu6502, op>(*this); break;
+                    CPU6502_OPCODES(CPU6502_OPCODE_CASE)
+#undef CPU6502_OPCODE_CASE
+                }
+            }
+            else
+            {
+                auto operation = opcode_callbacks<basic_cpu6502>[opcode];
+
+                operation(*this);
+            }
+        }
+
+        // check interrupts
+        if (!m_int_delay)
+        {
+            if (m_nmi_pending)
+            {
+                m_nmi_pending = false;
+                switch_to_isr(0xFFFA);
+            }
+            if (m_irq_pending)
+            {
+                m_irq_pending = false;
+                switch_to_isr(0xFFFE);
+            }
+        }
+    }
+}
+
+template <class Bus>
+uint8_t basic_cpu6502<Bus>::fetch_opcode()
+{
+    return read(state.pc++);
+}
+
+template <class Bus>
+auto basic_cpu6502<Bus>::decode(uint16_t pc) -> const decoded_op*
+{
+    decoded_page*& code = m_code_pages[pc >> 8];
+    if (code == &unmapped_code)
+    {
+        const uint8_t* source = bus.code_page(pc & 0xFF00);
+        if (!source)
+        {
+            code = nullptr;
+            return nullptr;
+        }
+
+        // decoded once for each place in ROM, however many times it's mapped in and out
+        auto& page = m_decoded[source];
+        if (!page)
+        {
+            page = std::make_unique<decoded_page>();
+            page->source = source;
+        }
+        code = page.get();
+    }
+
+    decoded_op& op = code->ops[pc & 0xFF];
+    if (op.decoded)
+        return &op;
+
+    const unsigned offset = pc & 0xFF;
+    const uint8_t opcode = code->source[offset];
+    const opcode_fetch fetch = fetch_table<basic_cpu6502>[opcode];
+    // invalid opcodes, and instructions going on into the next page, which isn't necessarily the next one in ROM
+    if (fetch.length == 0 || offset + fetch.length > 0x100)
+        return nullptr;
+
+    for (unsigned idx { 1 }; idx < fetch.length; ++idx)
+        op.operands[idx - 1] = code->source[offset + idx];
+    op.opcode  = opcode;
+    op.decoded = true;
+    return &op;
+}
+
+template <class Bus>
+bool basic_cpu6502<Bus>::run_compiled()
+{
+    decoded_page& code = *m_code_pages[state.pc >> 8];
+    const unsigned offset = state.pc & 0xFF;
+    const jit_block* block = code.blocks[offset];
+    if (!block)
+    {
+        if (++code.heat[offset] < jit6502::hot_threshold)
+            return false;
+        if (m_jit->full())
+            drop_compiled();
+        block = code.blocks[offset] = m_jit->compile(code.source, state.pc);
+    }
+
+    // nothing may happen on the bus while the block runs, nor right after one of its instructions
+    if (!block->entry || block->pc != state.pc || m_nmi_pending || m_irq_pending)
+        return false;
+    const unsigned quiet = bus.quiet_cycles();
+    if (quiet < block->max_cycles)
+        return false;
+
+    auto& frame = m_jit->frame;
+    frame.regs   = state;
+    frame.cycles = cycles;
+    frame.budget = std::min(quiet, jit6502::max_budget) - block->max_cycles;
+    frame.loop   = m_idle_loop;
+    const uint32_t result = m_jit->run(*block);
+    if (frame.instructions == 0) // its first access isn't to plain memory
+        return false;
+
+    state  = frame.regs;
+    cycles = frame.cycles;
+    bus.latch(frame.latch);
+    m_idle_loop = frame.loop;
+    code_stats.compiled += frame.instructions;
+
+    if (result & jit6502::loop_exit)
+    {
+        const uint16_t target = result & 0xFFFF;
+        loop_back(target);
+        state.pc = target;
+    }
+    return true;
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::drop_compiled()
+{
+    for (auto& entry : m_decoded)
+    {
+        entry.second->blocks.fill(nullptr);
+        entry.second->heat.fill(0);
+    }
+    m_jit->clear();
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::enable_jit(bool enabled)
+{
+    // no decimal mode in the native code
+    if (flavor != NES6502 || !jit6502::supported || enabled == jit_enabled())
+        return;
+
+    if (m_jit)
+        drop_compiled();
+    if (enabled)
+        m_jit.reset(new jit6502);
+    else
+        m_jit.reset();
+    remap_code();
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::remap_code()
+{
+    for (unsigned page { 0 }; page < m_code_pages.size(); ++page)
+    {
+        // the pages still mapped onto the same ROM are kept
+        decoded_page*& code = m_code_pages[page];
+        if (!code || (code != &unmapped_code && bus.code_page(page << 8) != code->source))
+            code = &unmapped_code;
+
+        if (m_jit)
+            m_jit->map_page(page, bus.read_page(page << 8), bus.write_page(page << 8));
+    }
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::clear_decoded()
+{
+    m_code_pages.fill(&unmapped_code);
+    m_decoded.clear();
+    if (m_jit)
+    {
+        // until remap_code() : the memory may have changed as well
+        m_jit->clear();
+        m_jit->unmap_pages();
+    }
+}
+
+#endif // CPU_IMPL_HPP
@@ -0,0 +1,191 @@
+/*
+addr_modes.hpp
+
+Copyright (c) 27 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef ADDR_MODES_HPP
+#define ADDR_MODES_HPP
+
+#include "../cpu.hpp"
+
+// the idx-th operand byte of the instruction being run
+template <class Bus>
+template <bool decoded>
+uint8_t basic_cpu6502<Bus>::fetch_operand(const uint8_t* operands, unsigned idx)
+{
+    if constexpr (decoded)
+    {
+        ++state.pc; // its cycle was spent along with the opcode's
+        return operands[idx];
+    }
+    else
+    {
+        uint8_t val = read(state.pc++); cycle();
+        return val;
+    }
+}
+
+template <class Bus>
+template <cpu6502_base::AddrModes mode, bool decoded>
+uint16_t basic_cpu6502<Bus>::addr_mode_get(const uint8_t* operands)
+{
+    if constexpr (mode == Immediate)
+    {
+        return state.pc++;
+    }
+    else if constexpr (mode == ZeroPage)
+    {
+        uint8_t addr = fetch_operand<decoded>(operands, 0);
+        return addr;
+    }
+    else if constexpr (mode == ZeroPageX)
+    {
+        uint8_t addr = fetch_operand<decoded>(operands, 0);
+        read(addr); addr += state.x;        cycle(); // dummy read
+        return addr;
+    }
+    else if constexpr (mode == ZeroPageY)
+    {
+        uint8_t addr = fetch_operand<decoded>(operands, 0);
+        read(addr); addr += state.y;        cycle(); // dummy read
+        return addr;
+    }
+    else if constexpr (mode == Absolute)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        return addr;
+    }
+    else if constexpr (mode == AbsoluteX)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        if ((addr&0xFF) + state.x >= 0x100) // page crossed
+        {
+            // do a dummy read at the invalid address
+            read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.x)); cycle();
+        }
+        addr += state.x;
+        return addr;
+    }
+    else if constexpr (mode == AbsoluteY)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        if ((addr&0xFF) + state.y >= 0x100) // page crossed
+        {
+            // do a dummy read at the invalid address
+            read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.y)); cycle();
+        }
+        addr += state.y;
+        return addr;
+    }
+    else if constexpr (mode == AbsoluteXWrite)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        // do a dummy read at the invalid address
+        read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.x)); cycle();
+        addr += state.x;
+        return addr;
+    }
+    else if constexpr (mode == AbsoluteYWrite)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        // do a dummy read at the invalid address
+        read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.y)); cycle();
+        addr += state.y;
+        return addr;
+    }
+    else if constexpr (mode == IndZeroX)
+    {
+        uint8_t zero_addr  = fetch_operand<decoded>(operands, 0);
+        read(zero_addr); zero_addr += state.x;      cycle(); // dummy read
+        uint16_t addr      = read(zero_addr);       cycle();
+        addr     |= read((uint8_t)(zero_addr+1))<<8;  cycle();
+
+        return addr;
+    }
+    else if constexpr (mode == IndZeroY)
+    {
+        uint8_t zero_addr  = fetch_operand<decoded>(operands, 0);
+        uint16_t addr      = read(zero_addr);       cycle();
+        addr     |= read((uint8_t)(zero_addr+1))<<8;  cycle();
+        if ((addr&0xFF) + state.y >= 0x100) // page crossed
+        {
+            // do a dummy read at the invalid address
+            read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.y)); cycle();
+        }
+        addr += state.y;
+        return addr;
+    }
+    else if constexpr (mode == IndZeroYWrite)
+    {
+        uint8_t zero_addr  = fetch_operand<decoded>(operands, 0);
+        uint16_t addr      = read(zero_addr);       cycle();
+        addr     |= read((uint8_t)(zero_addr+1))<<8;  cycle();
+        // do a dummy read at the invalid address
+        read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.y)); cycle();
+        addr += state.y;
+        return addr;
+    }
+    else if constexpr (mode == IndirectZP)
+    {
+        uint8_t zero_addr  = fetch_operand<decoded>(operands, 0);
+        uint16_t addr      = read(zero_addr);  cycle();
+        addr     |= read((uint8_t)(zero_addr+1))<<8; cycle();
+
+        return addr;
+    }
+    else if constexpr (mode == Indirect)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        return addr;
+    }
+    else if constexpr (mode == IndirectX)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        addr += state.x;                    cycle();
+        return addr;
+    }
+    else if constexpr (mode == BusConflictInvalid)
+    {
+        uint16_t addr  = fetch_operand<decoded>(operands, 0);
+        addr |= fetch_operand<decoded>(operands, 1) << 8;
+        if ((addr&0xFF) + state.x >= 0x100) // page crossed
+        {
+            // do a dummy read at the invalid address
+            read((addr&0xFF00) + (uint8_t)((uint8_t)(addr&0xFF) + state.x)); cycle();
+        }
+
+        return addr; // let the instruction handle the messy page crossing behavior
+    }
+    else
+    {
+        static_assert(mode != mode, "invalid addressing mode");
+    }
+}
+
+#endif // ADDR_MODES_HPP
@@ -1,5 +1,5 @@
 /*
-instructions.cpp
+instructions.hpp
 
 Copyright (c) 27 Yann BOUCHER (yann)
 
@@ -22,15 +22,78 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 
 */
+#ifndef INSTRUCTIONS_HPP
+#define INSTRUCTIONS_HPP
 
-#include "cpu.hpp"
+#include "../cpu.hpp"
 
 #include <cstdio>
 #include <cassert>
 
 #include "common/bitops.hpp"
 
-void cpu6502::adc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::branch_on(int8_t disp, bool cond)
+{
+    cycle();
+    if (cond)
+    {
+        uint16_t addr = state.pc + disp;
+
+        if ((addr&0xFF00) != (state.pc&0xFF00)) // diff page
+        {
+            cycle();
+        }
+        cycle();
+
+        loop_back(addr);
+        state.pc = addr;
+    }
+}
+
+// called with state.pc pointing after the branch or jump instruction, once all of its cycles have elapsed
+template <class Bus>
+void basic_cpu6502<Bus>::loop_back(uint16_t target)
+{
+    if (target > state.pc || unsigned(state.pc - target) > max_idle_loop_size)
+        return;
+
+    auto& loop = m_idle_loop;
+    const bool same_regs = loop.regs.a == state.a && loop.regs.x == state.x && loop.regs.y == state.y
+            && loop.regs.sp == state.sp && loop.regs.flags == state.flags;
+    if (loop.clean && loop.head == target && loop.tail == state.pc && same_regs && !m_nmi_pending && !m_irq_pending)
+    {
+        bus.idle_loop(cycles - loop.start_cycle);
+    }
+
+    loop.head = target; loop.tail = state.pc;
+    loop.start_cycle = cycles;
+    loop.regs = state;
+    loop.clean = true;
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::push(uint8_t val)
+{
+    write(0x100 + state.sp, val);
+    --state.sp;
+
+    cycle();
+}
+
+template <class Bus>
+uint8_t basic_cpu6502<Bus>::pop()
+{
+    ++state.sp;
+    uint8_t val = read(0x100 + state.sp);
+
+    cycle();
+
+    return val;
+}
+
+template <class Bus>
+void basic_cpu6502<Bus>::adc(uint16_t addr)
 {
     uint8_t value = read(addr);
     cycle();
@@ -69,7 +132,8 @@ void cpu6502::adc(uint16_t addr)
     state.a = result8;
 }
 
-void cpu6502::sbc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::sbc(uint16_t addr)
 {
     uint8_t value = read(addr);
     cycle();
@@ -110,7 +174,8 @@ void cpu6502::sbc(uint16_t addr)
     state.a = result8;
 }
 
-void cpu6502::and_(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::and_(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
 
@@ -119,7 +184,8 @@ void cpu6502::and_(uint16_t addr)
     test_zn(state.a);
 }
 
-void cpu6502::asl(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::asl(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -132,7 +198,8 @@ void cpu6502::asl(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::asla()
+template <class Bus>
+void basic_cpu6502<Bus>::asla()
 {
     set_carry(state.a & 0x80); // bit 7
 
@@ -141,34 +208,40 @@ void cpu6502::asla()
     test_zn(state.a);
 }
 
-void cpu6502::bbr(uint8_t bit, uint8_t val, int8_t branch)
+template <class Bus>
+void basic_cpu6502<Bus>::bbr(uint8_t bit, uint8_t val, int8_t branch)
 {
     uint16_t target = state.pc + branch;
     branch_on(target, bit_get(read(val), bit) == 0);
 }
 
-void cpu6502::bbs(uint8_t bit, uint8_t val, int8_t branch)
+template <class Bus>
+void basic_cpu6502<Bus>::bbs(uint8_t bit, uint8_t val, int8_t branch)
 {
     uint16_t target = state.pc + branch;
     branch_on(target, bit_get(read(val), bit) == 1);
 }
 
-void cpu6502::bcc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bcc(uint16_t addr)
 {
     branch_on(read(addr), !carry());
 }
 
-void cpu6502::bcs(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bcs(uint16_t addr)
 {
     branch_on(read(addr), carry());
 }
 
-void cpu6502::beq(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::beq(uint16_t addr)
 {
     branch_on(read(addr), zero());
 }
 
-void cpu6502::bit(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bit(uint16_t addr)
 {
     uint8_t memory = read(addr); cycle();
     uint8_t value = state.a & memory;
@@ -177,79 +250,94 @@ void cpu6502::bit(uint16_t addr)
     set_negative(bit_get(memory, 7));
 }
 
-void cpu6502::bmi(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bmi(uint16_t addr)
 {
     branch_on(read(addr), negative());
 }
 
-void cpu6502::bne(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bne(uint16_t addr)
 {
     branch_on(read(addr), !zero());
 }
-void cpu6502::bpl(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bpl(uint16_t addr)
 {
     branch_on(read(addr), !negative());
 }
 
-void cpu6502::bra(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bra(uint16_t addr)
 {
     branch_on(read(addr), true);
 }
 
-void cpu6502::brk()
+template <class Bus>
+void basic_cpu6502<Bus>::brk()
 {
     ++state.pc; // brk takes two bytes
     switch_to_isr(0xFFFE, true);
 }
 
-void cpu6502::bvc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bvc(uint16_t addr)
 {
     branch_on(read(addr), !overflow());
 }
 
-void cpu6502::bvs(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::bvs(uint16_t addr)
 {
     branch_on(read(addr), overflow());
 }
 
-void cpu6502::clc()
+template <class Bus>
+void basic_cpu6502<Bus>::clc()
 {
     set_carry(false);
 }
 
-void cpu6502::cld()
+template <class Bus>
+void basic_cpu6502<Bus>::cld()
 {
     set_decimal_mode(false);
 }
 
-void cpu6502::cli()
+template <class Bus>
+void basic_cpu6502<Bus>::cli()
 {
     set_int_disable(false);
     m_int_delay = true;
 }
 
-void cpu6502::clv()
+template <class Bus>
+void basic_cpu6502<Bus>::clv()
 {
     set_overflow(false);
 }
 
-void cpu6502::sec()
+template <class Bus>
+void basic_cpu6502<Bus>::sec()
 {
     set_carry(true);
 }
 
-void cpu6502::sed()
+template <class Bus>
+void basic_cpu6502<Bus>::sed()
 {
     set_decimal_mode(true);
 }
 
-void cpu6502::sei()
+template <class Bus>
+void basic_cpu6502<Bus>::sei()
 {
     set_int_disable(true);
     m_int_delay = true;
 }
 
-void cpu6502::cmp(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::cmp(uint16_t addr)
 {
     uint8_t memory = read(addr); cycle();
     uint8_t result = state.a - memory;
@@ -257,7 +345,8 @@ void cpu6502::cmp(uint16_t addr)
     set_carry(state.a >= memory);
     test_zn(result);
 }
-void cpu6502::cpx(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::cpx(uint16_t addr)
 {
     uint8_t memory = read(addr); cycle();
     uint8_t result = state.x - memory;
@@ -265,7 +354,8 @@ void cpu6502::cpx(uint16_t addr)
     set_carry(state.x >= memory);
     test_zn(result);
 }
-void cpu6502::cpy(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::cpy(uint16_t addr)
 {
     uint8_t memory = read(addr); cycle();
     uint8_t result = state.y - memory;
@@ -274,7 +364,8 @@ void cpu6502::cpy(uint16_t addr)
     test_zn(result);
 }
 
-void cpu6502::inc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::inc(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -284,26 +375,30 @@ void cpu6502::inc(uint16_t addr)
 
     write(addr, val); cycle();
 }
-void cpu6502::inx()
+template <class Bus>
+void basic_cpu6502<Bus>::inx()
 {
     ++state.x;
 
     test_zn(state.x);
 }
-void cpu6502::iny()
+template <class Bus>
+void basic_cpu6502<Bus>::iny()
 {
     ++state.y;
 
     test_zn(state.y);
 }
-void cpu6502::inca()
+template <class Bus>
+void basic_cpu6502<Bus>::inca()
 {
     ++state.a;
 
     test_zn(state.a);
 }
 
-void cpu6502::dec(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::dec(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -313,26 +408,30 @@ void cpu6502::dec(uint16_t addr)
 
     write(addr, val); cycle();
 }
-void cpu6502::dex()
+template <class Bus>
+void basic_cpu6502<Bus>::dex()
 {
     --state.x;
 
     test_zn(state.x);
 }
-void cpu6502::dey()
+template <class Bus>
+void basic_cpu6502<Bus>::dey()
 {
     --state.y;
 
     test_zn(state.y);
 }
-void cpu6502::deca()
+template <class Bus>
+void basic_cpu6502<Bus>::deca()
 {
     --state.a;
 
     test_zn(state.a);
 }
 
-void cpu6502::eor(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::eor(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
 
@@ -340,7 +439,8 @@ void cpu6502::eor(uint16_t addr)
 
     test_zn(state.a);
 }
-void cpu6502::ora(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::ora(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
 
@@ -349,12 +449,15 @@ void cpu6502::ora(uint16_t addr)
     test_zn(state.a);
 }
 
-void cpu6502::jmp(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::jmp(uint16_t addr)
 {
+    loop_back(addr);
     state.pc = addr;
 }
 
-void cpu6502::ind_jmp(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::ind_jmp(uint16_t addr)
 {
     if constexpr (flavor == WDC65c02)
     {
@@ -375,7 +478,8 @@ void cpu6502::ind_jmp(uint16_t addr)
     }
 }
 
-void cpu6502::jsr(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::jsr(uint16_t addr)
 {
     uint16_t ret = state.pc - 1;
 
@@ -385,38 +489,46 @@ void cpu6502::jsr(uint16_t addr)
     state.pc = addr;
     cycle();
 }
-void cpu6502::lda(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::lda(uint16_t addr)
 {
     state.a = read(addr); cycle();
     test_zn(state.a);
 }
-void cpu6502::ldx(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::ldx(uint16_t addr)
 {
     state.x = read(addr); cycle();
     test_zn(state.x);
 }
-void cpu6502::ldy(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::ldy(uint16_t addr)
 {
     state.y = read(addr); cycle();
     test_zn(state.y);
 }
-void cpu6502::sta(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::sta(uint16_t addr)
 {
     write(addr, state.a); cycle();
 }
-void cpu6502::stx(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::stx(uint16_t addr)
 {
     write(addr, state.x); cycle();
 }
-void cpu6502::sty(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::sty(uint16_t addr)
 {
     write(addr, state.y); cycle();
 }
-void cpu6502::stz(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::stz(uint16_t addr)
 {
     write(addr, 0); cycle();
 }
-void cpu6502::lsra()
+template <class Bus>
+void basic_cpu6502<Bus>::lsra()
 {
     set_carry(state.a & 1);
 
@@ -424,7 +536,8 @@ void cpu6502::lsra()
 
     test_zn(state.a);
 }
-void cpu6502::lsr(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::lsr(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -436,7 +549,8 @@ void cpu6502::lsr(uint16_t addr)
 
     write(addr, val); cycle();
 }
-void cpu6502::rola()
+template <class Bus>
+void basic_cpu6502<Bus>::rola()
 {
     bool old_carry = carry();
     set_carry(bit_get(state.a, 7));
@@ -446,7 +560,8 @@ void cpu6502::rola()
 
     test_zn(state.a);
 }
-void cpu6502::rol(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::rol(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -461,7 +576,8 @@ void cpu6502::rol(uint16_t addr)
 
     write(addr, val); cycle();
 }
-void cpu6502::rora()
+template <class Bus>
+void basic_cpu6502<Bus>::rora()
 {
     bool old_carry = carry();
     set_carry(bit_get(state.a, 0));
@@ -471,7 +587,8 @@ void cpu6502::rora()
 
     test_zn(state.a);
 }
-void cpu6502::ror(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::ror(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -487,45 +604,54 @@ void cpu6502::ror(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::nop()
+template <class Bus>
+void basic_cpu6502<Bus>::nop()
 {
 }
 
-void cpu6502::nop2(uint16_t)
+template <class Bus>
+void basic_cpu6502<Bus>::nop2(uint16_t)
 {
 }
 
-void cpu6502::pha()
+template <class Bus>
+void basic_cpu6502<Bus>::pha()
 {
     push(state.a);
 }
-void cpu6502::pla()
+template <class Bus>
+void basic_cpu6502<Bus>::pla()
 {
     cycle();
     state.a = pop();
     test_zn(state.a);
 }
-void cpu6502::phx()
+template <class Bus>
+void basic_cpu6502<Bus>::phx()
 {
     push(state.x);
 }
-void cpu6502::plx()
+template <class Bus>
+void basic_cpu6502<Bus>::plx()
 {
     cycle();
     state.x = pop();
     test_zn(state.x);
 }
-void cpu6502::phy()
+template <class Bus>
+void basic_cpu6502<Bus>::phy()
 {
     push(state.y);
 }
-void cpu6502::ply()
+template <class Bus>
+void basic_cpu6502<Bus>::ply()
 {
     cycle();
     state.y = pop();
     test_zn(state.y);
 }
-void cpu6502::php()
+template <class Bus>
+void basic_cpu6502<Bus>::php()
 {
     if constexpr (flavor == WDC65c02)
     {
@@ -536,25 +662,29 @@ void cpu6502::php()
         push(state.flags | 0b10000); // BRK flag set
     }
 }
-void cpu6502::plp()
+template <class Bus>
+void basic_cpu6502<Bus>::plp()
 {
     cycle();
     state.flags = pop() | 0b100000; // set bit 5
     m_int_delay = true;
 }
-void cpu6502::rmb(uint8_t bit, uint8_t zp_addr)
+template <class Bus>
+void basic_cpu6502<Bus>::rmb(uint8_t bit, uint8_t zp_addr)
 {
     uint8_t val = read(zp_addr);
     bit_clear(val, bit);
     write(zp_addr, val);
 }
-void cpu6502::smb(uint8_t bit, uint8_t zp_addr)
+template <class Bus>
+void basic_cpu6502<Bus>::smb(uint8_t bit, uint8_t zp_addr)
 {
     uint8_t val = read(zp_addr);
     bit_set(val, bit);
     write(zp_addr, val);
 }
-void cpu6502::rti()
+template <class Bus>
+void basic_cpu6502<Bus>::rti()
 {
     cycle(); // increment S
     state.flags = (pop() & ~0b10000) | 0b100000; // clear BRK flag and set bit 5
@@ -563,61 +693,72 @@ void cpu6502::rti()
     uint8_t high = pop();
     state.pc = ((high << 8) | low);
 }
-void cpu6502::rts()
+template <class Bus>
+void basic_cpu6502<Bus>::rts()
 {
     cycle(); // <=> increment S
     uint8_t low  = pop();
     uint8_t high = pop();
     state.pc = ((high << 8) | low) + 1; cycle();
 }
-void cpu6502::trb(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::trb(uint16_t addr)
 {
     uint8_t val = read(addr);
     test_zn(state.a & val);
     val &= ~state.a;
     write(addr, val);
 }
-void cpu6502::tsb(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::tsb(uint16_t addr)
 {
     uint8_t val = read(addr);
     test_zn(state.a & val);
     val |= state.a;
     write(addr, val);
 }
-void cpu6502::tax()
+template <class Bus>
+void basic_cpu6502<Bus>::tax()
 {
     state.x = state.a;
     test_zn(state.x);
 }
-void cpu6502::txa()
+template <class Bus>
+void basic_cpu6502<Bus>::txa()
 {
     state.a = state.x;
     test_zn(state.a);
 }
-void cpu6502::tay()
+template <class Bus>
+void basic_cpu6502<Bus>::tay()
 {
     state.y = state.a;
     test_zn(state.y);
 }
-void cpu6502::tya()
+template <class Bus>
+void basic_cpu6502<Bus>::tya()
 {
     state.a = state.y;
     test_zn(state.a);
 }
-void cpu6502::tsx()
+template <class Bus>
+void basic_cpu6502<Bus>::tsx()
 {
     state.x = state.sp;
     test_zn(state.x);
 }
-void cpu6502::txs()
+template <class Bus>
+void basic_cpu6502<Bus>::txs()
 {
     state.sp = state.x;
 }
-void cpu6502::stp()
+template <class Bus>
+void basic_cpu6502<Bus>::stp()
 {
     m_stopped = true;
 }
-void cpu6502::wai()
+template <class Bus>
+void basic_cpu6502<Bus>::wai()
 {
     /* The above is true of an IRQ when the I (interrupt disable) flag is clear (i.e. interrupts are enabled).
      *  WAI is also useful with IRQs when the I flag is set (i.e. interrupts are disabled).
@@ -628,7 +769,8 @@ void cpu6502::wai()
     m_wait_interrupt = true;
 }
 
-void cpu6502::alr(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::alr(uint16_t addr)
 {
     state.a &= read(addr); cycle();
 
@@ -639,14 +781,16 @@ void cpu6502::alr(uint16_t addr)
     test_zn(state.a);
 }
 
-void cpu6502::anc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::anc(uint16_t addr)
 {
     state.a &= read(addr); cycle();
     test_zn(state.a);
     set_carry(state.flags & Flags::Neg);
 }
 
-void cpu6502::arr(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::arr(uint16_t addr)
 {
     bool old_carry = carry();
 
@@ -660,7 +804,8 @@ void cpu6502::arr(uint16_t addr)
     set_overflow(((state.a >> 6) & 1) ^ ((state.a >> 5) & 1));
 }
 
-void cpu6502::axs(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::axs(uint16_t addr)
 {
     int new_x = (state.x & state.a) - read(addr); cycle();
 
@@ -671,19 +816,22 @@ void cpu6502::axs(uint16_t addr)
     test_zn(state.x);
 }
 
-void cpu6502::lax(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::lax(uint16_t addr)
 {
     state.a = read(addr); cycle();
     state.x = state.a;
     test_zn(state.a);
 }
 
-void cpu6502::sax(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::sax(uint16_t addr)
 {
     write(addr, state.a & state.x); cycle();
 }
 
-void cpu6502::dcp(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::dcp(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -697,7 +845,8 @@ void cpu6502::dcp(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::isc(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::isc(uint16_t addr)
 {
     uint8_t value = read(addr); cycle();
     write(addr, value); cycle(); // dummy write
@@ -740,7 +889,8 @@ void cpu6502::isc(uint16_t addr)
     write(addr, value); cycle();
 }
 
-void cpu6502::rla(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::rla(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -758,7 +908,8 @@ void cpu6502::rla(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::rra(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::rra(uint16_t addr)
 {
     uint8_t value = read(addr); cycle();
     write(addr, value); cycle(); // dummy write
@@ -807,7 +958,8 @@ void cpu6502::rra(uint16_t addr)
     state.a = result8;
 }
 
-void cpu6502::slo(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::slo(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -822,7 +974,8 @@ void cpu6502::slo(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::sre(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::sre(uint16_t addr)
 {
     uint8_t val = read(addr); cycle();
     write(addr, val); cycle(); // dummy write
@@ -837,14 +990,16 @@ void cpu6502::sre(uint16_t addr)
     write(addr, val); cycle();
 }
 
-void cpu6502::atx(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::atx(uint16_t addr)
 {
     state.a = read(addr); cycle();
     state.x = state.a;
     test_zn(state.a);
 }
 
-void cpu6502::say(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::say(uint16_t addr)
 {
     // what a weird instruction
 
@@ -861,7 +1016,8 @@ void cpu6502::say(uint16_t addr)
     }
 }
 
-void cpu6502::xas(uint16_t addr)
+template <class Bus>
+void basic_cpu6502<Bus>::xas(uint16_t addr)
 {
     // what a weird instruction
 
@@ -878,9 +1034,12 @@ void cpu6502::xas(uint16_t addr)
     }
 }
 
-void cpu6502::invalid_opcode()
+template <class Bus>
+void basic_cpu6502<Bus>::invalid_opcode()
 {
     char buffer[64];
     snprintf(buffer, 64, "Invalid opcode 0x%02x at 0x%04x\n", read(state.pc-1), state.pc-1);
     log(buffer);
 }
+
+#endif // INSTRUCTIONS_HPP
@@ -0,0 +1,457 @@
+﻿/*
+opcode_table.hpp
+
+Copyright (c) 27 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef OPCODE_TABLE_HPP
+#define OPCODE_TABLE_HPP
+
+#include "../cpu.hpp"
+
+#include <array>
+#include <utility>
+#include <variant>
+
+#include "common/tmputils.hpp"
+
+template <class Cpu>
+struct OpcodeEntry
+{
+    const char name[4];
+    std::variant<void(Cpu::*)(uint16_t addr),
+    void(Cpu::*)(),
+    void(Cpu::*)(uint8_t imm),
+    void(Cpu::*)(uint8_t bit, uint8_t val, int8_t branch),
+    void(Cpu::*)(uint8_t bit, uint8_t zp_addr)> callback;
+    uint8_t addrmode_ops[cpu6502_base::AddrModesCount];
+    bool no_mem_write;
+    bool illegal = false;
+    bool bus_conflict_illegal_op = false;
+};
+template <class Cpu>
+using opcode_callback = void(*)(Cpu&);
+
+template <class Cpu>
+inline constexpr OpcodeEntry<Cpu> opcode_defs[] = {
+    /*   name      callback    impl imm/rel zp   zpx   zpy   abs   abx   aby   izx   izy   izp   ind   iax  bitrel bitzp read? invl? corr_invl? */
+    {"nop", &Cpu::nop ,  {0xEA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"adc", &Cpu::adc ,  {0x00, 0x69, 0x65, 0x75, 0x00, 0x6d, 0x7d, 0x79, 0x61, 0x71, 0x72, 0x00, 0x00, 0x00, 0x00}, true },
+    {"and", &Cpu::and_,  {0x00, 0x29, 0x25, 0x35, 0x00, 0x2d, 0x3d, 0x39, 0x21, 0x31, 0x32, 0x00, 0x00, 0x00, 0x00}, true },
+    {"asl", &Cpu::asl,   {0x00, 0x00, 0x06, 0x16, 0x00, 0x0e, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"asl", &Cpu::asla,  {0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bbr", &Cpu::bbr ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x00}, true },
+    {"bbs", &Cpu::bbs ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x8F, 0x00}, true },
+    {"bcc", &Cpu::bcc ,  {0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bcs", &Cpu::bcs ,  {0x00, 0xB0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"beq", &Cpu::beq ,  {0x00, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bit", &Cpu::bit ,  {0x00, 0x89, 0x24, 0x34, 0x00, 0x2c, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bmi", &Cpu::bmi ,  {0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bne", &Cpu::bne ,  {0x00, 0xD0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bpl", &Cpu::bpl ,  {0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bra", &Cpu::bra ,  {0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"brk", &Cpu::brk ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bvc", &Cpu::bvc ,  {0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"bvs", &Cpu::bvs ,  {0x00, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"clc", &Cpu::clc ,  {0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"cld", &Cpu::cld ,  {0xD8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"cli", &Cpu::cli ,  {0x58, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"clv", &Cpu::clv ,  {0xB8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"cmp", &Cpu::cmp ,  {0x00, 0xC9, 0xC5, 0xD5, 0x00, 0xCD, 0xDD, 0xD9, 0xC1, 0xD1, 0xD2, 0x00, 0x00, 0x00, 0x00}, true },
+    {"cpx", &Cpu::cpx ,  {0x00, 0xE0, 0xE4, 0x00, 0x00, 0xEC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"cpy", &Cpu::cpy ,  {0x00, 0xC0, 0xC4, 0x00, 0x00, 0xCC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"dec", &Cpu::dec ,  {0x00, 0x00, 0xC6, 0xD6, 0x00, 0xCE, 0xDE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"dec", &Cpu::deca,  {0x3A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"dex", &Cpu::dex ,  {0xCA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"dey", &Cpu::dey ,  {0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"eor", &Cpu::eor ,  {0x00, 0x49, 0x45, 0x55, 0x00, 0x4d, 0x5d, 0x59, 0x41, 0x51, 0x52, 0x00, 0x00, 0x00, 0x00}, true },
+    /*   name      callback    impl imm/rel zp   zpx   zpy   abs   abx   aby   izx   izy   izp   ind   iax  bitrel bitzp */
+    {"inc", &Cpu::inc ,  {0x00, 0x00, 0xE6, 0xF6, 0x00, 0xEE, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"inc", &Cpu::inca,  {0x1A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"inx", &Cpu::inx ,  {0xE8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"iny", &Cpu::iny ,  {0xC8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"jmp", &Cpu::jmp ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x4C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"jmp",&Cpu::ind_jmp,{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6C, 0x7C, 0x00, 0x00}, true },
+    {"jsr", &Cpu::jsr ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"lda", &Cpu::lda ,  {0x00, 0xA9, 0xA5, 0xB5, 0x00, 0xAD, 0xBD, 0xB9, 0xA1, 0xB1, 0xB2, 0x00, 0x00, 0x00, 0x00}, true },
+    {"ldx", &Cpu::ldx ,  {0x00, 0xA2, 0xA6, 0x00, 0xB6, 0xAE, 0x00, 0xBE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"ldy", &Cpu::ldy ,  {0x00, 0xA0, 0xA4, 0xB4, 0x00, 0xAC, 0xBC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"lsr", &Cpu::lsr ,  {0x00, 0x00, 0x46, 0x56, 0x00, 0x4E, 0x5E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"lsr", &Cpu::lsra,  {0x4A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"ora", &Cpu::ora ,  {0x00, 0x09, 0x05, 0x15, 0x00, 0x0d, 0x1d, 0x19, 0x01, 0x11, 0x12, 0x00, 0x00, 0x00, 0x00}, true },
+    {"pha", &Cpu::pha ,  {0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"php", &Cpu::php ,  {0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"phx", &Cpu::phx ,  {0xDA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"phy", &Cpu::phy ,  {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false},
+    {"pla", &Cpu::pla ,  {0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"plp", &Cpu::plp ,  {0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"plx", &Cpu::plx ,  {0xFA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"ply", &Cpu::ply ,  {0x7A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"rmb", &Cpu::rmb ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07}, false },
+    {"smb", &Cpu::smb ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x87}, false },
+    {"rol", &Cpu::rol ,  {0x00, 0x00, 0x26, 0x36, 0x00, 0x2E, 0x3E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"rol", &Cpu::rola,  {0x2A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"ror", &Cpu::ror ,  {0x00, 0x00, 0x66, 0x76, 0x00, 0x6E, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"ror", &Cpu::rora,  {0x6A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"rti", &Cpu::rti ,  {0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"rts", &Cpu::rts ,  {0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    /*   name      callback    impl imm/rel zp   zpx   zpy   abs   abx   aby   izx   izy   izp   ind   iax  bitrel bitzp */
+    {"sbc", &Cpu::sbc ,  {0x00, 0xE9, 0xE5, 0xF5, 0x00, 0xED, 0xFD, 0xF9, 0xE1, 0xF1, 0xF2, 0x00, 0x00, 0x00, 0x00}, true },
+    {"sec", &Cpu::sec ,  {0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"sed", &Cpu::sed ,  {0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"sei", &Cpu::sei ,  {0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"sta", &Cpu::sta ,  {0x00, 0x00, 0x85, 0x95, 0x00, 0x8D, 0x9D, 0x99, 0x81, 0x91, 0x92, 0x00, 0x00, 0x00, 0x00}, false },
+    {"stx", &Cpu::stx ,  {0x00, 0x00, 0x86, 0x00, 0x96, 0x8E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"sty", &Cpu::sty ,  {0x00, 0x00, 0x84, 0x94, 0x00, 0x8C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"stp", &Cpu::stp ,  {0xDB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"stz", &Cpu::stz ,  {0x00, 0x00, 0x64, 0x74, 0x00, 0x9C, 0x9E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false },
+    {"tax", &Cpu::tax ,  {0xAA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"tay", &Cpu::tay ,  {0xA8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"trb", &Cpu::trb ,  {0x00, 0x00, 0x14, 0x00, 0x00, 0x1C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"tsb", &Cpu::tsb ,  {0x00, 0x00, 0x04, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"tsx", &Cpu::tsx ,  {0xBA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"txs", &Cpu::txs ,  {0x9A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"txa", &Cpu::txa ,  {0x8A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"tya", &Cpu::tya ,  {0x98, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+    {"wai", &Cpu::wai ,  {0xCB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true },
+
+    // undocumented opcodes
+    // nops
+    /*   name      callback    impl imm/rel zp   zpx   zpy   abs   abx   aby   izx   izy   izp   ind   iax  bitrel bitzp */
+    {"nop", &Cpu::nop ,  {0x1A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"nop", &Cpu::nop ,  {0x3A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"nop", &Cpu::nop ,  {0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"nop", &Cpu::nop ,  {0x7A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"nop", &Cpu::nop ,  {0xDA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"nop", &Cpu::nop ,  {0xFA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"skp", &Cpu::nop2,  {0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"skp", &Cpu::nop2,  {0x00, 0x82, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"skp", &Cpu::nop2,  {0x00, 0x89, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"skp", &Cpu::nop2,  {0x00, 0xC2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"skp", &Cpu::nop2,  {0x00, 0xE2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xDC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0xD4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"ign", &Cpu::nop2,  {0x00, 0x00, 0x00, 0xF4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"sbc", &Cpu::sbc ,  {0x00, 0xE9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"sbc", &Cpu::sbc ,  {0x00, 0xEB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"alr", &Cpu::alr ,  {0x00, 0x4B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"anc", &Cpu::anc ,  {0x00, 0x0B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"anc", &Cpu::anc ,  {0x00, 0x2B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"arr", &Cpu::arr ,  {0x00, 0x6B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"axs", &Cpu::axs ,  {0x00, 0xCB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"lax", &Cpu::lax ,  {0x00, 0x00, 0xA7, 0x00, 0xB7, 0xAF, 0x00, 0xBF, 0xA3, 0xB3, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    {"sax", &Cpu::sax ,  {0x00, 0x00, 0x87, 0x00, 0x97, 0x8F, 0x00, 0x00, 0x83, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true, true },
+    /*   name      callback    impl imm/rel zp   zpx   zpy   abs   abx   aby   izx   izy   izp   ind   iax  bitrel bitzp read?  invl? busbad? */
+    {"dcp", &Cpu::dcp ,  {0x00, 0x00, 0xC7, 0xD7, 0x00, 0xCF, 0xDF, 0xDB, 0xC3, 0xD3, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"isc", &Cpu::isc ,  {0x00, 0x00, 0xE7, 0xF7, 0x00, 0xEF, 0xFF, 0xFB, 0xE3, 0xF3, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"rla", &Cpu::rla ,  {0x00, 0x00, 0x27, 0x37, 0x00, 0x2F, 0x3F, 0x3B, 0x23, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"rra", &Cpu::rra ,  {0x00, 0x00, 0x67, 0x77, 0x00, 0x6F, 0x7F, 0x7B, 0x63, 0x73, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"slo", &Cpu::slo ,  {0x00, 0x00, 0x07, 0x17, 0x00, 0x0F, 0x1F, 0x1B, 0x03, 0x13, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"sre", &Cpu::sre ,  {0x00, 0x00, 0x47, 0x57, 0x00, 0x4F, 0x5F, 0x5B, 0x43, 0x53, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true },
+    {"atx", &Cpu::atx ,  {0x00, 0xAB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, true,  true },
+    {"say", &Cpu::say ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x9C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true, true },
+    {"xas", &Cpu::xas ,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x9E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, false, true, true },
+    // TODO : axa, tas
+};
+
+// what an opcode decodes to
+struct opcode_decode
+{
+    enum Kind : uint8_t
+    {
+        Invalid,
+        Break,
+        Operation,   // opcode_defs[idx] with addressing mode 'mode'
+        BitRelative, // 65c02 bbr/bbs on bit 'bit'
+        BitZP,       // 65c02 rmb/smb on bit 'bit'
+        IllegalNop   // undocumented opcode on the 65c02, which executes it as a NOP
+    } kind;
+    uint8_t idx;
+    uint8_t mode;
+    uint8_t bit;
+};
+
+template <class Cpu>
+inline constexpr std::array<opcode_decode, 256> gen_decode()
+{
+    std::array<opcode_decode, 256> decode {};
+    for (size_t idx { 0 }; idx < std::size(opcode_defs<Cpu>); ++idx)
+    {
+        const OpcodeEntry<Cpu>& def = opcode_defs<Cpu>[idx];
+        for (uint8_t mode { 0 }; mode < cpu6502_base::AddrModesCount; ++mode)
+        {
+            const uint8_t op = def.addrmode_ops[mode];
+            if (op == 0)
+                continue;
+
+            if (def.illegal && Cpu::flavor == WDC65c02)
+            {
+                decode[op] = {opcode_decode::IllegalNop, 0, cpu6502_base::Immediate, 0};
+            }
+            else if (mode == cpu6502_base::BitRelative || mode == cpu6502_base::BitZP)
+            {
+                for (uint8_t bit { 0 }; bit < 8; ++bit)
+                {
+                    decode[op + bit*0x10] = {mode == cpu6502_base::BitRelative ? opcode_decode::BitRelative : opcode_decode::BitZP,
+                                             (uint8_t)idx, mode, bit};
+                }
+            }
+            else
+            {
+                uint8_t actual_mode = mode;
+                if (def.bus_conflict_illegal_op)
+                    actual_mode = cpu6502_base::BusConflictInvalid;
+                else if (mode == cpu6502_base::AbsoluteX && !def.no_mem_write)
+                    actual_mode = cpu6502_base::AbsoluteXWrite;
+                else if (mode == cpu6502_base::AbsoluteY && !def.no_mem_write)
+                    actual_mode = cpu6502_base::AbsoluteYWrite;
+                else if (mode == cpu6502_base::IndZeroY && !def.no_mem_write)
+                    actual_mode = cpu6502_base::IndZeroYWrite;
+
+                decode[op] = {opcode_decode::Operation, (uint8_t)idx, actual_mode, 0};
+            }
+        }
+    }
+    decode[0x00] = {opcode_decode::Break, 0, cpu6502_base::Implied, 0};
+
+    return decode;
+}
+
+template <class Cpu>
+inline constexpr std::array<opcode_decode, 256> decode_table = gen_decode<Cpu>();
+
+// the bytes an opcode is made of, and the cycles spent fetching them before its other accesses
+struct opcode_fetch
+{
+    uint8_t length; // 0 : can't be decoded
+    uint8_t cycles;
+};
+
+inline constexpr opcode_fetch fetch_of(opcode_decode decode)
+{
+    switch (decode.kind)
+    {
+        case opcode_decode::Invalid:     return {0, 0};
+        case opcode_decode::Break:       return {1, 2}; // the byte after the opcode is skipped, not read
+        case opcode_decode::IllegalNop:  return {2, 1};
+        case opcode_decode::BitRelative: return {3, 3};
+        case opcode_decode::BitZP:       return {2, 2};
+        case opcode_decode::Operation:   break;
+    }
+
+    switch (decode.mode)
+    {
+        case cpu6502_base::Implied:
+            return {1, 2}; // along with the dummy read
+        case cpu6502_base::Immediate:
+            return {2, 1}; // the operand is read by the instruction itself, on its cycle
+        case cpu6502_base::ZeroPage:  case cpu6502_base::ZeroPageX: case cpu6502_base::ZeroPageY:
+        case cpu6502_base::IndZeroX:  case cpu6502_base::IndZeroY:  case cpu6502_base::IndZeroYWrite:
+        case cpu6502_base::IndirectZP:
+            return {2, 2};
+        case cpu6502_base::Absolute:  case cpu6502_base::AbsoluteX: case cpu6502_base::AbsoluteY:
+        case cpu6502_base::AbsoluteXWrite: case cpu6502_base::AbsoluteYWrite:
+        case cpu6502_base::Indirect:  case cpu6502_base::IndirectX: case cpu6502_base::BusConflictInvalid:
+            return {3, 3};
+        default:
+            return {0, 0};
+    }
+}
+
+template <class Cpu>
+inline constexpr std::array<opcode_fetch, 256> gen_fetch()
+{
+    std::array<opcode_fetch, 256> fetch {};
+    for (unsigned op { 0 }; op < 256; ++op)
+        fetch[op] = fetch_of(decode_table<Cpu>[op]);
+    return fetch;
+}
+
+template <class Cpu>
+inline constexpr std::array<opcode_fetch, 256> fetch_table = gen_fetch<Cpu>();
+
+// Fuses the addressing mode and the operation of an opcode, the callbacks being compile-time constants they can be inlined.
+// decoded : run from a decoded_op, see basic_cpu6502::decode()
+template <class Cpu, uint8_t op, bool decoded = false>
+[[gnu::always_inline]] inline void execute_opcode(Cpu& cpu, [[maybe_unused]] const uint8_t* operands = nullptr)
+{
+    constexpr opcode_decode decode = decode_table<Cpu>[op];
+    constexpr const OpcodeEntry<Cpu>& def = opcode_defs<Cpu>[decode.idx];
+
+    if constexpr (decode.kind == opcode_decode::Invalid)
+    {
+        cpu.invalid_opcode();
+    }
+    else if constexpr (decode.kind == opcode_decode::Break)
+    {
+        if constexpr (!decoded)
+            cpu.cycle();
+        cpu.brk();
+    }
+    else if constexpr (decode.kind == opcode_decode::IllegalNop)
+    {
+        cpu.nop2(cpu.template addr_mode_get<cpu6502_base::Immediate, decoded>(operands));
+    }
+    else if constexpr (decode.kind == opcode_decode::BitRelative)
+    {
+        uint8_t    val = cpu.template fetch_operand<decoded>(operands, 0);
+        int8_t  branch = cpu.template fetch_operand<decoded>(operands, 1);
+        constexpr auto callback = std::get<3>(def.callback);
+        (cpu.*callback)(decode.bit, val, branch);
+    }
+    else if constexpr (decode.kind == opcode_decode::BitZP)
+    {
+        uint8_t    zp_addr = cpu.template fetch_operand<decoded>(operands, 0);
+        constexpr auto callback = std::get<4>(def.callback);
+        (cpu.*callback)(decode.bit, zp_addr);
+    }
+    else if constexpr (decode.mode == cpu6502_base::Implied)
+    {
+        if constexpr (!decoded)
+            cpu.cycle(); // dummy instruction read
+        constexpr auto callback = std::get<1>(def.callback);
+        (cpu.*callback)();
+    }
+    else
+    {
+        uint16_t addr = cpu.template addr_mode_get<(cpu6502_base::AddrModes)decode.mode, decoded>(operands);
+        constexpr auto callback = std::get<0>(def.callback);
+        (cpu.*callback)(addr);
+    }
+}
+
+// Runs an opcode from its decoded_op : the cycles of its fetches are spent, at once when the bus allows it
+template <class Cpu, uint8_t op>
+[[gnu::flatten]] void execute_decoded(Cpu& cpu, const typename Cpu::decoded_op& decoded)
+{
+    constexpr opcode_fetch fetch = fetch_table<Cpu>[op];
+
+    // a copy : the bus may drop what was decoded while the cpu waits on a cycle
+    const uint8_t operands[2] { decoded.operands[0], decoded.operands[1] };
+
+    if (cpu.bus.quiet_cycles() >= fetch.cycles)
+    {
+        cpu.cycles += fetch.cycles;
+    }
+    else
+    {
+        static_for<fetch.cycles>([&cpu](auto) { cpu.cycle(); });
+    }
+
+    // the last byte fetched is left on the data bus
+    if constexpr (fetch.length > 1)
+        cpu.bus.latch(operands[fetch.length - 2]);
+    else
+        cpu.bus.latch(op);
+
+    ++cpu.state.pc;
+    execute_opcode<Cpu, op, true>(cpu, operands);
+}
+
+template <class Cpu>
+inline constexpr std::array<opcode_callback<Cpu>, 256> gen()
+{
+    std::array<opcode_callback<Cpu>, 256> opcodes {};
+    static_for<256>([&opcodes](auto op)
+    {
+        opcodes[op.value] = [](Cpu& cpu) { execute_opcode<Cpu, decltype(op)::value>(cpu); };
+    });
+    return opcodes;
+}
+
+template <class Cpu>
+inline constexpr std::array<char[4], 256> gen_mnemos()
+{
+    std::array<char[4], 256> mnemos {};
+    for (unsigned op = 0; op < 256; ++op)
+    {
+        mnemos[op][0] = 'b';
+        mnemos[op][1] = 'a';
+        mnemos[op][2] = 'd';
+        mnemos[op][3] = '\0';
+    }
+
+    for (const auto& tbl_entry : opcode_defs<Cpu>)
+    {
+        for (auto op : tbl_entry.addrmode_ops)
+        {
+            if (op == 0) continue;
+
+            mnemos[op][0] = tbl_entry.name[0];
+            mnemos[op][1] = tbl_entry.name[1];
+            mnemos[op][2] = tbl_entry.name[2];
+            mnemos[op][3] = tbl_entry.name[3];
+        }
+    }
+    // manually set opcode 0x00 as brk
+    mnemos[0][0] = 'b';
+    mnemos[0][1] = 'r';
+    mnemos[0][2] = 'k';
+    mnemos[0][3] = '\0';
+
+    return mnemos;
+}
+
+template <class Cpu>
+inline constexpr std::array<opcode_callback<Cpu>, 256> opcode_callbacks = gen<Cpu>();
+
+template <class Cpu>
+using decoded_callback = void(*)(Cpu&, const typename Cpu::decoded_op&);
+
+template <class Cpu>
+inline constexpr std::array<decoded_callback<Cpu>, 256> gen_decoded()
+{
+    std::array<decoded_callback<Cpu>, 256> opcodes {};
+    static_for<256>([&opcodes](auto op)
+    {
+        opcodes[op.value] = &execute_decoded<Cpu, decltype(op)::value>;
+    });
+    return opcodes;
+}
+
+template <class Cpu>
+inline constexpr std::array<decoded_callback<Cpu>, 256> decoded_callbacks = gen_decoded<Cpu>();
+
+// every opcode, in order, to generate the switch of run()
+#define CPU6502_OPCODES_ROW(X, hi) \
+    X(hi##0) X(hi##1) X(hi##2) X(hi##3) X(hi##4) X(hi##5) X(hi##6) X(hi##7) \
+    X(hi##8) X(hi##9) X(hi##A) X(hi##B) X(hi##C) X(hi##D) X(hi##E) X(hi##F)
+#define CPU6502_OPCODES(X) \
+    CPU6502_OPCODES_ROW(X, 0x0) CPU6502_OPCODES_ROW(X, 0x1) CPU6502_OPCODES_ROW(X, 0x2) CPU6502_OPCODES_ROW(X, 0x3) \
+    CPU6502_OPCODES_ROW(X, 0x4) CPU6502_OPCODES_ROW(X, 0x5) CPU6502_OPCODES_ROW(X, 0x6) CPU6502_OPCODES_ROW(X, 0x7) \
+    CPU6502_OPCODES_ROW(X, 0x8) CPU6502_OPCODES_ROW(X, 0x9) CPU6502_OPCODES_ROW(X, 0xA) CPU6502_OPCODES_ROW(X, 0xB) \
+    CPU6502_OPCODES_ROW(X, 0xC) CPU6502_OPCODES_ROW(X, 0xD) CPU6502_OPCODES_ROW(X, 0xE) CPU6502_OPCODES_ROW(X, 0xF)
+
+#endif // OPCODE_TABLE_HPP
@@ -30,7 +30,7 @@ SOFTWARE.
 #include "common/coroutine.hpp"
 
 class PPU;
-class cpu6502;
+class cpu6502_base;
 class InputAdapter;
 
 class IORegs : public MemoryInterfaceable
@@ -41,7 +41,7 @@ public:
         OAMDMA = 0x14
     };
 
-    IORegs(cpu6502& cpu, aco_t* cpu_co, PPU& ppu, InputAdapter& input) : MemoryInterfaceable(0x20),
+    IORegs(cpu6502_base& cpu, aco_t* cpu_co, PPU& ppu, InputAdapter& input) : MemoryInterfaceable(0x20),
         m_cpu(cpu), m_cpu_co(cpu_co), m_ppu(ppu), m_input(input)
     {}
 
@@ -66,7 +66,7 @@ public:
     static std::array<read_callback, 0x20> m_read_clbks;
     static std::array<write_callback, 0x20> m_write_clbks;
 
-    cpu6502& m_cpu;
+    cpu6502_base& m_cpu;
     aco_t* m_cpu_co;
     PPU& m_ppu;
     InputAdapter& m_input;
@@ -0,0 +1,113 @@
+/*
+jit.hpp
+
+Copyright (c) 17 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef JIT6502_HPP
+#define JIT6502_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <deque>
+
+#include "cpu.hpp"
+
+// A block of code compiled to native code, see jit6502
+struct jit_block
+{
+    uint32_t (*entry)(void* frame); // null where nothing could be compiled
+    uint16_t pc;         // where the block starts : the same ROM may be mapped at other addresses
+    uint16_t max_cycles; // the block never spends more cycles than that before it goes through its code again
+};
+
+// Native code backend of the NES' 6502 : the blocks of code in ROM run most often are compiled to x86-64 functions.
+// A block is a run of official opcodes from a single page of ROM, which ends with a jump, a subroutine call or return,
+// or before an instruction that can't be compiled (interrupts, I flag, unofficial opcodes). Its branches and jumps to its
+// own instructions stay in the native code, so that the loops within a page run there, as long as the cycle budget of
+// the frame lasts ; the others leave it. Its reads and writes are resolved to host memory through the page tables of
+// the frame : when one of them isn't to plain memory (I/O, mapper registers...), the block is left before that
+// instruction, for the interpreter to run it. A block is only run when no interrupt is pending and the bus has nothing to
+// do during any of the cycles it may spend (see the Bus' quiet_cycles()), so that running it at once can't be observed :
+// the emulation stays cycle-exact. The idle loops are tracked as the interpreter does, the native code leaving the
+// block when one may be skipped.
+class jit6502
+{
+public:
+    // the native code can only be run on x86-64 unix hosts, elsewhere nothing is compiled
+    static const bool supported;
+
+    static constexpr uint8_t  hot_threshold = 16;   // a block is compiled the hot_threshold-th time its first instruction is run
+    static constexpr uint32_t loop_exit = 0x10000; // returned with the target of a branch back which closes an idle loop
+    static constexpr unsigned max_budget = 0x8000;  // the native code counts the cycles on 16 bits
+
+    // what the native code works on
+    struct frame
+    {
+        using registers = decltype(cpu6502_base::state);
+        using idle_loop = decltype(cpu6502_base::m_idle_loop);
+
+        registers regs;         // in and out
+        unsigned  cycles;       // in : the cpu's cycle count, out : once the block was run
+        unsigned  budget;       // in : the most cycles spent for the block to go through its code again
+        idle_loop loop;         // in and out, see basic_cpu6502::loop_back()
+        uint8_t   latch;        // out : the last value on the data bus
+        uint16_t  instructions; // out : the instructions run, 0 if the block was left before its first one
+
+        // for each page of the cpu's address space, the host address its reads (without side-effects) or its writes
+        // (only storing the value) are resolved to, minus the address of the page ; 0 if they must go through the bus
+        std::array<uintptr_t, 0x100> read_pages;
+        std::array<uintptr_t, 0x100> write_pages;
+    } frame {};
+
+    jit6502();
+    ~jit6502();
+
+    jit6502(const jit6502&) = delete;
+    jit6502& operator=(const jit6502&) = delete;
+
+public:
+    void map_page(unsigned page, const uint8_t* read, uint8_t* write);
+    void unmap_pages();
+
+    // compiles the block starting at pc, code being the page of ROM pc is in ; the block can't be run if its entry is null
+    const jit_block* compile(const uint8_t* code, uint16_t pc);
+
+    // 0, or loop_exit | target when the block was left by a branch back to target which closes an idle loop : pc is
+    // then the address after the branch, see basic_cpu6502::loop_back()
+    uint32_t run(const jit_block& block)
+    { return block.entry(&frame); }
+
+    // true once the code buffer is nearly full : the blocks must then be dropped and clear() called
+    bool full() const;
+    void clear();
+
+    size_t blocks() const
+    { return m_blocks.size(); }
+
+private:
+    uint8_t* m_code { nullptr }; // executable, and only writable while a block is copied in
+    size_t   m_code_used { 0 };
+    std::deque<jit_block> m_blocks;
+};
+
+#endif // JIT6502_HPP
@@ -24,15 +24,14 @@ SOFTWARE.
 */
 
 #include "cpu.hpp"
+#include "cpu_impl.hpp"
 
 #include <array>
 #include <cstdio>
 
 #include "interface/memory.hpp"
 
-extern const std::array<void(*)(cpu6502&), 256> opcodes;
-
-void cpu6502::pull_nmi_low()
+void cpu6502_base::pull_nmi_low()
 {
     if (m_nmi_line_state != 0)
     {
@@ -41,149 +40,48 @@ void cpu6502::pull_nmi_low()
     m_nmi_line_state = 0;
 }
 
-void cpu6502::pull_nmi_high()
+void cpu6502_base::pull_nmi_high()
 {
     m_nmi_line_state = 1;
 }
 
-void cpu6502::pull_irq_low()
+void cpu6502_base::pull_irq_low()
 {
     if (interrupts_enabled())
     {
         m_irq_pending = true;
     }
-    if constexpr (flavor == cpu_type::WDC65c02)
-    {
-        m_wait_interrupt = false;
-    }
+    m_wait_interrupt = false; // only ever set on the 65c02
 }
 
-void cpu6502::raise_nmi()
+void cpu6502_base::raise_nmi()
 {
     m_nmi_pending = true;
 
-    if constexpr (flavor == cpu_type::WDC65c02)
-    {
-        m_wait_interrupt = false;
-    }
-}
-
-void cpu6502::reset()
-{
-    state.a = state.x = state.y = 0;
-    state.flags = 0b00110100;
-    state.sp = 0xFD;
-
-    state.pc =  read(0xFFFC);
-    state.pc |= read(0xFFFD) << 8;
-
-    m_stopped        = false;
-    m_int_delay      = false;
-    m_wait_interrupt = false;
-}
-
-int found = false;
-
-void cpu6502::run(unsigned steps)
-{
-    for (size_t i { 0 }; i < steps; ++i)
-    {
-        if constexpr (flavor == cpu_type::WDC65c02) // other versions don't have STP and WAI
-        {
-            if (stopped() || m_wait_interrupt)
-            {
-                return;
-            }
-        }
-
-        m_int_delay = false;
-
-        uint8_t opcode = fetch_opcode();
-        cycle(); // first cycle : read opcode, increment PC
-
-        auto operation = opcodes[opcode];
-
-        operation(*this);
-
-        // check interrupts
-        if (!m_int_delay)
-        {
-            if (m_nmi_pending)
-            {
-                m_nmi_pending = false;
-                switch_to_isr(0xFFFA);
-            }
-            if (m_irq_pending)
-            {
-                m_irq_pending = false;
-                switch_to_isr(0xFFFE);
-            }
-        }
-    }
-}
-
-uint8_t cpu6502::fetch_opcode()
-{
-    return read(state.pc++);
+    m_wait_interrupt = false; // only ever set on the 65c02
 }
 
-void cpu6502::switch_to_isr(uint16_t vector, bool brk)
+void cpu6502_base::serialize(StateStream& stream)
 {
-    push(state.pc >> 8);
-    push(state.pc & 0xFF);
-    if constexpr (flavor == WDC65c02)
-    {
-        if (brk)
-            push((state.flags & ~0b01000) | 0b10000); // with D flag unset
-        else
-            push(state.flags & ~0b11000); // with B and D flag unset
-    }
-    else
+    stream.io(state.a); stream.io(state.x); stream.io(state.y);
+    stream.io(state.sp); stream.io(state.flags); stream.io(state.pc);
+    stream.io(cycles);
+    stream.io(m_nmi_line_state);
+    stream.io(m_stopped);
+    stream.io(m_irq_pending);
+    stream.io(m_nmi_pending);
+    stream.io(m_int_delay);
+    stream.io(m_wait_interrupt);
+
+    if (stream.loading())
     {
-        if (brk)
-            push(state.flags | 0b10000);
-        else
-            push(state.flags & ~0b10000); // with B flag unset
+        // the idle loop detection starts over
+        m_idle_loop.clean = false;
     }
-
-    uint16_t new_pc = 0;
-    new_pc  = read(vector  ); set_int_disable(true); cycle();
-    new_pc |= read(vector+1) << 8;                   cycle();
-
-    state.pc = new_pc;
 }
 
-void cpu6502::branch_on(int8_t disp, bool cond)
-{
-    cycle();
-    if (cond)
-    {
-        uint16_t addr = state.pc + disp;
-
-        if ((addr&0xFF00) != (state.pc&0xFF00)) // diff page
-        {
-            cycle();
-        }
-        cycle();
-
-        state.pc = addr;
-    }
-}
-
-void cpu6502::push(uint8_t val)
-{
-    write(0x100 + state.sp, val);
-    --state.sp;
-
-    cycle();
-}
-
-uint8_t cpu6502::pop()
-{
-    ++state.sp;
-    uint8_t val = read(0x100 + state.sp);
+int found = false;
 
-    cycle();
+const std::array<char[4], 256> cpu6502_base::opcode_mnemos = gen_mnemos<cpu6502>();
 
-    return val;
-}
+template class basic_cpu6502<callback_bus>;
@@ -129,7 +129,7 @@ void IORegs::oam_dma(uint8_t page)
     std::array<uint8_t, 256> data;
     for (size_t i { 0 }; i < 256; ++i)
     {
-        data[i] = m_cpu.read(((uint16_t)page)*256 + i);
+        data[i] = m_cpu.bus_read(((uint16_t)page)*256 + i);
     }
 
     m_ppu.oam_dma(data);
@@ -0,0 +1,1210 @@
+/*
+jit.cpp
+
+Copyright (c) 17 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "jit.hpp"
+
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__unix__)
+#define CPU6502_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef CPU6502_JIT
+const bool jit6502::supported = true;
+#else
+const bool jit6502::supported = false;
+#endif
+
+namespace
+{
+
+constexpr size_t code_capacity = 8 << 20;
+constexpr size_t max_block_code = 32 << 10; // far more than the longest block compiles to
+constexpr unsigned max_block_instructions = 64;
+constexpr unsigned max_block_cycles = 256;
+
+const jit_block no_block { nullptr, 0, 0 };
+
+using frame_t = decltype(jit6502::frame);
+using registers = frame_t::registers;
+using idle_loop = frame_t::idle_loop;
+
+constexpr int32_t frame_a     = offsetof(frame_t, regs) + offsetof(registers, a);
+constexpr int32_t frame_x     = offsetof(frame_t, regs) + offsetof(registers, x);
+constexpr int32_t frame_y     = offsetof(frame_t, regs) + offsetof(registers, y);
+constexpr int32_t frame_sp    = offsetof(frame_t, regs) + offsetof(registers, sp);
+constexpr int32_t frame_flags = offsetof(frame_t, regs) + offsetof(registers, flags);
+constexpr int32_t frame_pc    = offsetof(frame_t, regs) + offsetof(registers, pc);
+constexpr int32_t frame_cycles       = offsetof(frame_t, cycles);
+constexpr int32_t frame_budget       = offsetof(frame_t, budget);
+constexpr int32_t frame_latch        = offsetof(frame_t, latch);
+constexpr int32_t frame_instructions = offsetof(frame_t, instructions);
+constexpr int32_t frame_read_pages   = offsetof(frame_t, read_pages);
+constexpr int32_t frame_write_pages  = offsetof(frame_t, write_pages);
+
+constexpr int32_t frame_loop_head  = offsetof(frame_t, loop) + offsetof(idle_loop, head);
+constexpr int32_t frame_loop_tail  = offsetof(frame_t, loop) + offsetof(idle_loop, tail);
+constexpr int32_t frame_loop_start = offsetof(frame_t, loop) + offsetof(idle_loop, start_cycle);
+constexpr int32_t frame_loop_clean = offsetof(frame_t, loop) + offsetof(idle_loop, clean);
+constexpr int32_t frame_loop_regs  = offsetof(frame_t, loop) + offsetof(idle_loop, regs);
+
+static_assert(sizeof(registers::pc) == 2 && sizeof(frame_t::cycles) == 4 && sizeof(frame_t::budget) == 4
+              && sizeof(frame_t::instructions) == 2 && sizeof(idle_loop::head) == 2 && sizeof(idle_loop::tail) == 2
+              && sizeof(idle_loop::start_cycle) == 4 && sizeof(idle_loop::clean) == 1,
+              "the native code accesses these fields with their size");
+
+// the official opcodes, but those which can change the I flag or enter an interrupt handler (brk, rti, cli, sei, plp)
+enum class op : uint8_t
+{
+    none,
+    lda, ldx, ldy, adc, sbc, and_, ora, eor, cmp, cpx, cpy, bit, // reads
+    sta, stx, sty,                                               // writes
+    asl, lsr, rol, ror, inc, dec,                                // read-modify-writes
+    inx, iny, dex, dey, tax, tay, txa, tya, tsx, txs, clc, sec, clv, cld, sed, nop,
+    pha, php, pla,
+    bpl, bmi, bvc, bvs, bcc, bcs, bne, beq,
+    jmp, jmp_ind, jsr, rts
+};
+
+enum class mode : uint8_t
+{
+    imp, acc, imm, zp, zpx, zpy, abs, abx, aby, izx, izy
+};
+
+struct opcode_info
+{
+    op operation;
+    mode addressing;
+};
+
+struct opcode_def
+{
+    uint8_t opcode;
+    op operation;
+    mode addressing;
+};
+
+constexpr opcode_def opcode_defs[] =
+{
+    {0xA9, op::lda, mode::imm}, {0xA5, op::lda, mode::zp}, {0xB5, op::lda, mode::zpx}, {0xAD, op::lda, mode::abs},
+    {0xBD, op::lda, mode::abx}, {0xB9, op::lda, mode::aby}, {0xA1, op::lda, mode::izx}, {0xB1, op::lda, mode::izy},
+    {0xA2, op::ldx, mode::imm}, {0xA6, op::ldx, mode::zp}, {0xB6, op::ldx, mode::zpy}, {0xAE, op::ldx, mode::abs},
+    {0xBE, op::ldx, mode::aby},
+    {0xA0, op::ldy, mode::imm}, {0xA4, op::ldy, mode::zp}, {0xB4, op::ldy, mode::zpx}, {0xAC, op::ldy, mode::abs},
+    {0xBC, op::ldy, mode::abx},
+    {0x69, op::adc, mode::imm}, {0x65, op::adc, mode::zp}, {0x75, op::adc, mode::zpx}, {0x6D, op::adc, mode::abs},
+    {0x7D, op::adc, mode::abx}, {0x79, op::adc, mode::aby}, {0x61, op::adc, mode::izx}, {0x71, op::adc, mode::izy},
+    {0xE9, op::sbc, mode::imm}, {0xE5, op::sbc, mode::zp}, {0xF5, op::sbc, mode::zpx}, {0xED, op::sbc, mode::abs},
+    {0xFD, op::sbc, mode::abx}, {0xF9, op::sbc, mode::aby}, {0xE1, op::sbc, mode::izx}, {0xF1, op::sbc, mode::izy},
+    {0x29, op::and_, mode::imm}, {0x25, op::and_, mode::zp}, {0x35, op::and_, mode::zpx}, {0x2D, op::and_, mode::abs},
+    {0x3D, op::and_, mode::abx}, {0x39, op::and_, mode::aby}, {0x21, op::and_, mode::izx}, {0x31, op::and_, mode::izy},
+    {0x09, op::ora, mode::imm}, {0x05, op::ora, mode::zp}, {0x15, op::ora, mode::zpx}, {0x0D, op::ora, mode::abs},
+    {0x1D, op::ora, mode::abx}, {0x19, op::ora, mode::aby}, {0x01, op::ora, mode::izx}, {0x11, op::ora, mode::izy},
+    {0x49, op::eor, mode::imm}, {0x45, op::eor, mode::zp}, {0x55, op::eor, mode::zpx}, {0x4D, op::eor, mode::abs},
+    {0x5D, op::eor, mode::abx}, {0x59, op::eor, mode::aby}, {0x41, op::eor, mode::izx}, {0x51, op::eor, mode::izy},
+    {0xC9, op::cmp, mode::imm}, {0xC5, op::cmp, mode::zp}, {0xD5, op::cmp, mode::zpx}, {0xCD, op::cmp, mode::abs},
+    {0xDD, op::cmp, mode::abx}, {0xD9, op::cmp, mode::aby}, {0xC1, op::cmp, mode::izx}, {0xD1, op::cmp, mode::izy},
+    {0xE0, op::cpx, mode::imm}, {0xE4, op::cpx, mode::zp}, {0xEC, op::cpx, mode::abs},
+    {0xC0, op::cpy, mode::imm}, {0xC4, op::cpy, mode::zp}, {0xCC, op::cpy, mode::abs},
+    {0x24, op::bit, mode::zp}, {0x2C, op::bit, mode::abs},
+
+    {0x85, op::sta, mode::zp}, {0x95, op::sta, mode::zpx}, {0x8D, op::sta, mode::abs}, {0x9D, op::sta, mode::abx},
+    {0x99, op::sta, mode::aby}, {0x81, op::sta, mode::izx}, {0x91, op::sta, mode::izy},
+    {0x86, op::stx, mode::zp}, {0x96, op::stx, mode::zpy}, {0x8E, op::stx, mode::abs},
+    {0x84, op::sty, mode::zp}, {0x94, op::sty, mode::zpx}, {0x8C, op::sty, mode::abs},
+
+    {0x0A, op::asl, mode::acc}, {0x06, op::asl, mode::zp}, {0x16, op::asl, mode::zpx}, {0x0E, op::asl, mode::abs},
+    {0x1E, op::asl, mode::abx},
+    {0x4A, op::lsr, mode::acc}, {0x46, op::lsr, mode::zp}, {0x56, op::lsr, mode::zpx}, {0x4E, op::lsr, mode::abs},
+    {0x5E, op::lsr, mode::abx},
+    {0x2A, op::rol, mode::acc}, {0x26, op::rol, mode::zp}, {0x36, op::rol, mode::zpx}, {0x2E, op::rol, mode::abs},
+    {0x3E, op::rol, mode::abx},
+    {0x6A, op::ror, mode::acc}, {0x66, op::ror, mode::zp}, {0x76, op::ror, mode::zpx}, {0x6E, op::ror, mode::abs},
+    {0x7E, op::ror, mode::abx},
+    {0xE6, op::inc, mode::zp}, {0xF6, op::inc, mode::zpx}, {0xEE, op::inc, mode::abs}, {0xFE, op::inc, mode::abx},
+    {0xC6, op::dec, mode::zp}, {0xD6, op::dec, mode::zpx}, {0xCE, op::dec, mode::abs}, {0xDE, op::dec, mode::abx},
+
+    {0xE8, op::inx, mode::imp}, {0xC8, op::iny, mode::imp}, {0xCA, op::dex, mode::imp}, {0x88, op::dey, mode::imp},
+    {0xAA, op::tax, mode::imp}, {0xA8, op::tay, mode::imp}, {0x8A, op::txa, mode::imp}, {0x98, op::tya, mode::imp},
+    {0xBA, op::tsx, mode::imp}, {0x9A, op::txs, mode::imp},
+    {0x18, op::clc, mode::imp}, {0x38, op::sec, mode::imp}, {0xB8, op::clv, mode::imp}, {0xD8, op::cld, mode::imp},
+    {0xF8, op::sed, mode::imp}, {0xEA, op::nop, mode::imp},
+    {0x48, op::pha, mode::imp}, {0x08, op::php, mode::imp}, {0x68, op::pla, mode::imp},
+
+    {0x10, op::bpl, mode::imm}, {0x30, op::bmi, mode::imm}, {0x50, op::bvc, mode::imm}, {0x70, op::bvs, mode::imm},
+    {0x90, op::bcc, mode::imm}, {0xB0, op::bcs, mode::imm}, {0xD0, op::bne, mode::imm}, {0xF0, op::beq, mode::imm},
+    {0x4C, op::jmp, mode::abs}, {0x6C, op::jmp_ind, mode::abs}, {0x20, op::jsr, mode::abs}, {0x60, op::rts, mode::imp},
+};
+
+constexpr std::array<opcode_info, 256> gen_opcodes()
+{
+    std::array<opcode_info, 256> opcodes {};
+    for (const auto& def : opcode_defs)
+        opcodes[def.opcode] = {def.operation, def.addressing};
+    return opcodes;
+}
+
+constexpr std::array<opcode_info, 256> opcodes = gen_opcodes();
+
+constexpr bool is_read(op operation)
+{ return operation >= op::lda && operation <= op::bit; }
+constexpr bool is_write(op operation)
+{ return operation >= op::sta && operation <= op::sty; }
+constexpr bool is_rmw(op operation)
+{ return operation >= op::asl && operation <= op::dec; }
+constexpr bool is_branch(op operation)
+{ return operation >= op::bpl && operation <= op::beq; }
+
+constexpr unsigned length_of(mode addressing)
+{
+    switch (addressing)
+    {
+        case mode::imp: case mode::acc:
+            return 1;
+        case mode::abs: case mode::abx: case mode::aby:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// the cycles an instruction spends, as basic_cpu6502 counts them ; 'extra' is 1 where a page crossing may add one
+struct instruction_cycles
+{
+    unsigned base;
+    unsigned extra;
+};
+
+constexpr instruction_cycles cycles_of(op operation, mode addressing)
+{
+    switch (operation)
+    {
+        case op::pha: case op::php:             return {3, 0};
+        case op::pla:                           return {4, 0};
+        case op::jmp:                           return {3, 0};
+        case op::jmp_ind:                       return {5, 0};
+        case op::jsr: case op::rts:             return {6, 0};
+        default: break;
+    }
+    if (is_branch(operation))
+        return {2, 2}; // taken, and to another page
+
+    const unsigned rmw = is_rmw(operation) ? 2 : 0; // the dummy write and the write
+    switch (addressing)
+    {
+        case mode::imp: case mode::acc: case mode::imm:
+            return {2, 0};
+        case mode::zp:
+            return {3 + rmw, 0};
+        case mode::zpx: case mode::zpy: case mode::abs:
+            return {4 + rmw, 0};
+        case mode::abx: case mode::aby:
+            // writes always do the dummy read of the read crossing a page
+            return is_read(operation) ? instruction_cycles{4, 1} : instruction_cycles{5 + rmw, 0};
+        case mode::izx:
+            return {6, 0};
+        case mode::izy:
+            return is_read(operation) ? instruction_cycles{5, 1} : instruction_cycles{6, 0};
+    }
+    return {0, 0};
+}
+
+// x86-64 registers
+enum reg : uint8_t
+{
+    rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15
+};
+
+enum cond : uint8_t
+{
+    o = 0x0, no = 0x1, c = 0x2, nc = 0x3, z = 0x4, nz = 0x5, be = 0x6, a = 0x7, s = 0x8, ns = 0x9
+};
+
+enum alu : uint8_t
+{
+    add, or_, adc, sbb, and_, sub, xor_, cmp
+};
+
+enum shift : uint8_t
+{
+    rcl = 2, rcr = 3, shl = 4, shr = 5
+};
+
+// where the 6502 lives while a block runs : the registers in the low bytes of r8-r11, the carry and the overflow flags
+// as 0 or 1, the zero flag as a value which is 0 when it is set, the negative flag as bit 7 of a value, and the other
+// flags (I, D, B and bit 5) at their place in the flags register
+constexpr reg A = r8, X = r9, Y = r10, S = r11;
+constexpr reg C = r12, V = r13, Z = r14, N = r15, P = rbp;
+// the cycles spent, plus the instructions run from bit 16, but for those counted since at compile time (see
+// block_compiler::m_pending)
+constexpr reg counts = rbx;
+constexpr reg frame_ptr = rdi;
+
+// [base + index*(1 << scale) + disp]
+struct mem
+{
+    reg base;
+    int index;
+    int32_t disp;
+    uint8_t scale;
+};
+
+mem at(reg base, int32_t disp)
+{ return {base, -1, disp, 0}; }
+mem at(reg base, reg index, int32_t disp = 0, uint8_t scale = 0)
+{ return {base, index, disp, scale}; }
+
+class emitter
+{
+public:
+    std::vector<uint8_t> code;
+
+    size_t pos() const
+    { return code.size(); }
+
+    void mov8 (reg dst, reg src)              { rr(false, true,  {0x88}, src, dst); }
+    void alu8 (alu op, reg dst, reg src)      { rr(false, true,  {uint8_t(op*8)}, src, dst); }
+    void alu8 (alu op, reg dst, uint8_t imm)  { rr(false, true,  {0x80}, op, dst); byte(imm); }
+    void alu32(alu op, reg dst, reg src)      { rr(false, false, {uint8_t(op*8 + 1)}, src, dst); }
+    void alu32(alu op, reg dst, int32_t imm)  { rr(false, false, {0x81}, op, dst); dword(imm); }
+    void alu32(alu op, reg dst, const mem& m) { rm(false, false, {uint8_t(op*8 + 3)}, dst, m); }
+    void mov32(reg dst, reg src)              { rr(false, false, {0x89}, src, dst); }
+    void mov32(reg dst, uint32_t imm)         { rex(false, 0, 0, dst, false); byte(0xB8 + (dst & 7)); dword(imm); }
+    void movzx8(reg dst, reg src)             { rr(false, true,  {0x0F, 0xB6}, dst, src); }
+    void movzx8(reg dst, const mem& src)      { rm(false, false, {0x0F, 0xB6}, dst, src); }
+    void load64(reg dst, const mem& src)      { rm(true,  false, {0x8B}, dst, src); }
+    void store8 (const mem& dst, reg src)     { rm(false, true,  {0x88}, src, dst); }
+    void store8 (const mem& dst, uint8_t imm) { rm(false, false, {0xC6}, 0, dst); byte(imm); }
+    void store16(const mem& dst, reg src)     { byte(0x66); rm(false, false, {0x89}, src, dst); }
+    void store16(const mem& dst, uint16_t imm){ byte(0x66); rm(false, false, {0xC7}, 0, dst); byte(imm); byte(imm >> 8); }
+    void store32(const mem& dst, reg src)     { rm(false, false, {0x89}, src, dst); }
+    void cmp8 (const mem& dst, reg src)       { rm(false, true,  {0x38}, src, dst); }
+    void cmp8 (const mem& dst, uint8_t imm)   { rm(false, false, {0x80}, cmp, dst); byte(imm); }
+    void cmp32(const mem& dst, uint32_t imm)  { rm(false, false, {0x81}, cmp, dst); dword(imm); }
+    void cmp64(const mem& dst, int8_t imm)    { rm(true,  false, {0x83}, cmp, dst); byte(imm); }
+    void test8 (reg a, reg b)                 { rr(false, true,  {0x84}, b, a); }
+    void test64(reg a, reg b)                 { rr(true,  false, {0x85}, b, a); }
+    void shift8 (shift op, reg r)             { rr(false, true,  {0xD0}, op, r); } // by 1
+    void shift32(shift op, reg r, uint8_t n)  { rr(false, false, {0xC1}, op, r); byte(n); }
+    void inc8(reg r)                          { rr(false, true,  {0xFE}, 0, r); }
+    void dec8(reg r)                          { rr(false, true,  {0xFE}, 1, r); }
+    void setcc(cond cc, reg r)                { rr(false, true,  {0x0F, uint8_t(0x90 + cc)}, 0, r); }
+    void bt32(reg r, uint8_t bit)             { rr(false, false, {0x0F, 0xBA}, 4, r); byte(bit); }
+    void push(reg r)                          { rex(false, 0, 0, r, false); byte(0x50 + (r & 7)); }
+    void pop (reg r)                          { rex(false, 0, 0, r, false); byte(0x58 + (r & 7)); }
+    void ret()                                { byte(0xC3); }
+
+    // jumps, returning where their target is to be patched in
+    size_t jcc(cond cc)                       { byte(0x0F); byte(0x80 + cc); dword(0); return pos() - 4; }
+    size_t jmp()                              { byte(0xE9); dword(0); return pos() - 4; }
+    void   jmp(size_t target)                 { patch(jmp(), target); }
+
+    void patch(size_t jump, size_t target)
+    {
+        const int32_t rel = int32_t(target - (jump + 4));
+        std::memcpy(&code[jump], &rel, 4);
+    }
+
+private:
+    void byte(uint8_t val)
+    { code.push_back(val); }
+    void dword(uint32_t val)
+    {
+        for (unsigned i { 0 }; i < 4; ++i)
+            byte(val >> (i*8));
+    }
+
+    // always there for byte registers, so that 4-7 are spl, bpl, sil and dil rather than ah, ch, dh and bh
+    void rex(bool w, unsigned r, unsigned x, unsigned b, bool byte_regs)
+    {
+        const uint8_t prefix = 0x40 | w << 3 | (r >> 3) << 2 | (x >> 3) << 1 | (b >> 3);
+        if (prefix != 0x40 || byte_regs)
+            byte(prefix);
+    }
+    // register to register, 'r' being a register or an opcode extension
+    void rr(bool w, bool byte_regs, std::initializer_list<uint8_t> opcode, unsigned r, unsigned rm)
+    {
+        rex(w, r, 0, rm, byte_regs);
+        for (uint8_t val : opcode)
+            byte(val);
+        byte(0xC0 | (r & 7) << 3 | (rm & 7));
+    }
+    void rm(bool w, bool byte_regs, std::initializer_list<uint8_t> opcode, unsigned r, const mem& m)
+    {
+        rex(w, r, m.index < 0 ? 0 : m.index, m.base, byte_regs);
+        for (uint8_t val : opcode)
+            byte(val);
+
+        const bool sib = m.index >= 0 || (m.base & 7) == rsp;
+        const bool disp8 = m.disp >= -128 && m.disp < 128;
+        byte((disp8 ? 0x40 : 0x80) | (r & 7) << 3 | (sib ? rsp : (m.base & 7)));
+        if (sib)
+            byte(m.scale << 6 | ((m.index < 0 ? rsp : m.index) & 7) << 3 | (m.base & 7));
+        if (disp8)
+            byte(m.disp);
+        else
+            dword(m.disp);
+    }
+};
+
+// the operand of an instruction, once its address is computed
+struct operand
+{
+    bool     dynamic; // in edx, otherwise 'addr'
+    uint16_t addr;
+    int      page;    // its page when known at compile time, -1 otherwise
+
+    // the cycle added when the indexing crosses a page : when 'index' is at least 'index_limit', or as given in esi
+    int      index { -1 };
+    uint8_t  index_limit { 0 };
+    bool     crossing_in_esi { false };
+};
+
+// Compiles a block : the instructions from its first one on, up to the end of its page at most. Its branches and jumps
+// to the instructions of the block are jumps within the native code, the others leave it.
+class block_compiler
+{
+public:
+    block_compiler(const frame_t& frame, const uint8_t* code, uint16_t pc)
+        : m_frame(frame), m_code(code), m_page(pc >> 8), m_pc(pc)
+    {}
+
+    // false if not even the first instruction could be compiled
+    bool compile();
+
+    const std::vector<uint8_t>& code() const
+    { return m_out.code; }
+    unsigned max_cycles() const
+    { return m_max_cycles; }
+
+private:
+    static constexpr uint32_t one_instruction = 1 << 16; // in the counts
+
+    struct label
+    {
+        bool     compiled; // an instruction of the block starts there
+        size_t   pos;
+        uint32_t pending;
+    };
+
+    // a branch taken or a jump, to an instruction of the block or out of it, resolved once the whole block is compiled
+    struct branch
+    {
+        size_t   jump;
+        uint16_t next; // the pc after the instruction
+        uint16_t target;
+        uint32_t pending;
+    };
+
+    struct side_exit
+    {
+        uint16_t pc;
+        uint32_t pending;
+        std::vector<size_t> jumps;
+    };
+
+    bool compile_instruction();
+
+    // leaves the block before the current instruction if the condition is met, all of them are checked before the
+    // instruction has any effect
+    void leave_if(cond cc);
+    // leaves the block once the current instruction is done, to 'pc' or to the pc in edx
+    void leave_to(uint16_t pc, uint32_t result = 0)
+    { exit_to(pc, m_pending, result); m_done = true; }
+    void leave_to_edx();
+    void exit_to(uint16_t pc, uint32_t pending, uint32_t result);
+    void take(const branch& taken);
+
+    bool readable(unsigned page) const
+    { return m_frame.read_pages[page] != 0; }
+    bool writable(unsigned page) const
+    { return m_frame.write_pages[page] != 0; }
+
+    void check_page(int32_t table, unsigned page);
+    void map_page(reg dst, int32_t table, unsigned page);
+    void map_page_of_edx(reg dst, int32_t table);
+
+    operand address(mode addressing, bool read_only);
+    void map_operand(const operand& target, bool read, bool write);
+    void count_crossing(const operand& target);
+    static mem operand_mem(const operand& target, reg base)
+    { return target.dynamic ? at(base, rdx) : at(base, target.addr); }
+
+    void set_zn(reg r)
+    { m_out.mov8(Z, r); m_out.mov8(N, r); }
+    void latch(reg r)
+    { m_out.store8(at(frame_ptr, frame_latch), r); }
+    void latch(uint8_t val)
+    { m_out.store8(at(frame_ptr, frame_latch), val); }
+    // a write : the idle loop is no longer clean, see basic_cpu6502::loop_back()
+    void wrote()
+    { m_out.store8(at(frame_ptr, frame_loop_clean), 0); }
+    void flags_to(reg dst);
+
+    void read_op(op operation);
+    void rmw_op(op operation, reg r);
+
+    void prologue();
+    void epilogue();
+
+    const frame_t& m_frame;
+    const uint8_t* m_code;
+    unsigned m_page; // the one code is mapped at
+    emitter m_out;
+
+    uint16_t m_pc;               // of the instruction being compiled
+    uint32_t m_pending { 0 };    // the counts of the instructions before it since they were last added to the counts
+    unsigned m_max_cycles { 0 }; // of a run of the block which doesn't jump back
+    unsigned m_instructions { 0 };
+    bool     m_done { false };   // the block ended with the last instruction
+
+    std::array<label, 0x100> m_labels {};
+    std::vector<branch> m_branches;
+    std::vector<side_exit> m_side_exits;
+    int m_side_exit { -1 }; // the exit before the current instruction, once one of its checks needs it
+    std::vector<size_t> m_epilogue_jumps;
+};
+
+bool block_compiler::compile()
+{
+    prologue();
+    while (!m_done && compile_instruction())
+    {
+        m_side_exit = -1;
+    }
+    if (m_instructions == 0)
+        return false;
+    if (!m_done)
+        leave_to(m_pc);
+
+    for (auto& exit : m_side_exits)
+    {
+        for (size_t jump : exit.jumps)
+            m_out.patch(jump, m_out.pos());
+        exit_to(exit.pc, exit.pending, 0);
+    }
+    for (const auto& taken : m_branches)
+    {
+        m_out.patch(taken.jump, m_out.pos());
+        take(taken);
+    }
+
+    for (size_t jump : m_epilogue_jumps)
+        m_out.patch(jump, m_out.pos());
+    epilogue();
+    return true;
+}
+
+bool block_compiler::compile_instruction()
+{
+    // the next page isn't necessarily the next one in ROM
+    if (m_pc >> 8 != m_page)
+        return false;
+
+    const unsigned offset = m_pc & 0xFF;
+    const uint8_t opcode = m_code[offset];
+    const opcode_info info = opcodes[opcode];
+    const unsigned length = length_of(info.addressing);
+    if (info.operation == op::none || offset + length > 0x100)
+        return false;
+
+    const instruction_cycles cycles = cycles_of(info.operation, info.addressing);
+    if (m_instructions == max_block_instructions || m_max_cycles + cycles.base + cycles.extra > max_block_cycles)
+        return false;
+
+    const uint8_t lo = length > 1 ? m_code[offset + 1] : 0;
+    const uint8_t hi = length > 2 ? m_code[offset + 2] : 0;
+    const uint16_t word = lo | hi << 8;
+    const uint16_t next = m_pc + length;
+
+    // the pages accessed at fixed addresses must be plain memory now (otherwise it's likely I/O or a mapper register) ;
+    // they are checked again when the block runs, as are those only known then
+    const op operation = info.operation;
+    const bool reads  = is_read(operation) || is_rmw(operation);
+    const bool writes = is_write(operation) || is_rmw(operation);
+    switch (info.addressing)
+    {
+        case mode::zp: case mode::zpx: case mode::zpy:
+            if ((reads && !readable(0)) || (writes && !writable(0)) || (info.addressing != mode::zp && !readable(0)))
+                return false;
+            break;
+        case mode::izx: case mode::izy:
+            if (!readable(0))
+                return false;
+            break;
+        case mode::abs:
+            if (operation == op::jmp_ind && !readable(word >> 8))
+                return false;
+            if ((reads && !readable(word >> 8)) || (writes && !writable(word >> 8)))
+                return false;
+            break;
+        case mode::abx: case mode::aby:
+            if (!readable(word >> 8)) // the dummy read
+                return false;
+            break;
+        default:
+            break;
+    }
+    switch (operation)
+    {
+        case op::pha: case op::php: case op::jsr:
+            if (!writable(1))
+                return false;
+            break;
+        case op::pla: case op::rts:
+            if (!readable(1))
+                return false;
+            break;
+        default:
+            break;
+    }
+
+    // from here on, the instruction is compiled
+    m_labels[offset] = {true, m_out.pos(), m_pending};
+
+    bool latched = false;
+    if (is_read(operation))
+    {
+        if (info.addressing == mode::imm)
+        {
+            m_out.mov32(rcx, uint32_t(lo));
+            latch(lo);
+        }
+        else
+        {
+            const operand target = address(info.addressing, true);
+            map_operand(target, true, false);
+            count_crossing(target);
+            m_out.movzx8(rcx, operand_mem(target, rax));
+            latch(rcx);
+        }
+        read_op(operation);
+        latched = true;
+    }
+    else if (is_write(operation))
+    {
+        const operand target = address(info.addressing, false);
+        map_operand(target, false, true);
+        const reg src = operation == op::sta ? A : operation == op::stx ? X : Y;
+        m_out.store8(operand_mem(target, rsi), src);
+        latch(src);
+        wrote();
+        latched = true;
+    }
+    else if (is_rmw(operation))
+    {
+        if (info.addressing == mode::acc)
+        {
+            rmw_op(operation, A);
+        }
+        else
+        {
+            const operand target = address(info.addressing, false);
+            map_operand(target, true, true);
+            m_out.movzx8(rcx, operand_mem(target, rax));
+            rmw_op(operation, rcx);
+            m_out.store8(operand_mem(target, rsi), rcx);
+            latch(rcx);
+            wrote();
+            latched = true;
+        }
+    }
+
+    if (is_branch(operation))
+    {
+        static constexpr struct { reg flag; cond taken; } branches[] =
+        {
+            {N, ns}, {N, s}, {V, z}, {V, nz}, {C, z}, {C, nz}, {Z, nz}, {Z, z} // bpl to beq
+        };
+        const auto& branch = branches[unsigned(operation) - unsigned(op::bpl)];
+        const uint16_t target = next + int8_t(lo);
+        const bool crossing = (target & 0xFF00) != (next & 0xFF00);
+
+        latch(lo);
+        latched = true;
+        m_out.test8(branch.flag, branch.flag);
+        m_branches.push_back({m_out.jcc(branch.taken), next, target, m_pending + 3 + crossing + one_instruction});
+    }
+
+    switch (operation)
+    {
+        case op::inx: m_out.inc8(X); set_zn(X); break;
+        case op::iny: m_out.inc8(Y); set_zn(Y); break;
+        case op::dex: m_out.dec8(X); set_zn(X); break;
+        case op::dey: m_out.dec8(Y); set_zn(Y); break;
+        case op::tax: m_out.mov8(X, A); set_zn(X); break;
+        case op::tay: m_out.mov8(Y, A); set_zn(Y); break;
+        case op::txa: m_out.mov8(A, X); set_zn(A); break;
+        case op::tya: m_out.mov8(A, Y); set_zn(A); break;
+        case op::tsx: m_out.mov8(X, S); set_zn(X); break;
+        case op::txs: m_out.mov8(S, X); break;
+        case op::clc: m_out.alu32(xor_, C, C); break;
+        case op::sec: m_out.mov32(C, 1u); break;
+        case op::clv: m_out.alu32(xor_, V, V); break;
+        case op::cld: m_out.alu32(and_, P, ~cpu6502_base::Decim); break;
+        case op::sed: m_out.alu32(or_, P, cpu6502_base::Decim); break;
+        case op::pha: case op::php:
+        {
+            map_page(rsi, frame_write_pages, 1);
+            reg src = A;
+            if (operation == op::php)
+            {
+                flags_to(rax);
+                m_out.alu32(or_, rax, cpu6502_base::Break);
+                src = rax;
+            }
+            m_out.movzx8(rdx, S);
+            m_out.store8(at(rsi, rdx, 0x100), src);
+            m_out.dec8(S);
+            latch(src);
+            wrote();
+            latched = true;
+            break;
+        }
+        case op::pla:
+            map_page(rax, frame_read_pages, 1);
+            m_out.inc8(S);
+            m_out.movzx8(rdx, S);
+            m_out.movzx8(rcx, at(rax, rdx, 0x100));
+            m_out.mov8(A, rcx);
+            set_zn(A);
+            latch(rcx);
+            latched = true;
+            break;
+        default:
+            break;
+    }
+
+    // the control flow instructions end the block
+    switch (operation)
+    {
+        case op::jmp:
+            latch(hi);
+            m_branches.push_back({m_out.jmp(), next, word, m_pending + cycles.base + one_instruction});
+            m_max_cycles += cycles.base; ++m_instructions;
+            m_done = true;
+            return true;
+        case op::jsr:
+        {
+            map_page(rsi, frame_write_pages, 1);
+            const uint16_t ret = next - 1;
+            m_out.movzx8(rdx, S);
+            m_out.store8(at(rsi, rdx, 0x100), uint8_t(ret >> 8));
+            m_out.dec8(S);
+            m_out.movzx8(rdx, S);
+            m_out.store8(at(rsi, rdx, 0x100), uint8_t(ret & 0xFF));
+            m_out.dec8(S);
+            latch(uint8_t(ret & 0xFF));
+            wrote();
+            m_pending += cycles.base + one_instruction; m_max_cycles += cycles.base; ++m_instructions;
+            leave_to(word);
+            return true;
+        }
+        case op::rts:
+            map_page(rax, frame_read_pages, 1);
+            m_out.inc8(S);
+            m_out.movzx8(rdx, S);
+            m_out.movzx8(rcx, at(rax, rdx, 0x100));
+            m_out.inc8(S);
+            m_out.movzx8(rdx, S);
+            m_out.movzx8(rdx, at(rax, rdx, 0x100));
+            latch(rdx);
+            m_out.shift32(shl, rdx, 8);
+            m_out.alu32(or_, rdx, rcx);
+            m_out.alu32(add, rdx, 1);
+            m_out.alu32(and_, rdx, 0xFFFF);
+            m_pending += cycles.base + one_instruction; m_max_cycles += cycles.base; ++m_instructions;
+            leave_to_edx();
+            return true;
+        case op::jmp_ind:
+        {
+            // the pointer doesn't cross pages : its high byte is read from the start of its page
+            map_page(rax, frame_read_pages, word >> 8);
+            m_out.movzx8(rdx, at(rax, word));
+            m_out.movzx8(rcx, at(rax, (word & 0xFF00) | uint8_t(lo + 1)));
+            latch(rcx);
+            m_out.shift32(shl, rcx, 8);
+            m_out.alu32(or_, rdx, rcx);
+            m_pending += cycles.base + one_instruction; m_max_cycles += cycles.base; ++m_instructions;
+            leave_to_edx();
+            return true;
+        }
+        default:
+            break;
+    }
+
+    if (!latched) // nothing but the opcode was read
+        latch(opcode);
+
+    m_pending += (is_branch(operation) ? 2 : cycles.base) + one_instruction;
+    m_max_cycles += cycles.base + cycles.extra;
+    ++m_instructions;
+    m_pc = next;
+    return true;
+}
+
+void block_compiler::read_op(op operation)
+{
+    switch (operation)
+    {
+        case op::lda: m_out.mov8(A, rcx); set_zn(A); break;
+        case op::ldx: m_out.mov8(X, rcx); set_zn(X); break;
+        case op::ldy: m_out.mov8(Y, rcx); set_zn(Y); break;
+        case op::adc:
+            m_out.bt32(C, 0);
+            m_out.alu8(adc, A, rcx);
+            m_out.setcc(c, C);
+            m_out.setcc(o, V);
+            set_zn(A);
+            break;
+        case op::sbc:
+            m_out.alu8(cmp, C, uint8_t(1)); // the borrow is the carry's complement
+            m_out.alu8(sbb, A, rcx);
+            m_out.setcc(nc, C);
+            m_out.setcc(o, V);
+            set_zn(A);
+            break;
+        case op::and_: m_out.alu8(and_, A, rcx); set_zn(A); break;
+        case op::ora:  m_out.alu8(or_,  A, rcx); set_zn(A); break;
+        case op::eor:  m_out.alu8(xor_, A, rcx); set_zn(A); break;
+        case op::cmp: case op::cpx: case op::cpy:
+        {
+            const reg r = operation == op::cmp ? A : operation == op::cpx ? X : Y;
+            m_out.alu8(cmp, r, rcx);
+            m_out.setcc(nc, C);
+            m_out.mov8(Z, r);
+            m_out.alu8(sub, Z, rcx);
+            m_out.mov8(N, Z);
+            break;
+        }
+        case op::bit:
+            m_out.mov8(Z, A);
+            m_out.alu8(and_, Z, rcx);
+            m_out.mov8(N, rcx);
+            m_out.mov32(V, rcx);
+            m_out.shift32(shr, V, 6);
+            m_out.alu32(and_, V, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void block_compiler::rmw_op(op operation, reg r)
+{
+    switch (operation)
+    {
+        case op::asl: m_out.shift8(shl, r); m_out.setcc(c, C); break;
+        case op::lsr: m_out.shift8(shr, r); m_out.setcc(c, C); break;
+        case op::rol: m_out.bt32(C, 0); m_out.shift8(rcl, r); m_out.setcc(c, C); break;
+        case op::ror: m_out.bt32(C, 0); m_out.shift8(rcr, r); m_out.setcc(c, C); break;
+        case op::inc: m_out.inc8(r); break;
+        case op::dec: m_out.dec8(r); break;
+        default: break;
+    }
+    set_zn(r);
+}
+
+void block_compiler::leave_if(cond cc)
+{
+    if (m_side_exit < 0)
+    {
+        m_side_exit = int(m_side_exits.size());
+        m_side_exits.push_back({m_pc, m_pending, {}});
+    }
+    m_side_exits[m_side_exit].jumps.push_back(m_out.jcc(cc));
+}
+
+void block_compiler::leave_to_edx()
+{
+    if (m_pending)
+        m_out.alu32(add, counts, int32_t(m_pending));
+    m_out.mov32(rax, 0u);
+    m_epilogue_jumps.push_back(m_out.jmp());
+    m_done = true;
+}
+
+void block_compiler::exit_to(uint16_t pc, uint32_t pending, uint32_t result)
+{
+    if (pending)
+        m_out.alu32(add, counts, int32_t(pending));
+    m_out.mov32(rdx, uint32_t(pc));
+    m_out.mov32(rax, result);
+    m_epilogue_jumps.push_back(m_out.jmp());
+}
+
+// the branch or the jump was taken
+void block_compiler::take(const branch& taken)
+{
+    // a jump back may close an idle loop, see basic_cpu6502::loop_back()
+    const bool loop = taken.target <= taken.next && unsigned(taken.next - taken.target) <= cpu6502_base::max_idle_loop_size;
+    const label& target = m_labels[taken.target & 0xFF];
+    if ((taken.target >> 8) != m_page || !target.compiled)
+    {
+        if (loop)
+            exit_to(taken.next, taken.pending, jit6502::loop_exit | taken.target);
+        else
+            exit_to(taken.target, taken.pending, 0);
+        return;
+    }
+
+    if (loop)
+    {
+        // the same iteration again without writes : the cpu skips the idle loop
+        std::vector<size_t> other;
+        m_out.cmp8(at(frame_ptr, frame_loop_clean), 0);
+        other.push_back(m_out.jcc(z));
+        m_out.cmp32(at(frame_ptr, frame_loop_head), uint32_t(taken.target | taken.next << 16));
+        other.push_back(m_out.jcc(nz));
+        for (auto field : {std::make_pair(offsetof(registers, a), A), std::make_pair(offsetof(registers, x), X),
+                           std::make_pair(offsetof(registers, y), Y), std::make_pair(offsetof(registers, sp), S)})
+        {
+            m_out.cmp8(at(frame_ptr, int32_t(frame_loop_regs + field.first)), field.second);
+            other.push_back(m_out.jcc(nz));
+        }
+        flags_to(rax);
+        m_out.cmp8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, flags))), rax);
+        other.push_back(m_out.jcc(nz));
+        exit_to(taken.next, taken.pending, jit6502::loop_exit | taken.target);
+        for (size_t jump : other)
+            m_out.patch(jump, m_out.pos());
+
+        // otherwise another iteration starts, see basic_cpu6502::loop_back()
+        m_out.store16(at(frame_ptr, frame_loop_head), taken.target);
+        m_out.store16(at(frame_ptr, frame_loop_tail), taken.next);
+        m_out.mov32(rax, counts);
+        m_out.alu32(add, rax, int32_t(taken.pending));
+        m_out.alu32(and_, rax, 0xFFFF);
+        m_out.alu32(add, rax, at(frame_ptr, frame_cycles));
+        m_out.store32(at(frame_ptr, frame_loop_start), rax);
+        m_out.store8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, a))), A);
+        m_out.store8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, x))), X);
+        m_out.store8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, y))), Y);
+        m_out.store8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, sp))), S);
+        flags_to(rax);
+        m_out.store8(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, flags))), rax);
+        m_out.store16(at(frame_ptr, frame_loop_regs + int32_t(offsetof(registers, pc))), taken.next);
+        m_out.store8(at(frame_ptr, frame_loop_clean), 1);
+    }
+
+    if (taken.target < taken.next)
+    {
+        // going through the block again may spend up to m_max_cycles : that many must be left
+        m_out.mov32(rax, counts);
+        m_out.alu32(add, rax, int32_t(taken.pending));
+        m_out.alu32(and_, rax, 0xFFFF);
+        m_out.alu32(cmp, rax, at(frame_ptr, frame_budget));
+        const size_t within = m_out.jcc(be);
+        exit_to(taken.target, taken.pending, 0);
+        m_out.patch(within, m_out.pos());
+    }
+
+    if (taken.pending != target.pending)
+        m_out.alu32(add, counts, int32_t(taken.pending - target.pending));
+    m_out.jmp(target.pos);
+}
+
+void block_compiler::check_page(int32_t table, unsigned page)
+{
+    m_out.cmp64(at(frame_ptr, table + int32_t(page) * 8), 0);
+    leave_if(z);
+}
+
+void block_compiler::map_page(reg dst, int32_t table, unsigned page)
+{
+    m_out.load64(dst, at(frame_ptr, table + int32_t(page) * 8));
+    m_out.test64(dst, dst);
+    leave_if(z);
+}
+
+void block_compiler::map_page_of_edx(reg dst, int32_t table)
+{
+    m_out.mov32(dst, rdx);
+    m_out.shift32(shr, dst, 8);
+    m_out.load64(dst, at(frame_ptr, dst, table, 3));
+    m_out.test64(dst, dst);
+    leave_if(z);
+}
+
+// computes the address of the operand, checking the pages of the dummy reads done along the way ; 'read_only' : the
+// indexed modes only do the dummy read of the crossing of a page when it happens, and then spend a cycle more
+operand block_compiler::address(mode addressing, bool read_only)
+{
+    const unsigned offset = m_pc & 0xFF;
+    const uint8_t lo = m_code[offset + 1];
+    const uint16_t word = lo | (addressing == mode::abs || addressing == mode::abx || addressing == mode::aby
+                                ? m_code[offset + 2] << 8 : 0);
+    switch (addressing)
+    {
+        case mode::zp:
+            return {false, lo, 0};
+        case mode::zpx: case mode::zpy:
+            check_page(frame_read_pages, 0); // the operand is read from the zero page before the index is added
+            m_out.movzx8(rdx, addressing == mode::zpx ? X : Y);
+            m_out.alu8(add, rdx, lo);
+            return {true, 0, 0};
+        case mode::abs:
+            return {false, word, word >> 8};
+        case mode::abx: case mode::aby:
+        {
+            const reg index = addressing == mode::abx ? X : Y;
+            operand target {true, 0, -1};
+            if (!read_only || lo != 0)
+                check_page(frame_read_pages, word >> 8);
+            if (read_only && lo != 0)
+            {
+                target.index = index;
+                target.index_limit = uint8_t(0x100 - lo);
+            }
+            m_out.movzx8(rdx, index);
+            m_out.alu32(add, rdx, int32_t(word));
+            if (word + 0xFF > 0xFFFF)
+                m_out.alu32(and_, rdx, 0xFFFF);
+            return target;
+        }
+        case mode::izx:
+            map_page(rax, frame_read_pages, 0);
+            m_out.movzx8(rcx, X);
+            m_out.alu8(add, rcx, lo);
+            m_out.movzx8(rdx, at(rax, rcx));
+            m_out.inc8(rcx);
+            m_out.movzx8(rcx, at(rax, rcx));
+            m_out.shift32(shl, rcx, 8);
+            m_out.alu32(or_, rdx, rcx);
+            return {true, 0, -1};
+        case mode::izy:
+        {
+            map_page(rax, frame_read_pages, 0);
+            m_out.movzx8(rdx, at(rax, lo));
+            m_out.movzx8(rcx, at(rax, uint8_t(lo + 1)));
+            m_out.shift32(shl, rcx, 8);
+            m_out.alu32(or_, rdx, rcx);
+            // the page of the pointer is read from when the index crosses a page, otherwise it is the operand's
+            m_out.mov32(rcx, rdx);
+            m_out.shift32(shr, rcx, 8);
+            m_out.cmp64(at(frame_ptr, rcx, frame_read_pages, 3), 0);
+            leave_if(z);
+
+            operand target {true, 0, -1};
+            if (read_only)
+            {
+                m_out.mov32(rsi, rdx);
+                target.crossing_in_esi = true;
+            }
+            m_out.movzx8(rcx, Y);
+            m_out.alu32(add, rdx, rcx);
+            if (read_only)
+            {
+                // the high byte changes when crossing
+                m_out.alu32(xor_, rsi, rdx);
+                m_out.shift32(shr, rsi, 8);
+                m_out.alu32(and_, rsi, 1);
+            }
+            m_out.alu32(and_, rdx, 0xFFFF);
+            return target;
+        }
+        default:
+            return {false, 0, -1};
+    }
+}
+
+// rax : the host address the operand is read from, rsi : the one it is written to, both minus the operand's page
+void block_compiler::map_operand(const operand& target, bool read, bool write)
+{
+    if (target.page >= 0)
+    {
+        if (read)
+            map_page(rax, frame_read_pages, target.page);
+        if (write)
+            map_page(rsi, frame_write_pages, target.page);
+    }
+    else
+    {
+        if (read)
+            map_page_of_edx(rax, frame_read_pages);
+        if (write)
+            map_page_of_edx(rsi, frame_write_pages);
+    }
+}
+
+// after all the checks : the cycle is only spent once the instruction is run
+void block_compiler::count_crossing(const operand& target)
+{
+    if (target.index >= 0)
+    {
+        // counts + 1 - borrow, the index being below the limit when it doesn't cross
+        m_out.alu8(cmp, reg(target.index), target.index_limit);
+        m_out.alu32(sbb, counts, -1);
+    }
+    else if (target.crossing_in_esi)
+    {
+        m_out.alu32(add, counts, rsi);
+    }
+}
+
+void block_compiler::flags_to(reg dst)
+{
+    m_out.mov32(dst, P);
+    m_out.alu32(or_, dst, C);
+    m_out.mov32(rcx, V);
+    m_out.shift32(shl, rcx, 6);
+    m_out.alu32(or_, dst, rcx);
+    m_out.movzx8(rcx, N);
+    m_out.alu32(and_, rcx, cpu6502_base::Neg);
+    m_out.alu32(or_, dst, rcx);
+    m_out.alu32(xor_, rcx, rcx);
+    m_out.test8(Z, Z);
+    m_out.setcc(z, rcx);
+    m_out.alu32(add, rcx, rcx);
+    m_out.alu32(or_, dst, rcx);
+}
+
+// uint32_t block(frame_t* frame), the frame in rdi
+void block_compiler::prologue()
+{
+    for (reg r : {rbx, rbp, r12, r13, r14, r15})
+        m_out.push(r);
+
+    m_out.movzx8(A, at(frame_ptr, frame_a));
+    m_out.movzx8(X, at(frame_ptr, frame_x));
+    m_out.movzx8(Y, at(frame_ptr, frame_y));
+    m_out.movzx8(S, at(frame_ptr, frame_sp));
+
+    m_out.movzx8(rax, at(frame_ptr, frame_flags));
+    m_out.mov32(C, rax);
+    m_out.alu32(and_, C, cpu6502_base::Carry);
+    m_out.mov32(V, rax);
+    m_out.shift32(shr, V, 6);
+    m_out.alu32(and_, V, 1);
+    m_out.mov32(Z, rax);
+    m_out.alu32(and_, Z, cpu6502_base::Zero);
+    m_out.alu32(xor_, Z, cpu6502_base::Zero);
+    m_out.mov32(N, rax);
+    m_out.mov32(P, rax);
+    m_out.alu32(and_, P, cpu6502_base::IntD | cpu6502_base::Decim | cpu6502_base::Break | 0x20);
+    m_out.alu32(xor_, counts, counts);
+}
+
+// edx : pc, eax : the result, the counts all added
+void block_compiler::epilogue()
+{
+    m_out.store8(at(frame_ptr, frame_a), A);
+    m_out.store8(at(frame_ptr, frame_x), X);
+    m_out.store8(at(frame_ptr, frame_y), Y);
+    m_out.store8(at(frame_ptr, frame_sp), S);
+    m_out.store16(at(frame_ptr, frame_pc), rdx);
+    m_out.mov32(rcx, counts);
+    m_out.alu32(and_, rcx, 0xFFFF);
+    m_out.alu32(add, rcx, at(frame_ptr, frame_cycles));
+    m_out.store32(at(frame_ptr, frame_cycles), rcx);
+    m_out.shift32(shr, counts, 16);
+    m_out.store16(at(frame_ptr, frame_instructions), counts);
+    flags_to(rdx);
+    m_out.store8(at(frame_ptr, frame_flags), rdx);
+
+    for (reg r : {r15, r14, r13, r12, rbp, rbx})
+        m_out.pop(r);
+    m_out.ret();
+}
+
+}
+
+jit6502::jit6502()
+{
+#ifdef CPU6502_JIT
+    void* code = mmap(nullptr, code_capacity, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code != MAP_FAILED)
+        m_code = static_cast<uint8_t*>(code);
+#endif
+}
+
+jit6502::~jit6502()
+{
+#ifdef CPU6502_JIT
+    if (m_code)
+        munmap(m_code, code_capacity);
+#endif
+}
+
+void jit6502_deleter::operator()(jit6502* jit) const
+{
+    delete jit;
+}
+
+void jit6502::map_page(unsigned page, const uint8_t* read, uint8_t* write)
+{
+    // the native code adds the whole address ; a page whose memory would then be at 0 is simply left to the bus
+    frame.read_pages [page] = read  ? reinterpret_cast<uintptr_t>(read)  - (page << 8) : 0;
+    frame.write_pages[page] = write ? reinterpret_cast<uintptr_t>(write) - (page << 8) : 0;
+}
+
+void jit6502::unmap_pages()
+{
+    frame.read_pages.fill(0);
+    frame.write_pages.fill(0);
+}
+
+const jit_block* jit6502::compile(const uint8_t* code, uint16_t pc)
+{
+#ifdef CPU6502_JIT
+    block_compiler compiler(frame, code, pc);
+    if (!m_code || full() || !compiler.compile())
+        return &no_block;
+
+    // W^X : the pages the block is copied to are only writable for that time
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t* entry = m_code + m_code_used;
+    uint8_t* first_page = m_code + m_code_used / page_size * page_size;
+    const size_t length = entry + compiler.code().size() - first_page;
+    if (mprotect(first_page, length, PROT_READ | PROT_WRITE) != 0)
+        return &no_block;
+    std::memcpy(entry, compiler.code().data(), compiler.code().size());
+    if (mprotect(first_page, length, PROT_READ | PROT_EXEC) != 0)
+        return &no_block;
+
+    m_code_used += (compiler.code().size() + 15) & ~size_t(15);
+    m_blocks.push_back({reinterpret_cast<uint32_t(*)(void*)>(entry), pc, uint16_t(compiler.max_cycles())});
+    return &m_blocks.back();
+#else
+    (void)code; (void)pc;
+    return &no_block;
+#endif
+}
+
+bool jit6502::full() const
+{
+    return m_code_used + max_block_code > code_capacity;
+}
+
+void jit6502::clear()
+{
+    m_blocks.clear();
+    m_code_used = 0;
+}
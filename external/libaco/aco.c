@@ -166,13 +166,13 @@ static void aco_default_protector_last_word(void){
 }
 
 // aco's Global Thread Local Storage variable `co`
-aco_t* aco_gtls_co;
-static aco_cofuncp_t aco_gtls_last_word_fp = aco_default_protector_last_word;
+__thread aco_t* aco_gtls_co;
+static __thread aco_cofuncp_t aco_gtls_last_word_fp = aco_default_protector_last_word;
 
 #ifdef __i386__
-    static void* aco_gtls_fpucw_mxcsr[2];
+    static __thread void* aco_gtls_fpucw_mxcsr[2];
 #elif  __x86_64__
-    static void* aco_gtls_fpucw_mxcsr[1];
+    static __thread void* aco_gtls_fpucw_mxcsr[1];
 #else
     #error "platform no support yet"
 #endif
@@ -480,3 +480,23 @@ void aco_destroy(aco_t* co){
         free(co);
     }
 }
+
+// Nematod : starts a suspended non-main co over from its function, as aco_create() had left it, without freeing or
+// allocating anything. What it had on its stack is dropped, not unwound.
+void aco_reset(aco_t* co){
+    assertptr(co);
+    assert(!aco_is_main_co(co));
+    if(co->share_stack->owner == co){
+        co->share_stack->owner = NULL;
+        co->share_stack->align_validsz = 0;
+    }
+#if defined(__i386__) || defined(__x86_64__)
+    co->reg[ACO_REG_IDX_RETADDR] = (void*)co->fp;
+    co->reg[ACO_REG_IDX_SP] = co->share_stack->align_retptr;
+    co->save_stack.valid_sz = 0;
+#else
+    #error "platform no support yet"
+#endif
+    co->is_end = 0;
+    co->skip_count = 0;
+}
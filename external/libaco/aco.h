@@ -185,7 +185,7 @@ extern aco_t* aco_create(
     );
 
 // aco's Global Thread Local Storage variable `co`
-extern aco_t* aco_gtls_co;
+extern __thread aco_t* aco_gtls_co;
 
 aco_attr_no_asan
 extern void aco_resume(aco_t* resume_co);
@@ -209,6 +209,9 @@ extern void aco_resume(aco_t* resume_co);
 
 extern void aco_destroy(aco_t* co);
 
+// Nematod : restarts a suspended co from its function, see aco.c
+extern void aco_reset(aco_t* co);
+
 #define aco_is_main_co(co) ({((co)->main_co) == NULL;})
 
 #define aco_exit1(co) do {     \
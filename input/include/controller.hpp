@@ -27,11 +27,16 @@ SOFTWARE.
 
 #include <cstdint>
 
+#include "common/state_stream.hpp"
+
 class Controller
 {
 public:
     virtual void     set_output(uint8_t byte) = 0;
     virtual uint8_t  read_data()              = 0;
+
+    // the buttons and the shift register, for save states
+    virtual void     serialize(StateStream&)  {}
 };
 
 #endif // CONTROLLER_HPP
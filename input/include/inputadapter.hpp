@@ -39,6 +39,11 @@ public:
     void    input_write(uint8_t val);
     uint8_t output1_read();
     uint8_t output2_read();
+
+    // which controllers are connected : bit 0 for controller_1, bit 1 for controller_2
+    unsigned connected() const;
+    // the state of the connected controllers
+    void    serialize(StateStream& stream);
 };
 
 #endif // INPUTADAPTER_HPP
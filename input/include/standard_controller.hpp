@@ -32,6 +32,7 @@ class StandardController : public Controller
 public:
     virtual void     set_output(uint8_t byte);
     virtual uint8_t  read_data()             ;
+    virtual void     serialize(StateStream& stream);
 
 public:
     struct State
@@ -25,6 +25,8 @@ SOFTWARE.
 
 #include "inputadapter.hpp"
 
+#include <initializer_list>
+
 
 void InputAdapter::input_write(uint8_t val)
 {
@@ -49,3 +51,18 @@ uint8_t InputAdapter::output2_read()
     else
         return 0x40; // open bus
 }
+
+unsigned InputAdapter::connected() const
+{
+    return (controller_1 != nullptr) | (controller_2 != nullptr) << 1;
+}
+
+void InputAdapter::serialize(StateStream& stream)
+{
+    // the console checks that the same controllers are connected before loading anything, see connected()
+    for (Controller* controller : {controller_1, controller_2})
+    {
+        if (controller)
+            controller->serialize(stream);
+    }
+}
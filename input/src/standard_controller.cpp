@@ -50,3 +50,10 @@ uint8_t StandardController::read_data()
         return ret&1;
     }
 }
+
+void StandardController::serialize(StateStream& stream)
+{
+    stream.io(state);
+    stream.io(m_strobe_on);
+    stream.io(m_button_to_output);
+}
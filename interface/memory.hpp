@@ -28,14 +28,33 @@ public:
     void        set_valid(bool valid)
     { m_valid = valid; }
 
+    // Modules that are plain byte arrays publish their backing storage so buses can access it
+    // directly instead of going through read()/write(). A null write pointer means writes must
+    // still go through write() (e.g. ROMs, which ignore them).
+    data* direct_read_ptr () const { return m_direct_read; }
+    data* direct_write_ptr() const { return m_direct_write; }
+    // true if reading from this module has no side-effects
+    bool  side_effect_free() const { return m_side_effect_free; }
+
     virtual data  read(address offset)             = 0;
     // used to read data without side-effects
     virtual data  poke(address offset) { return read(offset); }
     virtual void write(address offset, data value) = 0;
 
+protected:
+    void set_direct_ptr(data* read_ptr, data* write_ptr)
+    {
+        m_direct_read  = read_ptr;
+        m_direct_write = write_ptr;
+        m_side_effect_free = true;
+    }
+
 protected:
     std::size_t m_size;
     bool        m_valid;
+    data*       m_direct_read  { nullptr };
+    data*       m_direct_write { nullptr };
+    bool        m_side_effect_free { false };
 };
 
 struct memory_port {
@@ -48,11 +67,17 @@ struct memory_port {
 template<std::size_t t_size>
 class RAM : public MemoryInterfaceable {
 public:
-    RAM() : MemoryInterfaceable(t_size) {};
+    RAM() : MemoryInterfaceable(t_size)
+    { set_direct_ptr(m_data.data(), m_data.data()); };
+    RAM(const RAM& other) : RAM()
+    { m_data = other.m_data; }
+    RAM& operator=(const RAM& other)
+    { m_data = other.m_data; return *this; }
+
     virtual data  read(address offset) override {return m_data[offset];};
     virtual void write(address offset, data value) override {m_data[offset] = value;};
 public:
-    std::array<data, t_size> m_data;
+    std::array<data, t_size> m_data {};
 };
 
 template<std::size_t t_size, typename lambda> // Battery-backed RAM
@@ -67,7 +92,12 @@ protected:
 template<std::size_t t_size>
 class ROM : public MemoryInterfaceable {
 public:
-    ROM() : MemoryInterfaceable(t_size) {}
+    ROM() : MemoryInterfaceable(t_size)
+    { set_direct_ptr(m_data.data(), nullptr); }
+    ROM(const ROM& other) : ROM()
+    { m_data = other.m_data; }
+    ROM& operator=(const ROM& other)
+    { m_data = other.m_data; return *this; }
 
     virtual data  read(address offset) {return m_data[offset];};
     void write(address, data)
@@ -75,14 +105,15 @@ public:
         //throw std::logic_error("Cannot write to ROM");
     };
 public:
-    std::array<data, t_size> m_data;
+    std::array<data, t_size> m_data {};
 };
 
 template <size_t t_size, bool writeable>
 struct BankWindow : public MemoryInterfaceable
 {
 public:
-    BankWindow() : MemoryInterfaceable(t_size) {}
+    BankWindow() : MemoryInterfaceable(t_size)
+    { m_side_effect_free = true; }
 
     void set_rom_base(data* in_rom_base, size_t in_rom_size)
     {
@@ -90,6 +121,8 @@ public:
 
         rom_base = rom_ptr = in_rom_base;
         rom_bank_count = in_rom_size / t_size;
+
+        publish_ptr();
     }
 
     void set_bank(size_t bank_number)
@@ -99,6 +132,8 @@ public:
         cur_bank = bank_number;
 
         rom_ptr = rom_base + cur_bank*t_size;
+
+        publish_ptr();
     }
 
     unsigned bank() const
@@ -115,6 +150,12 @@ public:
             rom_ptr[addr] = val;
         }
     };
+private:
+    void publish_ptr()
+    {
+        set_direct_ptr(rom_ptr, writeable ? rom_ptr : nullptr);
+    }
+
 private:
     data* rom_base { nullptr };
     size_t cur_bank { 0 };
@@ -30,13 +30,22 @@ SOFTWARE.
 class CNROM : public Mapper
 {
 public:
+    using Mapper::Mapper;
+
     virtual void init(const cartridge_data& cart) override;
 
     void register_write(uint16_t addr, uint8_t val);
 
+    virtual void serialize(StateStream& stream) override;
+
 private:
     bool    handle_bus_conflicts { true };
+    bool    has_crt_ram { false };
 
     std::vector<uint8_t> chr_rom;
+
+    ROM<0x8000> prg_rom;
+    RAM<0x2000> crt_ram;
+    ROMBankWindow<0x2000> chr_bank;
+    MapperRegister<CNROM> register_memory { *this };
 };
-extern CNROM cnrom;
@@ -26,10 +26,21 @@ SOFTWARE.
 #define MAPPER_BASE_HPP
 
 #include "nesloader/include/nesloader.hpp"
+#include "memory/include/memory.hpp"
+#include "common/state_stream.hpp"
+
+namespace NES
+{
+class Console;
+}
 
 class Mapper
 {
 public:
+    Mapper(NES::Console& console) : m_console(console)
+    {}
+    virtual ~Mapper() = default;
+
     virtual void init(const cartridge_data& cart) = 0;
 
     virtual void load_battery_ram(const std::vector<uint8_t>& data)
@@ -39,6 +50,31 @@ public:
     {
         return {};
     }
+
+    // registers and RAMs, for save states : the banks and the mirroring are restored from them on load
+    virtual void serialize(StateStream&)
+    {}
+
+protected:
+    NES::Console& m_console;
+};
+
+// forwards writes to $8000-$FFFF to the mapper's register_write()
+template <typename MapperType>
+class MapperRegister : public MemoryInterfaceable
+{
+public:
+    MapperRegister(MapperType& mapper) : MemoryInterfaceable(0x8000), m_mapper(mapper)
+    {}
+
+    virtual data  read(address) override { return 0; }
+    virtual void write(address addr, data value) override
+    {
+        m_mapper.register_write(0x8000 | addr, value);
+    }
+
+private:
+    MapperType& m_mapper;
 };
 
 #endif // MAPPER_BASE_HPP
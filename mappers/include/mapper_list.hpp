@@ -26,9 +26,18 @@ SOFTWARE.
 #define MAPPER_LIST_HPP
 
 #include <array>
+#include <memory>
 
 class Mapper;
 
-extern std::array<Mapper*, 256> mapper_list;
+namespace NES
+{
+class Console;
+}
+
+// each console gets its own mapper instance
+using mapper_factory = std::unique_ptr<Mapper>(*)(NES::Console& console);
+
+extern std::array<mapper_factory, 256> mapper_list;
 
 #endif // MAPPER_LIST_HPP
@@ -32,12 +32,15 @@ SOFTWARE.
 class MMC1 : public Mapper
 {
 public:
+    using Mapper::Mapper;
+
     virtual void init(const cartridge_data& cart) override;
 
     void register_write(uint16_t addr, uint8_t val);
 
     virtual void load_battery_ram(const std::vector<uint8_t>& data) override;
     virtual std::vector<uint8_t> save_battery_ram() override;
+    virtual void serialize(StateStream& stream) override;
 
 private:
     void apply_banking();
@@ -58,7 +61,13 @@ private:
     uint8_t chr1_reg { 0 };
     uint8_t prg_reg  { 0 };
     uint8_t last_write_cycle { 0xFF };
+
+    RAMBankWindow<0x2000> crt_ram_bank;
+    ROMBankWindow<0x4000> prg_bank_low;
+    ROMBankWindow<0x4000> prg_bank_hi;
+    RAMBankWindow<0x1000> chr_bank_low;
+    RAMBankWindow<0x1000> chr_bank_hi;
+    MapperRegister<MMC1> register_memory { *this };
 };
-extern MMC1 mmc1;
 
 #endif // MMC1_HPP
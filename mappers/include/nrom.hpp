@@ -30,9 +30,18 @@ SOFTWARE.
 class NROM : public Mapper
 {
 public:
+    using Mapper::Mapper;
+
     virtual void init(const cartridge_data& cart) override;
+    virtual void serialize(StateStream& stream) override;
+
+private:
+    ROM<0x8000> prg_rom;
+    ROM<0x2000> chr_rom;
+    RAM<0x2000> chr_ram;
+    RAM<0x2000> crt_ram;
+    bool uses_chr_ram { false };
+    bool has_crt_ram { false };
 };
 
-extern NROM nrom;
-
 #endif // NROM_HPP
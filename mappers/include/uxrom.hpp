@@ -30,13 +30,21 @@ SOFTWARE.
 class UxROM : public Mapper
 {
 public:
+    using Mapper::Mapper;
+
     virtual void init(const cartridge_data& cart) override;
 
     void register_write(uint16_t addr, uint8_t val);
 
+    virtual void serialize(StateStream& stream) override;
+
 private:
     bool    handle_bus_conflicts { true };
 
     std::vector<uint8_t> prg_rom;
+
+    ROMBankWindow<0x4000> prg_rom_bank_lo;
+    ROMBankWindow<0x4000> prg_rom_bank_hi;
+    RAM<0x2000> chr_ram;
+    MapperRegister<UxROM> register_memory { *this };
 };
-extern UxROM uxrom;
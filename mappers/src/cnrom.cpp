@@ -33,28 +33,6 @@ SOFTWARE.
 #include "nes.hpp"
 #include "ppu/include/ppu.hpp"
 
-namespace
-{
-
-class Register : public MemoryInterfaceable {
-public:
-    Register() : MemoryInterfaceable(0x8000) {};
-    virtual data  read(address) override { return 0; };
-    virtual void write(address addr, data value) override
-    {
-        cnrom.register_write(0x8000 | addr, value);
-    };
-public:
-};
-
-}
-
-CNROM cnrom;
-
-static ROM<0x8000> prg_rom;
-static ROMBankWindow<0x2000> chr_bank;
-static Register register_memory;
-
 void CNROM::init(const cartridge_data& cart)
 {
     memcpy(prg_rom.m_data.data(), cart.prg_rom.data(), cart.prg_rom.size());
@@ -68,19 +46,23 @@ void CNROM::init(const cartridge_data& cart)
     chr_bank.set_rom_base(chr_rom.data(), chr_rom.size());
     chr_bank.set_bank(0);
 
-    NES::cpu_space.add_read_port(memory_port{&prg_rom, 0x8000});
-    NES::cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
+    // PRG-RAM, as the blargg tests expect from the iNES files that don't tell its size
+    has_crt_ram = cart.prg_ram_size || cart.nvram_size;
+    if (has_crt_ram)
+        m_console.cpu_space.add_port(memory_port{&crt_ram, 0x6000});
+    m_console.cpu_space.add_read_port(memory_port{&prg_rom, 0x8000});
+    m_console.cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
 
-    NES::ppu.addr_space.add_read_port(memory_port{&chr_bank, 0x0000});
+    m_console.ppu.addr_space.add_read_port(memory_port{&chr_bank, 0x0000});
 
     if (cart.mirroring == cartridge_data::Horizontal)
     {
-        NES::set_mirroring(NES::horizontal);
+        m_console.set_mirroring(NES::horizontal);
     }
     else if (cart.mirroring == cartridge_data::Vertical)
     {
         // V-mirroring
-        NES::set_mirroring(NES::vertical);
+        m_console.set_mirroring(NES::vertical);
     }
 
     if (cart.submapper != 1)
@@ -92,7 +74,18 @@ void CNROM::init(const cartridge_data& cart)
 void CNROM::register_write(uint16_t addr, uint8_t val)
 {
     if (handle_bus_conflicts)
-        val &= NES::cpu_space.read(addr);
+        val &= m_console.cpu_space.read(addr);
 
     chr_bank.set_bank(val&0b11);
 }
+
+void CNROM::serialize(StateStream& stream)
+{
+    if (has_crt_ram)
+        stream.io(crt_ram.m_data);
+    unsigned bank = chr_bank.bank();
+    stream.io(bank);
+
+    if (stream.loading())
+        chr_bank.set_bank(bank);
+}
@@ -31,8 +31,14 @@ SOFTWARE.
 #include "cnrom.hpp"
 #include "uxrom.hpp"
 
-std::array<Mapper*, 256> mapper_list =
-{&nrom, &mmc1, &uxrom, &cnrom, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+template <typename MapperType>
+static std::unique_ptr<Mapper> make_mapper(NES::Console& console)
+{
+    return std::make_unique<MapperType>(console);
+}
+
+std::array<mapper_factory, 256> mapper_list =
+{&make_mapper<NROM>, &make_mapper<MMC1>, &make_mapper<UxROM>, &make_mapper<CNROM>, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -33,31 +33,6 @@ SOFTWARE.
 #include "nes.hpp"
 #include "ppu/include/ppu.hpp"
 
-namespace
-{
-
-class Register : public MemoryInterfaceable {
-public:
-    Register() : MemoryInterfaceable(0x8000) {};
-    virtual data  read(address) override { return 0; };
-    virtual void write(address addr, data value) override
-    {
-        mmc1.register_write(0x8000 | addr, value);
-    };
-public:
-};
-
-}
-
-MMC1 mmc1;
-
-static RAMBankWindow<0x2000> crt_ram_bank;
-static ROMBankWindow<0x4000> prg_bank_low;
-static ROMBankWindow<0x4000> prg_bank_hi;
-static RAMBankWindow<0x1000> chr_bank_low;
-static RAMBankWindow<0x1000> chr_bank_hi;
-static Register register_memory;
-
 void MMC1::init(const cartridge_data& cart)
 {
     handle_bus_conflicts = cart.submapper == 5; // SEROM
@@ -79,28 +54,28 @@ void MMC1::init(const cartridge_data& cart)
     crt_ram_bank.set_rom_base(crt_ram.data(), crt_ram.size());
 
     if (!crt_ram.empty()) // PRG-(NV)RAM
-        NES::cpu_space.add_port(memory_port{&crt_ram_bank,  0x6000});
+        m_console.cpu_space.add_port(memory_port{&crt_ram_bank,  0x6000});
 
-    NES::cpu_space.add_read_port(memory_port{&prg_bank_low, 0x8000});
-    NES::cpu_space.add_read_port(memory_port{&prg_bank_hi , 0xC000});
-    NES::cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
+    m_console.cpu_space.add_read_port(memory_port{&prg_bank_low, 0x8000});
+    m_console.cpu_space.add_read_port(memory_port{&prg_bank_hi , 0xC000});
+    m_console.cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
 
-    NES::ppu.addr_space.add_read_port(memory_port{&chr_bank_low, 0x0000});
-    NES::ppu.addr_space.add_read_port(memory_port{&chr_bank_hi , 0x1000});
+    m_console.ppu.addr_space.add_read_port(memory_port{&chr_bank_low, 0x0000});
+    m_console.ppu.addr_space.add_read_port(memory_port{&chr_bank_hi , 0x1000});
     if (uses_chr_ram) // enable writes
     {
-        NES::ppu.addr_space.add_write_port(memory_port{&chr_bank_low, 0x0000});
-        NES::ppu.addr_space.add_write_port(memory_port{&chr_bank_hi , 0x1000});
+        m_console.ppu.addr_space.add_write_port(memory_port{&chr_bank_low, 0x0000});
+        m_console.ppu.addr_space.add_write_port(memory_port{&chr_bank_hi , 0x1000});
     }
 
     if (cart.mirroring == cartridge_data::Horizontal)
     {
-        NES::set_mirroring(NES::horizontal);
+        m_console.set_mirroring(NES::horizontal);
     }
     else if (cart.mirroring == cartridge_data::Vertical)
     {
         // V-mirroring
-        NES::set_mirroring(NES::vertical);
+        m_console.set_mirroring(NES::vertical);
     }
 
     ctrl_reg = 0x0C;
@@ -114,15 +89,15 @@ void MMC1::register_write(uint16_t addr, uint8_t val)
     // bus conflicts
     if (handle_bus_conflicts)
     {
-        val &= NES::cpu_space.read(addr);
+        val &= m_console.cpu_space.read(addr);
     }
 
     // ignore successive writes to prevent RMW instructions to alter the register twice due to dummy accesses
-    if (NES::cpu.cycles <= last_write_cycle+2)
+    if (m_console.cpu.cycles <= last_write_cycle+2)
     {
         return;
     }
-    last_write_cycle = NES::cpu.cycles;
+    last_write_cycle = m_console.cpu.cycles;
 
     if (val & 0x80) // bit 7 set
     {
@@ -175,21 +150,40 @@ std::vector<uint8_t> MMC1::save_battery_ram()
     return crt_ram;
 }
 
+void MMC1::serialize(StateStream& stream)
+{
+    stream.io(last_written_chr_reg);
+    stream.io(write_count);
+    stream.io(shift_register);
+    stream.io(ctrl_reg);
+    stream.io(chr0_reg);
+    stream.io(chr1_reg);
+    stream.io(prg_reg);
+    stream.io(last_write_cycle);
+
+    stream.bytes(crt_ram.data(), crt_ram.size());
+    if (uses_chr_ram)
+        stream.bytes(chr_rom.data(), chr_rom.size());
+
+    if (stream.loading())
+        apply_banking();
+}
+
 void MMC1::apply_banking()
 {
     switch (ctrl_reg&0b11)
     {
         case 0:
-            NES::set_mirroring(NES::onescreen_nt1);
+            m_console.set_mirroring(NES::onescreen_nt1);
             break;
         case 1:
-            NES::set_mirroring(NES::onescreen_nt2);
+            m_console.set_mirroring(NES::onescreen_nt2);
             break;
         case 2:
-            NES::set_mirroring(NES::vertical);
+            m_console.set_mirroring(NES::vertical);
             break;
         case 3:
-            NES::set_mirroring(NES::horizontal);
+            m_console.set_mirroring(NES::horizontal);
             break;
     }
 
@@ -30,13 +30,6 @@ SOFTWARE.
 #include "nes.hpp"
 #include "ppu/include/ppu.hpp"
 
-static ROM<0x8000> prg_rom;
-static ROM<0x2000> chr_rom;
-static RAM<0x2000> chr_ram;
-static RAM<0x2000> crt_ram;
-
-NROM nrom;
-
 void NROM::init(const cartridge_data& cart)
 {
     memcpy(prg_rom.m_data.data(), cart.prg_rom.data(), cart.prg_rom.size());
@@ -48,21 +41,33 @@ void NROM::init(const cartridge_data& cart)
     if (!cart.chr_rom.empty())
         memcpy(chr_rom.m_data.data(), cart.chr_rom.data(), 0x2000);
 
-    //NES::cpu_space.add_port(memory_port{&crt_ram,  0x6000});
-    NES::cpu_space.add_port(memory_port{&prg_rom , 0x8000});
+    // PRG-RAM, as the blargg tests expect from the iNES files that don't tell its size
+    has_crt_ram = cart.prg_ram_size || cart.nvram_size;
+    if (has_crt_ram)
+        m_console.cpu_space.add_port(memory_port{&crt_ram,  0x6000});
+    m_console.cpu_space.add_port(memory_port{&prg_rom , 0x8000});
 
     if (!cart.chr_rom.empty())
-        NES::ppu.addr_space.add_port(memory_port{&chr_rom, 0x0000});
+        m_console.ppu.addr_space.add_port(memory_port{&chr_rom, 0x0000});
     else
-        NES::ppu.addr_space.add_port(memory_port{&chr_ram, 0x0000});
+        m_console.ppu.addr_space.add_port(memory_port{&chr_ram, 0x0000});
+    uses_chr_ram = cart.chr_rom.empty();
 
     if (cart.mirroring == cartridge_data::Horizontal)
     {
-        NES::set_mirroring(NES::horizontal);
+        m_console.set_mirroring(NES::horizontal);
     }
     else if (cart.mirroring == cartridge_data::Vertical)
     {
         // V-mirroring
-        NES::set_mirroring(NES::vertical);
+        m_console.set_mirroring(NES::vertical);
     }
 }
+
+void NROM::serialize(StateStream& stream)
+{
+    if (has_crt_ram)
+        stream.io(crt_ram.m_data);
+    if (uses_chr_ram)
+        stream.io(chr_ram.m_data);
+}
@@ -33,38 +33,15 @@ SOFTWARE.
 #include "nes.hpp"
 #include "ppu/include/ppu.hpp"
 
-namespace
-{
-
-class Register : public MemoryInterfaceable {
-public:
-    Register() : MemoryInterfaceable(0x8000) {};
-    virtual data  read(address) override { return 0; };
-    virtual void write(address addr, data value) override
-    {
-        uxrom.register_write(0x8000 | addr, value);
-    };
-public:
-};
-
-}
-
-UxROM uxrom;
-
-static ROMBankWindow<0x4000> prg_rom_bank_lo;
-static ROMBankWindow<0x4000> prg_rom_bank_hi;
-static RAM<0x2000> chr_ram;
-static Register register_memory;
-
 void UxROM::init(const cartridge_data& cart)
 {
     prg_rom = cart.prg_rom;
 
-    NES::cpu_space.add_read_port(memory_port{&prg_rom_bank_lo , 0x8000});
-    NES::cpu_space.add_read_port(memory_port{&prg_rom_bank_hi , 0xC000});
-    NES::cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
+    m_console.cpu_space.add_read_port(memory_port{&prg_rom_bank_lo , 0x8000});
+    m_console.cpu_space.add_read_port(memory_port{&prg_rom_bank_hi , 0xC000});
+    m_console.cpu_space.add_write_port(memory_port{&register_memory, 0x8000});
 
-    NES::ppu.addr_space.add_port(memory_port{&chr_ram, 0x0000});
+    m_console.ppu.addr_space.add_port(memory_port{&chr_ram, 0x0000});
 
     prg_rom_bank_lo.set_rom_base(prg_rom.data(), prg_rom.size());
     prg_rom_bank_hi.set_rom_base(prg_rom.data(), prg_rom.size());
@@ -73,12 +50,12 @@ void UxROM::init(const cartridge_data& cart)
 
     if (cart.mirroring == cartridge_data::Horizontal)
     {
-        NES::set_mirroring(NES::horizontal);
+        m_console.set_mirroring(NES::horizontal);
     }
     else if (cart.mirroring == cartridge_data::Vertical)
     {
         // V-mirroring
-        NES::set_mirroring(NES::vertical);
+        m_console.set_mirroring(NES::vertical);
     }
 
     handle_bus_conflicts = cart.submapper == 2;
@@ -87,7 +64,17 @@ void UxROM::init(const cartridge_data& cart)
 void UxROM::register_write(uint16_t addr, uint8_t val)
 {
     if (handle_bus_conflicts)
-        val &= NES::cpu_space.read(addr);
+        val &= m_console.cpu_space.read(addr);
 
     prg_rom_bank_lo.set_bank(val&0b1111);
 }
+
+void UxROM::serialize(StateStream& stream)
+{
+    unsigned bank = prg_rom_bank_lo.bank();
+    stream.io(bank);
+    stream.io(chr_ram.m_data);
+
+    if (stream.loading())
+        prg_rom_bank_lo.set_bank(bank);
+}
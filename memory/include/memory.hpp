@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <array>
 #include <vector>
 
 #include "interface/memory.hpp"
@@ -10,9 +11,9 @@
 class AddressSpace : public Memory_interface {
 public:
     void add_read_port (memory_port port)
-    { add_port_impl(port, m_read_ports ); }
+    { add_port_impl(port, m_read_ports , m_read_pages ); }
     void add_write_port(memory_port port)
-    { add_port_impl(port, m_write_ports); }
+    { add_port_impl(port, m_write_ports, m_write_pages); }
 
     void add_port(memory_port port)
     { add_read_port(port); add_write_port(port); }
@@ -23,16 +24,105 @@ public:
     void clear();
 
     // Master ports : used by transaction masters to initiate one
-    virtual data  read(address ptr) override;
-    virtual data  poke(address ptr) override;
-    virtual void write(address ptr, data val) override;
+    // Accesses to modules publishing a direct pointer are resolved inline, without any virtual call
+    data read(address ptr) override
+    {
+        const page& pg = m_read_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_read_ptr() && pg.module->valid())
+            return m_last_bus_value = pg.module->direct_read_ptr()[ptr - pg.base_address];
+
+        return read_slow(ptr);
+    }
+    data poke(address ptr) override
+    {
+        const page& pg = m_read_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_read_ptr() && pg.module->valid())
+            return pg.module->direct_read_ptr()[ptr - pg.base_address];
+
+        return poke_slow(ptr);
+    }
+    void write(address ptr, data val) override
+    {
+        const page& pg = m_write_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_write_ptr() && pg.module->valid())
+        {
+            m_last_bus_value = val;
+            pg.module->direct_write_ptr()[ptr - pg.base_address] = val;
+            return;
+        }
+
+        write_slow(ptr, val);
+    }
+
+    // true if reading at this address can't have any side-effect
+    bool side_effect_free(address ptr) const
+    {
+        const page& pg = m_read_pages[ptr >> 8];
+        return pg.module && pg.module->side_effect_free() && pg.module->valid();
+    }
+
+    // Base of the 256-byte page containing ptr if reads there are served straight from memory (RAM or ROM), null otherwise.
+    const data* direct_page(address ptr) const
+    {
+        const page& pg = m_read_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_read_ptr() && pg.module->valid())
+            return pg.module->direct_read_ptr() + ((ptr & 0xFF00) - pg.base_address);
+
+        return nullptr;
+    }
+    // Base of the 256-byte page containing ptr if it is mapped onto read-only memory, null otherwise.
+    // The content of such a page can only change when its module is remapped (e.g. a ROM bank switch).
+    const data* rom_page(address ptr) const
+    {
+        const page& pg = m_read_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_read_ptr() && !pg.module->direct_write_ptr() && pg.module->valid())
+            return pg.module->direct_read_ptr() + ((ptr & 0xFF00) - pg.base_address);
+
+        return nullptr;
+    }
+    // Base of the 256-byte page containing ptr if writes there only store the value into memory, null otherwise.
+    data* ram_page(address ptr) const
+    {
+        const page& pg = m_write_pages[ptr >> 8];
+        if (pg.module && pg.module->direct_write_ptr() && pg.module->valid())
+            return pg.module->direct_write_ptr() + ((ptr & 0xFF00) - pg.base_address);
+
+        return nullptr;
+    }
+    // true if writing at this address only stores the value into RAM
+    bool ram_write(address ptr) const
+    {
+        const page& pg = m_write_pages[ptr >> 8];
+        return pg.module && pg.module->direct_write_ptr() && pg.module->valid();
+    }
+
+    // accesses resolved without going through the address space still leave their value on the data bus
+    data latch(data val)
+    { return m_last_bus_value = val; }
 
 private:
-    void add_port_impl(memory_port port, std::vector<memory_port>& port_list);
+    // A 256-byte page either maps entirely onto a single port, or is shared between several ports
+    // (or only partially mapped) in which case accesses fall back to a scan of the port list.
+    struct page
+    {
+        MemoryInterfaceable* module;
+        address base_address;
+        bool shared;
+    };
+    using page_table = std::array<page, 0x100>;
+
+    data  read_slow(address ptr);
+    data  poke_slow(address ptr);
+    void write_slow(address ptr, data val);
+
+    void add_port_impl(memory_port port, std::vector<memory_port>& port_list, page_table& pages);
     memory_port* find_port(address addr, std::vector<memory_port>& port_list);
+    static void rebuild_pages(const std::vector<memory_port>& port_list, page_table& pages);
 
 protected:
     std::vector<memory_port> m_read_ports;
     std::vector<memory_port> m_write_ports;
+    page_table m_read_pages  {};
+    page_table m_write_pages {};
     data m_last_bus_value = 0x00; // Used to emulate open-bus.
 };
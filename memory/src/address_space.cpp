@@ -5,7 +5,7 @@
 
 #include "memory.hpp"
 
-void AddressSpace::add_port_impl(memory_port port, std::vector<memory_port> &port_list)
+void AddressSpace::add_port_impl(memory_port port, std::vector<memory_port> &port_list, page_table &pages)
 {
     // check pre-conditions
     assert(port.module != nullptr && "Adding a port whose module is a null pointer was attempted");
@@ -25,13 +25,43 @@ void AddressSpace::add_port_impl(memory_port port, std::vector<memory_port> &por
 
     std::sort(port_list.begin(), port_list.end(),
               [](const memory_port &a, const memory_port &b){return a.base_address < b.base_address;});
+
+    rebuild_pages(port_list, pages);
+}
+
+void AddressSpace::rebuild_pages(const std::vector<memory_port> &port_list, page_table &pages)
+{
+    pages.fill(page{nullptr, 0, false});
+
+    for (const auto& port : port_list)
+    {
+        if (port.module->size() == 0)
+            continue;
+
+        const uint32_t first = port.base_address;
+        const uint32_t last  = std::min<uint32_t>(first + port.module->size(), 0x10000) - 1;
+
+        for (uint32_t i = first >> 8; i <= (last >> 8); ++i)
+        {
+            const bool covers_page = first <= (i << 8) && last >= ((i << 8) | 0xFF);
+
+            if (pages[i].module || pages[i].shared || !covers_page)
+            {
+                pages[i] = page{nullptr, 0, true};
+            }
+            else
+            {
+                pages[i] = page{port.module, port.base_address, false};
+            }
+        }
+    }
 }
 
 memory_port *AddressSpace::find_port(address addr, std::vector<memory_port> &port_list)
 {
     // O(n) but actually much faster than a binary search due to a lower constant time
     auto it = port_list.begin();
-    while (it->base_address <= addr && it != port_list.end())
+    while (it != port_list.end() && it->base_address <= addr)
         ++it;
     // The return it is *greater* than the address we search for.
     // If a mem modules hits, it must be the one before it.
@@ -57,6 +87,8 @@ void AddressSpace::remove_port(MemoryInterfaceable* to_remove) {
                         m_write_ports.end());
 
     // removing elements from a sorted container keeps it sorted
+    rebuild_pages(m_read_ports , m_read_pages );
+    rebuild_pages(m_write_ports, m_write_pages);
 }
 
 void AddressSpace::remove_port(address addr)
@@ -67,16 +99,25 @@ void AddressSpace::remove_port(address addr)
                         m_write_ports.end());
 
     // removing elements from a sorted container keeps it sorted
+    rebuild_pages(m_read_ports , m_read_pages );
+    rebuild_pages(m_write_ports, m_write_pages);
 }
 
 void AddressSpace::clear()
 {
     m_read_ports.clear();
     m_write_ports.clear();
+
+    rebuild_pages(m_read_ports , m_read_pages );
+    rebuild_pages(m_write_ports, m_write_pages);
 }
 
-data AddressSpace::read(address ptr) {
-    auto* port = find_port(ptr, m_read_ports);
+data AddressSpace::read_slow(address ptr) {
+    const page& pg = m_read_pages[ptr >> 8];
+    if (pg.module && pg.module->valid())
+        return m_last_bus_value = pg.module->read(ptr - pg.base_address);
+
+    auto* port = pg.shared ? find_port(ptr, m_read_ports) : nullptr;
     if (!port)
     {
         info("read open bus at 0x%x\n", ptr);
@@ -87,9 +128,13 @@ data AddressSpace::read(address ptr) {
         return m_last_bus_value = port->module->read(ptr - port->base_address);
 }
 
-data AddressSpace::poke(address ptr)
+data AddressSpace::poke_slow(address ptr)
 {
-    auto* port = find_port(ptr, m_read_ports);
+    const page& pg = m_read_pages[ptr >> 8];
+    if (pg.module && pg.module->valid())
+        return pg.module->poke(ptr - pg.base_address);
+
+    auto* port = pg.shared ? find_port(ptr, m_read_ports) : nullptr;
     if (!port)
     {
         info("poke open bus at 0x%x\n", ptr);
@@ -100,10 +145,18 @@ data AddressSpace::poke(address ptr)
         return port->module->poke(ptr - port->base_address);
 }
 
-void AddressSpace::write(address ptr, data value) {
-    auto* port = find_port(ptr, m_write_ports);
+void AddressSpace::write_slow(address ptr, data value) {
     m_last_bus_value = value; // open bus
 
+    const page& pg = m_write_pages[ptr >> 8];
+    if (pg.module && pg.module->valid())
+    {
+        pg.module->write(ptr - pg.base_address, value);
+        return;
+    }
+
+    auto* port = pg.shared ? find_port(ptr, m_write_ports) : nullptr;
+
     if (!port)
     {
         info("write open bus at 0x%x\n", ptr);
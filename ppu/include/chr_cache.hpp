@@ -0,0 +1,109 @@
+/*
+chr_cache.hpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef CHR_CACHE_HPP
+#define CHR_CACHE_HPP
+
+#include <cstdint>
+#include <array>
+
+#include "memory/include/memory.hpp"
+
+// Pattern table rows ($0000-$1FFF) of the ppu's address space, predecoded from their two bit planes to 8 pixels of
+// 2 bits each. Rows are decoded lazily, a tile at a time, from the memory mapped when they are first fetched :
+// remap() must be called whenever the CHR banks may have been switched, and write() after each write to CHR.
+class CHRCache
+{
+public:
+    struct row
+    {
+        uint8_t  low;    // bit 0 of the pixels' palette index
+        uint8_t  high;   // bit 1
+        uint16_t pixels; // both planes interleaved, the leftmost pixel in the highest bits
+    };
+
+    CHRCache(AddressSpace& space) : m_space(space)
+    {}
+
+    // the pixels of a bit plane, spread to every other bit
+    static constexpr std::array<uint16_t, 0x100> spread_plane = []
+    {
+        std::array<uint16_t, 0x100> table {};
+        for (unsigned plane { 0 }; plane < 0x100; ++plane)
+            for (unsigned bit { 0 }; bit < 8; ++bit)
+                table[plane] |= ((plane >> bit) & 0b1) << (bit*2);
+        return table;
+    }();
+    static uint16_t planar_to_chunky(uint8_t low, uint8_t high)
+    { return spread_plane[low] | (spread_plane[high] << 1); }
+
+    // pattern fetches : low at addr, high at addr + 8
+    uint8_t read_low(uint16_t addr)
+    {
+        const row* cached = find(addr);
+        return cached ? m_space.latch(cached->low) : m_space.read(addr);
+    }
+    uint8_t read_high(uint16_t addr)
+    {
+        const row* cached = find(addr);
+        return cached ? m_space.latch(cached->high) : m_space.read(addr + 8);
+    }
+    // the pixels of the row at addr, without going through the bus
+    uint16_t pixels(uint16_t addr)
+    {
+        const row* cached = find(addr);
+        return cached ? cached->pixels : planar_to_chunky(m_space.poke(addr), m_space.poke(addr + 8));
+    }
+
+    void remap();
+    void write(uint16_t addr);
+    void clear();
+
+    // changes whenever the pattern tables may have changed : writes, bank switches, or remaps of memory the cache
+    // can't follow
+    unsigned changes() const
+    { return m_changes; }
+
+private:
+    static constexpr unsigned pages = 0x20;
+    static constexpr unsigned tiles = 0x200;
+
+    const row* find(uint16_t addr)
+    {
+        // rows start on a multiple of 16 plus 0 to 7, in the pattern tables
+        if ((addr & 0xE008) == 0 && m_tile_valid[addr >> 4])
+            return &m_rows[(addr >> 4)*8 + (addr & 7)];
+        return find_slow(addr);
+    }
+    const row* find_slow(uint16_t addr);
+
+private:
+    AddressSpace& m_space;
+    std::array<const uint8_t*, pages> m_sources {};  // memory each 256-byte page was decoded from, null if not cacheable
+    std::array<bool, tiles>           m_tile_valid {};
+    std::array<row, tiles*8>          m_rows {};
+    unsigned                          m_changes { 0 };
+};
+
+#endif // CHR_CACHE_HPP
@@ -0,0 +1,55 @@
+/*
+pixel_compose.hpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef PIXEL_COMPOSE_HPP
+#define PIXEL_COMPOSE_HPP
+
+#include <cstdint>
+
+// Composition of 8 consecutive pixels of a scanline from the background and the sprites in front of it
+
+// sprite pixels : palette index (0x10-0x1F) and flags, 0 where there is no opaque sprite pixel
+enum SpritePixel : uint8_t
+{
+    SpriteColor  = 0x1F,
+    SpriteBehind = (1<<5), // behind the background
+    SpriteZero   = (1<<6)
+};
+
+struct pixel_span
+{
+    uint16_t bg_pattern; // background pattern of the 8 pixels, 2 bits each, the leftmost in the highest bits ; 0 if hidden
+    uint16_t bg_palette; // their attribute bits, likewise
+    const uint8_t* sprites; // the sprite pixel in front of each of them
+};
+
+// Writes the palette index of each pixel to out, palette being the 32-byte palette RAM and the indexes being and-ed
+// with grey_mask. Returns the pixels where sprite 0 hits the background, bit i standing for the ith pixel.
+using compose_fn = uint8_t(*)(const pixel_span& span, const uint8_t* palette, uint8_t grey_mask, uint8_t* out);
+
+uint8_t compose_pixels_scalar(const pixel_span& span, const uint8_t* palette, uint8_t grey_mask, uint8_t* out);
+// SSE4.1 implementation, null if the cpu doesn't support it
+extern const compose_fn compose_pixels_simd;
+
+#endif // PIXEL_COMPOSE_HPP
@@ -35,15 +35,21 @@ SOFTWARE.
 #include "interrupts/include/interrupts.hpp"
 #include "cpu/include/cpu.hpp" // for debug
 
+#include "chr_cache.hpp"
+#include "pixel_compose.hpp"
+#include "video_output.hpp"
+#include "common/state_stream.hpp"
+
 class PPU : public InterruptEmitter<NMI>
 {
     friend class PPUCtrlRegs;
     friend class IORegs;
 
 public:
-    cpu6502* cpu;
+    cpu6502_base* cpu;
     AddressSpace addr_space;
-    std::array<uint8_t, 240*256> framebuffer;
+    CHRCache chr_cache { addr_space }; // pattern fetches, remapped by remap()
+    std::array<uint8_t, 240*256> framebuffer {};
     unsigned frames { 0 };
 
     // ABGR format
@@ -63,8 +69,59 @@ public:
     void power_up();
     void reset();
 
+    // The ppu can be run by either of two cores, which give the exact same results :
+    //  - render_frame() renders frames forever on a coroutine, yielding once per dot
+    //  - run_dots() advances a state machine by a number of dots, each of them counting as a resume of that coroutine
     void render_frame();
 
+    void run_dots(size_t dots);
+    // the state machine starts over from the pre-render line, as a new render_frame() coroutine would
+    void restart_frame();
+
+    // With scanline_renderer, run_dots() defers the visible dots of a line and draws the whole line at once when they
+    // are over (render_scanline()). Anything the rest of the line depends on (register accesses, bank switches) must
+    // call flush_scanline() first, which falls back to the dot renderer for that line.
+    // The coroutine core always uses the dot renderer.
+    void flush_scanline();
+
+    // Besides framebuffer, the lines can be written in a display format to a caller-provided buffer of 240 lines of
+    // 256 pixels, pitch bytes apart (0 for contiguous lines), as they are drawn. Emphasis is applied through a lut
+    // built here. set_output(nullptr) stops writing to it.
+    void set_output(void* pixels, PixelFormat format = PixelFormat::RGBA8888, size_t pitch = 0);
+
+    bool scanline_renderer { true };
+    // compose pixels with compose_pixels_simd when the cpu supports it
+    bool simd_compose { true };
+    // Frames skipped after each drawn one (e.g. for fast-forward), skip_all_frames to draw none. The pixels of a
+    // skipped frame aren't composed, which leaves framebuffer and the output buffer as they were, but sprite 0 hits,
+    // sprite overflow, vblank and the scrolling registers behave exactly the same.
+    unsigned frameskip { 0 };
+    static constexpr unsigned skip_all_frames = UINT_MAX;
+
+    // To be called whenever the mapper may have switched CHR banks or the nametables' mirroring, and after each write
+    // to the nametables. The scanline renderer reuses the background of a line from a previous frame when it starts
+    // from the same registers and nothing it was fetched from changed since.
+    void remap();
+    void nametable_write(uint16_t addr);
+    // same, for a write at 'offset' (0-0x3FF) of a nametable made outside of the address space, 'page' being the
+    // 256 bytes of its memory written to
+    void nametable_write(const uint8_t* page, unsigned offset);
+    bool reuse_backgrounds { true };
+
+    // Everything but framebuffer and the output buffer, the next frame redraws them. Lines must have been flushed
+    // before saving (flush_scanline()).
+    void serialize(StateStream& stream);
+
+    struct render_stats
+    {
+        size_t fast_scanlines { 0 };
+        size_t dot_scanlines  { 0 };
+        size_t skipped_frames { 0 };
+        size_t reused_backgrounds { 0 }; // fast scanlines whose background was reused
+    } stats;
+    // share of the lines drawn by the scanline renderer over the last frame whose background was reused
+    float background_reuse { 0 };
+
 private:
     unsigned sprite_height() const
     { return (m_ctrl & SpriteSize8x16) ? 16 : 8; }
@@ -80,10 +137,17 @@ private:
     }
 
     void sprite_evaluation();
+    void bin_sprites();
     void prefetch_sprites();
     void do_buggy_overflow_evaluation(uint8_t starting_sprite);
     void fetch_next_tile();
     void render_tile(unsigned tile_idx);
+    void render_scanline();
+    void rasterize_sprites();
+    void draw_tile(unsigned tile_idx, uint32_t bg_pixels);
+    uint32_t shift_background(unsigned tile_idx, uint32_t bg_pixels);
+    void draw_pixels(unsigned tile_idx, uint32_t background);
+    bool reuse_background();
     void do_unused_nt_fetches();
     void reload_shifts();
 
@@ -100,6 +164,42 @@ private:
     template <ScanlineType Type>
     void scanline();
 
+    // The work done between two dots, shared by both cores. Fetches spanning several dots keep their state in members.
+    template <ScanlineType Type>
+    void begin_scanline();
+    template <ScanlineType Type>
+    void setup_scanline();
+    void begin_vblank_line();
+    void end_scanline();
+
+    void begin_tile_fetch();
+    void fetch_tile_attr();
+    void fetch_tile_low();
+    void fetch_tile_high();
+    void end_tile_fetch();
+    void shift_first_tile();
+    void end_visible_fetches();
+
+    void begin_sprite_fetches();
+    void fetch_sprite_nt(unsigned idx);
+    void fetch_sprite_attr();
+    void fetch_sprite_low();
+    void fetch_sprite_high();
+    void store_sprite(unsigned idx);
+
+    void begin_unused_nt_fetches();
+    void update_skip_cycle();
+    void end_unused_nt_fetches();
+
+    // state machine core
+    void run_dot();
+    void start_line();
+    void run_dot_action(unsigned dot);
+    template <ScanlineType Type>
+    void run_line_action(unsigned dot);
+    ScanlineType line_type() const
+    { return m_frame_line == 0 ? PreRender : (m_frame_line <= 240 ? Render : Idle); }
+
 private:
     void cycle(int amnt = 1);
 
@@ -135,7 +235,7 @@ private:
     uint8_t oam_read(uint8_t addr)
     { return ((uint8_t*)(m_oam_memory.data()))[addr]; }
     void    oam_write(uint8_t addr, uint8_t val)
-    { ((uint8_t*)(m_oam_memory.data()))[addr] = val; }
+    { ((uint8_t*)(m_oam_memory.data()))[addr] = val; m_sprite_bins_dirty = true; }
 
     void    oam_dma(const std::array<uint8_t, 256>& data);
 
@@ -177,7 +277,13 @@ private:
         uint8_t attributes;
         uint8_t pattern_high; // bit 1 of palette idx; 8 times
         uint8_t pattern_low;  // bit 0 of palette idx; 8 times
+        uint16_t pixels;      // both, predecoded by CHRCache::planar_to_chunky
     };
+    static uint8_t sprite_pixel(const prefetched_sprite& sprite, uint8_t pattern)
+    {
+        return 0x10 | (sprite.attributes & Palette)*4 | pattern |
+                ((sprite.attributes & BehindBG) ? SpriteBehind : 0) | ((sprite.attributes & Sprite0) ? SpriteZero : 0);
+    }
 
 public:
     // scrolling internal registers
@@ -196,18 +302,18 @@ public:
     unsigned                    m_sprite_overflow_cycle { UINT_MAX };
     unsigned                    m_delayed_vram_cycle { UINT_MAX };
 
-    uint16_t                    m_tile_bmp_lo;
-    uint16_t                    m_tile_bmp_hi;
+    uint16_t                    m_tile_bmp_lo { 0 };
+    uint16_t                    m_tile_bmp_hi { 0 };
 
-    uint8_t                     m_attr_shift_lo;
-    uint8_t                     m_attr_shift_hi;
-    uint8_t                     m_attr_latch_lo;
-    uint8_t                     m_attr_latch_hi;
+    uint8_t                     m_attr_shift_lo { 0 };
+    uint8_t                     m_attr_shift_hi { 0 };
+    uint8_t                     m_attr_latch_lo { 0 };
+    uint8_t                     m_attr_latch_hi { 0 };
 
-    uint8_t                     m_prefetched_at_lo;
-    uint8_t                     m_prefetched_at_hi;
-    uint8_t                     m_prefetched_bg_lo;
-    uint8_t                     m_prefetched_bg_hi;
+    uint8_t                     m_prefetched_at_lo { 0 };
+    uint8_t                     m_prefetched_at_hi { 0 };
+    uint8_t                     m_prefetched_bg_lo { 0 };
+    uint8_t                     m_prefetched_bg_hi { 0 };
 
     bool                        m_odd_frame { false };
     uint8_t                     m_status { 0 };
@@ -215,11 +321,92 @@ public:
     uint8_t                     m_mask { 0 };
     size_t                      m_current_line { 0 };
     unsigned                    m_clocks { 0 };
-    std::array<sprite_data, 64> m_oam_memory;
-    std::array<sprite_data, 8>  m_secondary_oam;
+    std::array<sprite_data, 64> m_oam_memory {};
+    std::array<sprite_data, 8>  m_secondary_oam {};
 
-    std::array<prefetched_sprite, 8> m_prefetched_sprites;
-    std::array<uint8_t, 0x20>        m_palette_copy;
+    // what sprite_evaluation() finds on each line (261 is the pre-render line), built from OAM by bin_sprites()
+    struct sprite_bin
+    {
+        uint8_t count { 0 };
+        std::array<uint8_t, 8> sprites {};
+        uint8_t overflow_from { 64 }; // where the overflow evaluation starts once 8 sprites are found, 64 if it doesn't
+    };
+    std::array<sprite_bin, 262> m_sprite_bins {};
+    unsigned                    m_binned_sprite_height { 0 };
+    bool                        m_sprite_bins_dirty { true };
+
+    std::array<prefetched_sprite, 8> m_prefetched_sprites {};
+    // the same sprites laid out over the line, see SpritePixel
+    std::array<uint8_t, 256>         m_sprite_line {};
+    bool                             m_sprite_line_empty { true };
+    std::array<uint8_t, 0x20>        m_palette_copy {};
+
+    // fetches in progress
+    uint16_t                    m_tile_fetch_v { 0 }; // v when the tile fetch began
+    uint16_t                    m_tile_pattern_addr { 0 };
+    uint8_t                     m_tile_attr { 0 };
+    uint16_t                    m_sprite_nt_addr { 0 };
+    uint16_t                    m_sprite_attr_addr { 0 };
+    uint16_t                    m_sprite_pattern_addr { 0 };
+    uint8_t                     m_sprite_pattern_lo { 0 };
+    uint8_t                     m_sprite_pattern_hi { 0 };
+    uint16_t                    m_unused_nt_addr { 0 };
+
+    // state machine position : line of render_frame()'s sequence (0 is the pre-render line) and dots run on that line
+    unsigned                    m_frame_line { 0 };
+    unsigned                    m_dot { 0 };
+
+    // the visible dots run on the current line haven't been rendered yet
+    bool                        m_line_deferred { false };
+    // the current frame is skipped, see frameskip
+    bool                        m_skip_pixels { false };
+
+    // background reuse, see remap()
+    struct background_inputs // the registers a line's background fetches start from
+    {
+        uint16_t v, tile_bmp_lo, tile_bmp_hi;
+        uint8_t  x, ctrl, mask;
+        uint8_t  attr_shift_lo, attr_shift_hi, attr_latch_lo, attr_latch_hi;
+        unsigned chr_changes;
+
+        bool operator==(const background_inputs& other) const
+        {
+            return v == other.v && tile_bmp_lo == other.tile_bmp_lo && tile_bmp_hi == other.tile_bmp_hi &&
+                    x == other.x && ctrl == other.ctrl && mask == other.mask &&
+                    attr_shift_lo == other.attr_shift_lo && attr_shift_hi == other.attr_shift_hi &&
+                    attr_latch_lo == other.attr_latch_lo && attr_latch_hi == other.attr_latch_hi &&
+                    chr_changes == other.chr_changes;
+        }
+    };
+    struct background_outputs // the registers they leave
+    {
+        uint16_t v, tile_fetch_v, tile_pattern_addr, tile_bmp_lo, tile_bmp_hi;
+        uint8_t  tile_attr, prefetched_bg_lo, prefetched_bg_hi, prefetched_at_lo, prefetched_at_hi;
+        uint8_t  attr_shift_lo, attr_shift_hi, attr_latch_lo, attr_latch_hi;
+    };
+    struct background_line
+    {
+        bool               valid { false };
+        background_inputs  inputs;
+        uint64_t           fetched; // m_nametable_clock when it was fetched
+        std::array<uint32_t, 32> tiles; // shift_background() of each tile
+        background_outputs outputs;
+    };
+    background_inputs  background_state() const;
+    background_outputs background_result() const;
+
+    std::array<background_line, 240>     m_background_lines {};
+    // when each row of 32 bytes of the four nametables was last written, on m_nametable_clock
+    std::array<std::array<uint64_t, 32>, 4> m_nametable_rows {};
+    std::array<const uint8_t*, 4>        m_nametable_sources {};
+    uint64_t                             m_nametable_clock { 0 };
+    size_t                               m_frame_reused_backgrounds { 0 }, m_frame_fast_scanlines { 0 };
+
+    // see set_output()
+    uint8_t*                    m_output { nullptr };
+    PixelFormat                 m_output_format { PixelFormat::RGBA8888 };
+    size_t                      m_output_pitch { 0 };
+    output_lut                  m_output_lut {};
 };
 
 #endif // PPU_HPP
@@ -28,6 +28,7 @@ SOFTWARE.
 #include <array>
 
 #include "memory/include/memory.hpp"
+#include "common/state_stream.hpp"
 
 class PPU;
 
@@ -52,6 +53,7 @@ public:
 public:
     void clear_decay();
     void reset();
+    void serialize(StateStream& stream);
 
 protected:
     data  read(address ptr)             override;
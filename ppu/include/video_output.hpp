@@ -0,0 +1,86 @@
+/*
+video_output.hpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef VIDEO_OUTPUT_HPP
+#define VIDEO_OUTPUT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+
+// Conversion of the ppu's palette indexes to the pixel format a frontend displays
+
+enum class PixelFormat
+{
+    Indexed,  // the palette index itself, emphasis dropped, one byte
+    RGBA8888, // bytes R, G, B, A in memory
+    BGRA8888, // bytes B, G, R, A in memory
+    RGB565    // 16-bit little-endian word
+};
+
+inline size_t bytes_per_pixel(PixelFormat format)
+{
+    switch (format)
+    {
+        case PixelFormat::Indexed:
+            return 1;
+        case PixelFormat::RGB565:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+// The 512 colors a pixel can take in a format : palette index in the low 6 bits, the PPUMASK emphasis bits
+// (red, green, blue) above them
+using output_lut = std::array<uint32_t, 512>;
+
+// rgba_palette holds the 64 colors of the NES palette, bytes R, G, B, A in memory
+output_lut make_output_lut(PixelFormat format, const uint32_t* rgba_palette);
+
+// Writes count pixels to out, colors being the 64 entries of the lut for the current emphasis
+inline void convert_pixels(PixelFormat format, const uint32_t* colors, const uint8_t* indexes, size_t count, uint8_t* out)
+{
+    switch (format)
+    {
+        case PixelFormat::Indexed:
+            for (size_t i { 0 }; i < count; ++i)
+                out[i] = colors[indexes[i] & 0x3F];
+            break;
+        case PixelFormat::RGB565:
+            for (size_t i { 0 }; i < count; ++i)
+            {
+                const uint16_t color = colors[indexes[i] & 0x3F];
+                std::memcpy(out + i*2, &color, 2);
+            }
+            break;
+        default:
+            for (size_t i { 0 }; i < count; ++i)
+                std::memcpy(out + i*4, &colors[indexes[i] & 0x3F], 4);
+            break;
+    }
+}
+
+#endif // VIDEO_OUTPUT_HPP
@@ -0,0 +1,96 @@
+/*
+chr_cache.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "chr_cache.hpp"
+
+#include <algorithm>
+
+void CHRCache::remap()
+{
+    bool changed = false;
+    for (unsigned page { 0 }; page < pages; ++page)
+    {
+        const uint8_t* source = m_space.direct_page(page << 8);
+        if (source != m_sources[page])
+        {
+            m_sources[page] = source;
+            std::fill_n(m_tile_valid.begin() + page*16, 16, false);
+            changed = true;
+        }
+        else if (!source)
+        {
+            changed = true; // read through the bus, it may have been switched
+        }
+    }
+
+    if (changed)
+        ++m_changes;
+}
+
+void CHRCache::write(uint16_t addr)
+{
+    ++m_changes;
+
+    const uint8_t* page = m_space.direct_page(addr);
+    if (!page)
+        return;
+
+    // the same memory can be mapped at several places (e.g. both CHR windows on the same bank)
+    const uint8_t* written = page + (addr & 0xFF);
+    for (unsigned i { 0 }; i < pages; ++i)
+    {
+        if (m_sources[i] && written >= m_sources[i] && written < m_sources[i] + 0x100)
+        {
+            m_tile_valid[i*16 + (written - m_sources[i])/16] = false;
+        }
+    }
+}
+
+void CHRCache::clear()
+{
+    m_sources.fill(nullptr);
+    m_tile_valid.fill(false);
+    ++m_changes;
+}
+
+const CHRCache::row* CHRCache::find_slow(uint16_t addr)
+{
+    if (addr & 0xE008)
+        return nullptr;
+
+    const unsigned tile = addr >> 4;
+    const uint8_t* source = m_sources[tile / 16];
+    if (!source)
+        return nullptr;
+
+    source += (tile % 16)*16;
+    for (unsigned y { 0 }; y < 8; ++y)
+    {
+        m_rows[tile*8 + y] = {source[y], source[y + 8], planar_to_chunky(source[y], source[y + 8])};
+    }
+    m_tile_valid[tile] = true;
+
+    return &m_rows[tile*8 + (addr & 7)];
+}
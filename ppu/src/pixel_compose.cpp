@@ -0,0 +1,109 @@
+/*
+pixel_compose.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "pixel_compose.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+uint8_t compose_pixels_scalar(const pixel_span& span, const uint8_t* palette, uint8_t grey_mask, uint8_t* out)
+{
+    uint8_t hits = 0;
+    for (unsigned i { 0 }; i < 8; ++i)
+    {
+        const uint8_t bg_pattern = (span.bg_pattern >> (14 - i*2)) & 0b11;
+        const uint8_t bg_palette = (span.bg_palette >> (14 - i*2)) & 0b11;
+        const uint8_t sprite = span.sprites[i];
+
+        if ((sprite & SpriteZero) && bg_pattern)
+        {
+            hits |= 1 << i;
+        }
+
+        uint8_t output_color;
+        if (sprite && !(bg_pattern && (sprite & SpriteBehind)))
+            output_color = palette[sprite & SpriteColor];
+        else
+            output_color = palette[bg_pattern ? (bg_palette*4 | bg_pattern) : 0x00];
+
+        out[i] = output_color & grey_mask;
+    }
+
+    return hits;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+namespace
+{
+
+// the pixels are handled in the low 8 bytes of the vectors
+[[gnu::target("sse4.1")]]
+uint8_t compose_pixels_sse41(const pixel_span& span, const uint8_t* palette, uint8_t grey_mask, uint8_t* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    // 2-bit fields to bytes : shift the ith field to the top of the ith 16-bit lane, then down
+    const __m128i field_shifts = _mm_setr_epi16(1<<0, 1<<2, 1<<4, 1<<6, 1<<8, 1<<10, 1<<12, 1<<14);
+    __m128i bg_pattern = _mm_srli_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.bg_pattern), field_shifts), 14);
+    __m128i bg_palette = _mm_srli_epi16(_mm_mullo_epi16(_mm_set1_epi16(span.bg_palette), field_shifts), 14);
+    bg_pattern = _mm_packus_epi16(bg_pattern, bg_pattern);
+    bg_palette = _mm_packus_epi16(bg_palette, bg_palette);
+
+    const __m128i bg_opaque = _mm_xor_si128(_mm_cmpeq_epi8(bg_pattern, zero), _mm_set1_epi8(-1));
+    const __m128i bg_index  = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(bg_palette, 2), bg_pattern), bg_opaque);
+
+    const __m128i sprites = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(span.sprites));
+    const __m128i sprite_opaque = _mm_xor_si128(_mm_cmpeq_epi8(sprites, zero), _mm_set1_epi8(-1));
+    const __m128i behind  = _mm_cmpeq_epi8(_mm_and_si128(sprites, _mm_set1_epi8(SpriteBehind)), _mm_set1_epi8(SpriteBehind));
+    const __m128i is_zero = _mm_cmpeq_epi8(_mm_and_si128(sprites, _mm_set1_epi8(SpriteZero)), _mm_set1_epi8(SpriteZero));
+
+    // sprite priority : opaque sprite pixels win unless they are behind an opaque background pixel
+    const __m128i use_sprite = _mm_andnot_si128(_mm_and_si128(bg_opaque, behind), sprite_opaque);
+    const __m128i index = _mm_blendv_epi8(bg_index, _mm_and_si128(sprites, _mm_set1_epi8(SpriteColor)), use_sprite);
+
+    // palette lookup : each half of the palette RAM is a 16-entry shuffle table
+    const __m128i low_colors  = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette)), index);
+    const __m128i high_colors = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(palette + 16)), index);
+    const __m128i high_half = _mm_cmpeq_epi8(_mm_and_si128(index, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+    const __m128i colors = _mm_and_si128(_mm_blendv_epi8(low_colors, high_colors, high_half), _mm_set1_epi8(grey_mask));
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), colors);
+
+    return _mm_movemask_epi8(_mm_and_si128(is_zero, bg_opaque)) & 0xFF;
+}
+
+compose_fn detect_simd()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") ? compose_pixels_sse41 : nullptr;
+}
+
+}
+
+const compose_fn compose_pixels_simd = detect_simd();
+#else
+const compose_fn compose_pixels_simd = nullptr;
+#endif
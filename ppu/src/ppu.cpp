@@ -24,6 +24,10 @@ SOFTWARE.
 */
 
 #include "ppu.hpp"
+
+#include <algorithm>
+#include <cstring>
+
 #include "assert.h"
 
 #include "common/coroutine.hpp"
@@ -51,6 +55,112 @@ enum VRegComponents : uint16_t
     co_yield(); \
     m_clocks += (amnt);
 
+namespace
+{
+// The state machine core runs, on dot N of a line, what the coroutine core runs after its Nth yield on that line,
+// dot 0 being the start of the line.
+constexpr unsigned line_dots = 341;
+// first dot past the visible part of the line, where the sprite fetches begin
+constexpr unsigned sprite_fetch_dot = 257;
+
+enum DotAction : uint8_t
+{
+    None,
+    SetupLine,     // sprite evaluation, first tile
+    NextTile,
+    TileAttr,
+    TileLow,
+    TileHigh,
+    SpriteFetches, // last tile of the line fetched, sprite fetches begin
+    NextSprite,
+    SpriteAttr,
+    SpriteLow,
+    SpriteHigh,
+    PrefetchTiles, // last sprite fetched, first tile of the next line
+    SecondTile,
+    UnusedFetches,
+    SkipCycle,
+    UnusedFetch,
+    VBlankLine,
+    EndLine
+};
+
+struct dot_entry
+{
+    DotAction action;
+    uint16_t  clocks;   // added to m_clocks before the action
+    uint16_t  idle_run; // for actionless dots : number of identical dots starting with this one
+};
+
+using dot_table = std::array<dot_entry, line_dots + 1>;
+
+constexpr void count_idle_runs(dot_table& table)
+{
+    for (unsigned dot { line_dots }; dot >= 1; --dot)
+    {
+        dot_entry& entry = table[dot];
+        if (entry.action != None)
+            continue;
+
+        const bool same_next = dot < line_dots && table[dot + 1].action == None && table[dot + 1].clocks == entry.clocks;
+        entry.idle_run = 1 + (same_next ? table[dot + 1].idle_run : 0);
+    }
+}
+
+// pre-render and visible lines
+constexpr dot_table make_render_dots()
+{
+    dot_table table {};
+    for (unsigned dot { 1 }; dot <= line_dots; ++dot)
+        table[dot] = {None, 1, 0};
+
+    table[1].action = SetupLine;
+    // tiles 32 and 33 are the first two tiles of the next line, fetched after the sprites
+    for (unsigned tile { 0 }; tile < 34; ++tile)
+    {
+        const unsigned start = tile < 32 ? 1 + tile*8 : 321 + (tile - 32)*8;
+        if (tile != 0 && tile < 32)
+            table[start].action = NextTile;
+        table[start + 2].action = TileAttr;
+        table[start + 3].action = TileLow;
+        table[start + 5].action = TileHigh;
+    }
+    for (unsigned sprite { 0 }; sprite < 8; ++sprite)
+    {
+        const unsigned start = 257 + sprite*8;
+        table[start].action = sprite == 0 ? SpriteFetches : NextSprite;
+        table[start + 2].action = SpriteAttr;
+        table[start + 4].action = SpriteLow;
+        table[start + 6].action = SpriteHigh;
+    }
+    table[321].action = PrefetchTiles;
+    table[329].action = SecondTile;
+    table[337].action = UnusedFetches;
+    table[338].action = SkipCycle;
+    table[339].action = UnusedFetch;
+    table[341].action = EndLine;
+
+    count_idle_runs(table);
+    return table;
+}
+
+// post-render and vblank lines : after the first dots, the coroutine core skips to the end of the line at once
+constexpr dot_table make_idle_dots()
+{
+    dot_table table {};
+    for (unsigned dot { 1 }; dot <= line_dots; ++dot)
+        table[dot] = {None, dot <= 3, 0};
+
+    table[1].action = VBlankLine;
+    table[line_dots] = {EndLine, 338, 0};
+
+    count_idle_runs(table);
+    return table;
+}
+
+constexpr dot_table render_dots = make_render_dots();
+constexpr dot_table idle_dots   = make_idle_dots();
+}
 
 
 void PPU::render_frame()
@@ -70,6 +180,235 @@ void PPU::render_frame()
     ++frames;
 }
 
+void PPU::run_dots(size_t dots)
+{
+    while (dots)
+    {
+        if (m_line_deferred && m_dot < sprite_fetch_dot)
+        {
+            // the visible dots of a deferred line are only counted
+            const unsigned run = std::min<size_t>(dots, sprite_fetch_dot - m_dot);
+            m_clocks += run;
+            m_dot += run;
+            dots  -= run;
+            continue;
+        }
+        if (m_dot != 0)
+        {
+            // dots without any work are run in bulk
+            const dot_entry& entry = (line_type() == Idle ? idle_dots : render_dots)[m_dot];
+            if (entry.action == None)
+            {
+                const unsigned run = std::min<size_t>(dots, entry.idle_run);
+                m_clocks += run*entry.clocks;
+                m_dot += run;
+                dots  -= run;
+                continue;
+            }
+        }
+
+        run_dot();
+        --dots;
+    }
+}
+
+void PPU::restart_frame()
+{
+    m_frame_line = 0;
+    m_dot = 0;
+    m_line_deferred = false;
+}
+
+void PPU::flush_scanline()
+{
+    if (!m_line_deferred)
+        return;
+
+    m_line_deferred = false;
+    ++stats.dot_scanlines;
+
+    // run the dots deferred so far, the sprite evaluation of dot 1 was already done
+    render_tile(0);
+    begin_tile_fetch();
+    for (unsigned dot { 2 }; dot < m_dot; ++dot)
+    {
+        run_line_action<Render>(dot);
+    }
+}
+
+void PPU::set_output(void* pixels, PixelFormat format, size_t pitch)
+{
+    m_output = static_cast<uint8_t*>(pixels);
+    m_output_format = format;
+    m_output_pitch = pitch ? pitch : 256*bytes_per_pixel(format);
+    m_output_lut = make_output_lut(format, ppu_palette.data());
+}
+
+void PPU::run_dot()
+{
+    if (m_dot == 0)
+    {
+        // only when the frame was just restarted, otherwise the line is started as the previous one ends
+        start_line();
+        return;
+    }
+
+    if (m_line_deferred && m_dot < sprite_fetch_dot)
+    {
+        ++m_clocks;
+        ++m_dot;
+        return;
+    }
+
+    const ScanlineType type = line_type();
+    m_clocks += (type == Idle ? idle_dots : render_dots)[m_dot].clocks;
+    run_dot_action(m_dot);
+
+    if (m_dot != line_dots)
+    {
+        ++m_dot;
+        return;
+    }
+
+    end_scanline();
+    if (type == PreRender)
+    {
+        m_current_line = 0;
+    }
+    if (++m_frame_line == 262)
+    {
+        m_frame_line = 0;
+        m_odd_frame ^= 1;
+        ++frames;
+    }
+    start_line();
+}
+
+void PPU::start_line()
+{
+    switch (line_type())
+    {
+        case PreRender: begin_scanline<PreRender>(); break;
+        case Render:    begin_scanline<Render>();    break;
+        case Idle:      begin_scanline<Idle>();      break;
+    }
+
+    m_dot = 1;
+    if (m_skip_cycle)
+    {
+        // no idle cycle : the work of the first dot is done right away
+        run_dot_action(1);
+        m_dot = 2;
+    }
+}
+
+void PPU::run_dot_action(unsigned dot)
+{
+    switch (line_type())
+    {
+        case PreRender: run_line_action<PreRender>(dot); break;
+        case Render:    run_line_action<Render>(dot);    break;
+        case Idle:      run_line_action<Idle>(dot);      break;
+    }
+}
+
+template <PPU::ScanlineType Type>
+void PPU::run_line_action(unsigned dot)
+{
+    if constexpr (Type == Idle)
+    {
+        if (idle_dots[dot].action == VBlankLine)
+            begin_vblank_line();
+        return;
+    }
+    else
+    {
+        switch (render_dots[dot].action)
+        {
+            case SetupLine:
+                setup_scanline<Type>();
+                if constexpr (Type == Render)
+                {
+                    if (scanline_renderer)
+                    {
+                        // the visible dots are run by render_scanline() or flush_scanline()
+                        m_line_deferred = true;
+                        break;
+                    }
+                    ++stats.dot_scanlines;
+                    render_tile(0);
+                }
+                begin_tile_fetch();
+                break;
+            case NextTile:
+                end_tile_fetch(); reload_shifts();
+                if constexpr (Type == Render)
+                    render_tile((dot - 1) / 8);
+                begin_tile_fetch();
+                break;
+            case TileAttr:
+                fetch_tile_attr();
+                break;
+            case TileLow:
+                fetch_tile_low();
+                break;
+            case TileHigh:
+                fetch_tile_high();
+                break;
+            case SpriteFetches:
+                if constexpr (Type == Render)
+                {
+                    if (m_line_deferred)
+                        render_scanline();
+                }
+                end_tile_fetch(); reload_shifts();
+                end_visible_fetches();
+                begin_sprite_fetches();
+                fetch_sprite_nt(0);
+                break;
+            case NextSprite:
+                store_sprite((dot - 257) / 8 - 1);
+                fetch_sprite_nt((dot - 257) / 8);
+                break;
+            case SpriteAttr:
+                fetch_sprite_attr();
+                break;
+            case SpriteLow:
+                fetch_sprite_low();
+                break;
+            case SpriteHigh:
+                fetch_sprite_high();
+                break;
+            case PrefetchTiles:
+                store_sprite(7);
+                rasterize_sprites();
+                if constexpr (Type == PreRender)
+                {
+                    if (rendering_enabled()) reset_vertical_scroll();
+                }
+                begin_tile_fetch();
+                break;
+            case SecondTile:
+                end_tile_fetch(); reload_shifts();
+                shift_first_tile();
+                begin_tile_fetch();
+                break;
+            case UnusedFetches:
+                end_tile_fetch(); reload_shifts();
+                begin_unused_nt_fetches();
+                break;
+            case SkipCycle:
+                update_skip_cycle();
+                break;
+            case UnusedFetch:
+                end_unused_nt_fetches();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 void PPU::power_up()
 {
 
@@ -92,16 +431,7 @@ void PPU::reset()
 template <PPU::ScanlineType Type>
 void PPU::scanline()
 {
-    if constexpr (Type == PreRender)
-    {
-        m_status &= (~(Sprite0Hit)); // clear sprite 0 flag on first cycle (why ? no idea, but passes timing tests)
-        m_sprite0_hit_cycle = UINT_MAX;
-
-        m_status &= (~(SpriteOverflow)); // clear sprite 0 flag on first cycle (why ? no idea, but passes timing tests)
-        m_sprite_overflow_cycle = UINT_MAX;
-
-        //update_nmi_logic();
-    }
+    begin_scanline<Type>();
 
     if (!m_skip_cycle)
     {
@@ -110,14 +440,9 @@ void PPU::scanline()
 
     if constexpr (Type != Idle)
     {
-        if constexpr (Type == PreRender)
-        {
-            m_status &= (~(VerticalBlank)); // clear status flags
-            update_nmi_logic();
-        }
-
-        if (rendering_enabled())
-            sprite_evaluation();
+        setup_scanline<Type>();
+        if constexpr (Type == Render)
+            ++stats.dot_scanlines;
 
         for (size_t i { 0 }; i < 256 / 8; ++i)
         {
@@ -126,11 +451,7 @@ void PPU::scanline()
             fetch_next_tile(); reload_shifts();
         }
 
-        if (rendering_enabled())
-        {
-            y_increment(); // actually 1 cycle late, may cause problems ?
-            reset_horizontal_scroll();
-        }
+        end_visible_fetches();
         prefetch_sprites(); // prefetch next scanline's sprites
 
         if constexpr (Type == PreRender)
@@ -140,13 +461,7 @@ void PPU::scanline()
 
         // fetch next two tiles
         fetch_next_tile(); reload_shifts();
-        m_tile_bmp_lo <<= 8;
-        m_tile_bmp_hi <<= 8;
-        for (size_t i { 0 }; i < 8; ++i)
-        {
-            m_attr_shift_lo <<= 1; m_attr_shift_lo |= m_attr_latch_lo;
-            m_attr_shift_hi <<= 1; m_attr_shift_hi |= m_attr_latch_hi;
-        }
+        shift_first_tile();
         fetch_next_tile(); reload_shifts();
 
 
@@ -154,22 +469,67 @@ void PPU::scanline()
     }
     else
     {
-        if (m_current_line == 241)
-        {
-            if (!m_suppress_vbl)
-            {
-                set_vblank();
-            }
-            else
-            {
-                m_suppress_vbl = false;
-            }
-        }
+        begin_vblank_line();
         cycle(1);
         cycle(1); // explicit cycling so we can handle NMI suppression
         cycle_fast(338);
     }
 
+    end_scanline();
+}
+
+template <PPU::ScanlineType Type>
+void PPU::begin_scanline()
+{
+    if constexpr (Type == PreRender)
+    {
+        background_reuse = m_frame_fast_scanlines ? float(m_frame_reused_backgrounds) / m_frame_fast_scanlines : 0;
+        m_frame_reused_backgrounds = m_frame_fast_scanlines = 0;
+
+        m_skip_pixels = frameskip == skip_all_frames || (frameskip && frames % (frameskip + 1) != 0);
+        if (m_skip_pixels)
+            ++stats.skipped_frames;
+
+        m_status &= (~(Sprite0Hit)); // clear sprite 0 flag on first cycle (why ? no idea, but passes timing tests)
+        m_sprite0_hit_cycle = UINT_MAX;
+
+        m_status &= (~(SpriteOverflow)); // clear sprite 0 flag on first cycle (why ? no idea, but passes timing tests)
+        m_sprite_overflow_cycle = UINT_MAX;
+
+        //update_nmi_logic();
+    }
+}
+
+template <PPU::ScanlineType Type>
+void PPU::setup_scanline()
+{
+    if constexpr (Type == PreRender)
+    {
+        m_status &= (~(VerticalBlank)); // clear status flags
+        update_nmi_logic();
+    }
+
+    if (rendering_enabled())
+        sprite_evaluation();
+}
+
+void PPU::begin_vblank_line()
+{
+    if (m_current_line == 241)
+    {
+        if (!m_suppress_vbl)
+        {
+            set_vblank();
+        }
+        else
+        {
+            m_suppress_vbl = false;
+        }
+    }
+}
+
+void PPU::end_scanline()
+{
     ++m_current_line;
     m_clocks = 0;
 
@@ -177,119 +537,339 @@ void PPU::scanline()
     set_unread_flags();
 }
 
+void PPU::shift_first_tile()
+{
+    m_tile_bmp_lo <<= 8;
+    m_tile_bmp_hi <<= 8;
+    for (size_t i { 0 }; i < 8; ++i)
+    {
+        m_attr_shift_lo <<= 1; m_attr_shift_lo |= m_attr_latch_lo;
+        m_attr_shift_hi <<= 1; m_attr_shift_hi |= m_attr_latch_hi;
+    }
+}
+
+void PPU::end_visible_fetches()
+{
+    if (rendering_enabled())
+    {
+        y_increment(); // actually 1 cycle late, may cause problems ?
+        reset_horizontal_scroll();
+    }
+}
+
 void PPU::render_tile(unsigned tile_idx)
 {
-    const bool render_bg      = (m_mask & ShowBG ) && !(tile_idx == 0 && !(m_mask & ShowLeftmostBG ));
-    const bool render_sprites = (m_mask & ShowOAM) && !(tile_idx == 0 && !(m_mask & ShowLeftmostOAM));
+    // the pixels of this tile and of the next one, as in the pattern shift registers
+    const uint32_t bg_pixels = (CHRCache::planar_to_chunky(m_tile_bmp_lo >> 8, m_tile_bmp_hi >> 8) << 16) |
+            CHRCache::planar_to_chunky(m_tile_bmp_lo & 0xFF, m_tile_bmp_hi & 0xFF);
+
+    draw_tile(tile_idx, bg_pixels);
+}
 
+// Draws the visible part of a deferred line : same fetches as the dot renderer, in the same order, but without
+// going through each dot.
+void PPU::render_scanline()
+{
+    m_line_deferred = false;
+    ++stats.fast_scanlines;
+    ++m_frame_fast_scanlines;
 
-    for (size_t i { 0 }; i < 8; ++i)
+    if (reuse_background())
+        return;
+
+    background_line& line = m_background_lines[m_current_line];
+    line.inputs  = background_state();
+    line.fetched = m_nametable_clock;
+
+    // the pixels of the tile being drawn and of the next one, as in the pattern shift registers
+    uint32_t bg_pixels = (CHRCache::planar_to_chunky(m_tile_bmp_lo >> 8, m_tile_bmp_hi >> 8) << 16) |
+            CHRCache::planar_to_chunky(m_tile_bmp_lo & 0xFF, m_tile_bmp_hi & 0xFF);
+
+    line.tiles[0] = shift_background(0, bg_pixels);
+    draw_pixels(0, line.tiles[0]);
+    begin_tile_fetch();
+    for (unsigned tile { 1 }; tile < 32; ++tile)
+    {
+        fetch_tile_attr(); fetch_tile_low(); fetch_tile_high();
+        end_tile_fetch(); reload_shifts();
+        bg_pixels = (bg_pixels << 16) | chr_cache.pixels(m_tile_pattern_addr);
+        line.tiles[tile] = shift_background(tile, bg_pixels);
+        draw_pixels(tile, line.tiles[tile]);
+        begin_tile_fetch();
+    }
+    fetch_tile_attr(); fetch_tile_low(); fetch_tile_high();
+
+    line.outputs = background_result();
+    line.valid = true;
+}
+
+// If the line's fetches would read the same data, from the same registers, as when its background was last
+// fetched, the line is drawn over that background and the registers are left as the fetches would
+bool PPU::reuse_background()
+{
+    const background_line& line = m_background_lines[m_current_line];
+    if (!reuse_backgrounds || !line.valid || !(line.inputs == background_state()))
+        return false;
+
+    // the row of tiles and the row of attributes read in the nametable the line starts in and in the next one
+    const unsigned nametable = (m_v >> 10) & 0b11;
+    const unsigned coarse_y  = (m_v & CoarseY) >> 5;
+    for (unsigned nt : {nametable, nametable ^ 0b01})
+    {
+        if (!m_nametable_sources[nt] || m_nametable_rows[nt][coarse_y] > line.fetched ||
+                m_nametable_rows[nt][30 + coarse_y/16] > line.fetched)
+            return false;
+    }
+
+    for (unsigned tile { 0 }; tile < 32; ++tile)
     {
-        unsigned x_pos = tile_idx*8 + i;
+        draw_pixels(tile, line.tiles[tile]);
+    }
+
+    const background_outputs& out = line.outputs;
+    m_v = out.v;
+    m_tile_fetch_v = out.tile_fetch_v;
+    m_tile_pattern_addr = out.tile_pattern_addr;
+    m_tile_attr = out.tile_attr;
+    m_prefetched_bg_lo = out.prefetched_bg_lo;
+    m_prefetched_bg_hi = out.prefetched_bg_hi;
+    m_prefetched_at_lo = out.prefetched_at_lo;
+    m_prefetched_at_hi = out.prefetched_at_hi;
+    m_tile_bmp_lo = out.tile_bmp_lo;
+    m_tile_bmp_hi = out.tile_bmp_hi;
+    m_attr_shift_lo = out.attr_shift_lo;
+    m_attr_shift_hi = out.attr_shift_hi;
+    m_attr_latch_lo = out.attr_latch_lo;
+    m_attr_latch_hi = out.attr_latch_hi;
+    addr_space.latch(m_prefetched_bg_hi); // the last fetch
+
+    ++stats.reused_backgrounds;
+    ++m_frame_reused_backgrounds;
+    return true;
+}
 
-        uint8_t bg_pattern = 0;
-        uint8_t bg_palette = 0;
+PPU::background_inputs PPU::background_state() const
+{
+    return { m_v, m_tile_bmp_lo, m_tile_bmp_hi, m_x, uint8_t(m_ctrl & BackGrTableAddr), uint8_t(m_mask & (ShowBG | ShowOAM | ShowLeftmostBG)),
+             m_attr_shift_lo, m_attr_shift_hi, m_attr_latch_lo, m_attr_latch_hi, chr_cache.changes() };
+}
 
-        if (render_bg)
+PPU::background_outputs PPU::background_result() const
+{
+    return { m_v, m_tile_fetch_v, m_tile_pattern_addr, m_tile_bmp_lo, m_tile_bmp_hi,
+             m_tile_attr, m_prefetched_bg_lo, m_prefetched_bg_hi, m_prefetched_at_lo, m_prefetched_at_hi,
+             m_attr_shift_lo, m_attr_shift_hi, m_attr_latch_lo, m_attr_latch_hi };
+}
+
+void PPU::remap()
+{
+    chr_cache.remap();
+
+    for (unsigned nt { 0 }; nt < 4; ++nt)
+    {
+        const uint8_t* source = addr_space.direct_page(0x2000 + nt*0x400);
+        if (source != m_nametable_sources[nt] || !source)
         {
-            bg_pattern = (((m_tile_bmp_hi >> (15-m_x))&0b1) << 1) |
-                    ((m_tile_bmp_lo >> (15-m_x))&0b1);
-            bg_palette = (((m_attr_shift_hi >> (7-m_x))&0b1) << 1) |
-                    ((m_attr_shift_lo >> (7-m_x))&0b1);
+            m_nametable_sources[nt] = source;
+            m_nametable_rows[nt].fill(++m_nametable_clock);
         }
+    }
+}
 
-        uint8_t sprite_pattern = 0;
-        uint8_t sprite_palette = 0;
+void PPU::nametable_write(uint16_t addr)
+{
+    nametable_write(addr_space.direct_page(addr), addr & 0x3FF);
+}
 
-        prefetched_sprite sprite;
-        if (render_sprites)
-        {
-            for (size_t j { 0 }; j<8;++j)
-            {
-                auto temp_sprite = m_prefetched_sprites[j];
+void PPU::nametable_write(const uint8_t* written, unsigned offset)
+{
+    ++m_nametable_clock;
+    for (unsigned nt { 0 }; nt < 4; ++nt)
+    {
+        // the nametables mirrored onto the same memory change too
+        if (!written || addr_space.direct_page(0x2000 + nt*0x400 + offset) == written)
+            m_nametable_rows[nt][offset / 32] = m_nametable_clock;
+    }
+}
 
-                if (temp_sprite.attributes == 0xFF) continue; // invalid
-                if (x_pos < temp_sprite.x_pos || x_pos >= (unsigned)(temp_sprite.x_pos) + 8) continue;
-                sprite = temp_sprite;
+void PPU::serialize(StateStream& stream)
+{
+    stream.io(m_v); stream.io(m_t); stream.io(m_x);
+    stream.io(m_delayed_vram_addr);
+    stream.io(m_oam_addr);
+    stream.io(m_suppress_vbl);
+    stream.io(m_skip_cycle);
+    stream.io(m_sprite0_hit_cycle);
+    stream.io(m_sprite_overflow_cycle);
+    stream.io(m_delayed_vram_cycle);
+
+    stream.io(m_tile_bmp_lo); stream.io(m_tile_bmp_hi);
+    stream.io(m_attr_shift_lo); stream.io(m_attr_shift_hi);
+    stream.io(m_attr_latch_lo); stream.io(m_attr_latch_hi);
+    stream.io(m_prefetched_at_lo); stream.io(m_prefetched_at_hi);
+    stream.io(m_prefetched_bg_lo); stream.io(m_prefetched_bg_hi);
+
+    stream.io(m_odd_frame);
+    stream.io(m_status); stream.io(m_ctrl); stream.io(m_mask);
+    stream.io(m_current_line);
+    stream.io(m_clocks);
+    stream.io(m_oam_memory);
+    stream.io(m_secondary_oam);
+    stream.io(m_prefetched_sprites);
+    stream.io(m_sprite_line);
+    stream.io(m_sprite_line_empty);
+    stream.io(m_palette_copy);
+
+    stream.io(m_tile_fetch_v); stream.io(m_tile_pattern_addr); stream.io(m_tile_attr);
+    stream.io(m_sprite_nt_addr); stream.io(m_sprite_attr_addr); stream.io(m_sprite_pattern_addr);
+    stream.io(m_sprite_pattern_lo); stream.io(m_sprite_pattern_hi);
+    stream.io(m_unused_nt_addr);
+
+    stream.io(m_frame_line); stream.io(m_dot);
+    stream.io(frames);
+    stream.io(m_skip_pixels);
+
+    if (stream.loading())
+    {
+        m_line_deferred = false;
+        m_sprite_bins_dirty = true;
+        // the backgrounds of previous frames stay reusable : the console marks the nametable rows and the pattern
+        // tables the state changed, see Console::serialize()
+    }
+}
 
-                unsigned sprite_x = x_pos - sprite.x_pos;
+// Lays out the sprites fetched for the next line, the first opaque sprite pixel winning
+void PPU::rasterize_sprites()
+{
+    if (!m_sprite_line_empty)
+    {
+        m_sprite_line.fill(0);
+        m_sprite_line_empty = true;
+    }
 
-                if (sprite.attributes & HorizontalFlip)
-                    sprite_x ^= 7;
+    // only sprite 0 is needed on skipped frames, for its hits : it is always the first one of its line
+    const size_t sprites = m_skip_pixels ? 1 : m_prefetched_sprites.size();
+    for (size_t idx { 0 }; idx < sprites; ++idx)
+    {
+        const auto& sprite = m_prefetched_sprites[idx];
+        if (sprite.attributes == 0xFF || sprite.pixels == 0) continue; // invalid or transparent
+        if (m_skip_pixels && !(sprite.attributes & Sprite0)) continue;
 
-                uint8_t pattern = (((sprite.pattern_high >> (7-sprite_x))&0b1) << 1) |
-                        ((sprite.pattern_low  >> (7-sprite_x))&0b1     );
-                if (pattern == 0) continue;
+        for (unsigned i { 0 }; i < 8 && sprite.x_pos + i < 256; ++i)
+        {
+            const unsigned sprite_x = (sprite.attributes & HorizontalFlip) ? i ^ 7 : i;
 
-                sprite_pattern = pattern;
-                sprite_palette = sprite.attributes & 0b11;
+            const uint8_t pattern = (sprite.pixels >> (14 - sprite_x*2)) & 0b11;
+            if (pattern == 0 || m_sprite_line[sprite.x_pos + i]) continue;
 
-                // test sprite 0 hit
-                if ((sprite.attributes&Sprite0) && bg_pattern && x_pos != 255)
-                {
-                    if (m_sprite0_hit_cycle == UINT_MAX)
-                    {
-                        m_sprite0_hit_cycle = x_pos+1;
-                    }
-                }
-                break;
-            }
+            m_sprite_line[sprite.x_pos + i] = sprite_pixel(sprite, pattern);
         }
+        m_sprite_line_empty = false;
+    }
+}
+
+// bg_pixels holds the background pixels of this tile and of the next one
+void PPU::draw_tile(unsigned tile_idx, uint32_t bg_pixels)
+{
+    draw_pixels(tile_idx, shift_background(tile_idx, bg_pixels));
+}
+
+// The background of the tile, bg_pattern of pixel_span in the high half and bg_palette in the low one,
+// the shift registers moving on to the next tile
+uint32_t PPU::shift_background(unsigned tile_idx, uint32_t bg_pixels)
+{
+    const bool render_bg = (m_mask & ShowBG) && !(tile_idx == 0 && !(m_mask & ShowLeftmostBG));
+
+    uint32_t background = 0;
+    if (render_bg)
+    {
+        // the attribute shift registers followed by the bits shifted in from the latches over the tile
+        const uint16_t attr_lo = (m_attr_shift_lo << 8) | (m_attr_latch_lo ? 0xFF : 0);
+        const uint16_t attr_hi = (m_attr_shift_hi << 8) | (m_attr_latch_hi ? 0xFF : 0);
 
-        uint8_t output_color = 0;
-        if (bg_pattern == 0)
+        const unsigned shift = 8 - m_x;
+        const uint16_t pattern = bg_pixels >> (shift*2);
+        background = pattern << 16 | CHRCache::planar_to_chunky(attr_lo >> shift, attr_hi >> shift);
+    }
+
+    m_tile_bmp_lo <<= 8;
+    m_tile_bmp_hi <<= 8;
+    m_attr_shift_lo = m_attr_latch_lo ? 0xFF : 0;
+    m_attr_shift_hi = m_attr_latch_hi ? 0xFF : 0;
+
+    return background;
+}
+
+void PPU::draw_pixels(unsigned tile_idx, uint32_t background)
+{
+    static constexpr std::array<uint8_t, 8> no_sprites {};
+
+    const bool render_sprites = (m_mask & ShowOAM) && !(tile_idx == 0 && !(m_mask & ShowLeftmostOAM)) && !m_sprite_line_empty;
+
+    const pixel_span span { uint16_t(background >> 16), uint16_t(background),
+                            render_sprites ? &m_sprite_line[tile_idx*8] : no_sprites.data() };
+    const compose_fn compose = (simd_compose && compose_pixels_simd) ? compose_pixels_simd : compose_pixels_scalar;
+    const uint8_t grey_mask = (m_mask & Greyscale) ? 0x30 : 0xFF; // only use colors from the grey column of the NES palette
+    uint8_t hits = 0;
+    if (!m_skip_pixels)
+    {
+        uint8_t* const pixels = &framebuffer[tile_idx*8 + m_current_line*256];
+        hits = compose(span, m_palette_copy.data(), grey_mask, pixels);
+        if (m_output)
         {
-            if (sprite_pattern == 0)
-            {
-                output_color = m_palette_copy[0x00];
-            }
-            else
-            {
-                output_color = m_palette_copy[0x10 | sprite_palette*4 | sprite_pattern];
-            }
+            const uint32_t* colors = &m_output_lut[(m_mask >> 5) << 6]; // emphasis bits
+            convert_pixels(m_output_format, colors, pixels, 8,
+                           m_output + m_current_line*m_output_pitch + tile_idx*8*bytes_per_pixel(m_output_format));
         }
-        else
-        {
-            if (sprite_pattern && !(sprite.attributes & BehindBG))
-            {
-                output_color = m_palette_copy[0x10 | sprite_palette*4 | sprite_pattern];
-            }
-            else
-            {
-                output_color = m_palette_copy[0x00 | bg_palette*4 | bg_pattern];
-            }
-        }
-
-        if (m_mask & Greyscale)
+    }
+    else if (m_sprite0_hit_cycle == UINT_MAX)
+    {
+        // only the sprite 0 hits are needed : the tile is composed aside when sprite 0 is in it
+        uint64_t sprite_pixels;
+        std::memcpy(&sprite_pixels, span.sprites, sizeof(sprite_pixels));
+        if (sprite_pixels & (0x0101010101010101ull * SpriteZero))
         {
-            output_color &= 0x30; // only use colors from the grey column of the NES palette
+            std::array<uint8_t, 8> discarded;
+            hits = compose(span, m_palette_copy.data(), grey_mask, discarded.data());
         }
+    }
 
-        framebuffer[x_pos + m_current_line*256] = output_color;
-        // TODO : emphasis bits
-
-        m_tile_bmp_lo <<= 1;
-        m_tile_bmp_hi <<= 1;
-        m_attr_shift_lo <<= 1; m_attr_shift_lo |= m_attr_latch_lo;
-        m_attr_shift_hi <<= 1; m_attr_shift_hi |= m_attr_latch_hi;
+    if (hits && m_sprite0_hit_cycle == UINT_MAX)
+    {
+        const unsigned x_pos = tile_idx*8 + __builtin_ctz(hits);
+        if (x_pos != 255)
+            m_sprite0_hit_cycle = x_pos+1;
     }
 }
 
 void PPU::do_unused_nt_fetches()
+{
+    begin_unused_nt_fetches(); cycle(1); // dummy NT read
+    update_skip_cycle();
+    cycle(1);
+    end_unused_nt_fetches(); cycle(2); // dummy NT read
+}
+
+void PPU::begin_unused_nt_fetches()
 {
     const uint16_t v = vram_addr();
 
-    uint16_t nt_addr = 0x2000 | (v & ~FineYScroll);
+    m_unused_nt_addr = 0x2000 | (v & ~FineYScroll);
 
-    ppu_read(nt_addr); cycle(1); // dummy NT read
+    ppu_read(m_unused_nt_addr);
+}
 
+void PPU::update_skip_cycle()
+{
     if (m_current_line == 261 && m_odd_frame && rendering_enabled())
         m_skip_cycle = true;
     else
         m_skip_cycle = false;
+}
 
-    cycle(1);
-    ppu_read(nt_addr); cycle(2); // dummy NT read
+void PPU::end_unused_nt_fetches()
+{
+    ppu_read(m_unused_nt_addr);
 }
 
 void PPU::reload_shifts()
@@ -325,31 +905,61 @@ void PPU::update_nmi_logic()
 
 void PPU::sprite_evaluation()
 {
+    // OAM usually only changes once per frame (OAM DMA), so the lines each sprite covers are worked out for the whole frame
+    if (m_sprite_bins_dirty || m_binned_sprite_height != sprite_height())
+        bin_sprites();
+
     std::fill(m_secondary_oam.begin(), m_secondary_oam.end(), sprite_data{0xFF, 0xFF, 0xFF, 0xFF});
     // can actually be done in an cycle-inaccurate way
     // only sprite tile fetches on pre-render line
-    size_t found_sprites = 0;
-    size_t i { 0 };
-    for (; i < 64; ++i)
+    const sprite_bin& bin = m_sprite_bins[m_current_line];
+    for (size_t found_sprites { 0 }; found_sprites < bin.count; ++found_sprites)
     {
-        if (found_sprites == 8)
+        const uint8_t i = bin.sprites[found_sprites];
+        m_secondary_oam[found_sprites] = m_oam_memory[i];
+        if (i == 0) // mark as sprite 0
         {
-            do_buggy_overflow_evaluation(i);
-            return;
+            m_secondary_oam[found_sprites].attributes |= Sprite0;
         }
+        else
+            m_secondary_oam[found_sprites].attributes &= ~Sprite0;
+    }
+
+    if (bin.overflow_from < 64)
+        do_buggy_overflow_evaluation(bin.overflow_from);
+}
+
+void PPU::bin_sprites()
+{
+    for (auto& bin : m_sprite_bins)
+    {
+        bin.count = 0;
+        bin.overflow_from = 64;
+    }
+
+    const unsigned height = sprite_height();
+    for (uint8_t i { 0 }; i < 64; ++i)
+    {
+        const unsigned y_pos = m_oam_memory[i].y_pos;
+        if (y_pos == 255)
+            continue;
 
-        if (sprite_in_range(m_oam_memory[i].y_pos))
+        // same as sprite_in_range()
+        const unsigned end = std::min<unsigned>(y_pos + height, m_sprite_bins.size());
+        for (unsigned line { y_pos }; line < end; ++line)
         {
-            m_secondary_oam[found_sprites] = m_oam_memory[i];
-            if (i == 0) // mark as sprite 0
-            {
-                m_secondary_oam[found_sprites].attributes |= Sprite0;
-            }
-            else
-                m_secondary_oam[found_sprites].attributes &= ~Sprite0;
-            ++found_sprites;
+            sprite_bin& bin = m_sprite_bins[line];
+            if (bin.count == 8)
+                continue;
+
+            bin.sprites[bin.count++] = i;
+            if (bin.count == 8)
+                bin.overflow_from = i + 1;
         }
     }
+
+    m_binned_sprite_height = height;
+    m_sprite_bins_dirty = false;
 }
 
 void PPU::do_buggy_overflow_evaluation(uint8_t starting_sprite)
@@ -377,74 +987,129 @@ void PPU::do_buggy_overflow_evaluation(uint8_t starting_sprite)
 }
 
 void PPU::prefetch_sprites()
+{
+    begin_sprite_fetches();
+
+    for (size_t i { 0 }; i < 8; ++i)
+    {
+        fetch_sprite_nt(i); cycle(2); // dummy NT read
+        fetch_sprite_attr(); cycle(2); // dummy AT read
+        fetch_sprite_low(); cycle(2);
+        fetch_sprite_high(); cycle(2);
+
+        store_sprite(i);
+    }
+    rasterize_sprites();
+}
+
+void PPU::begin_sprite_fetches()
 {
     uint16_t v = vram_addr();
 
-    uint16_t nt_addr = 0x2000 | (v & ~FineYScroll);
+    m_sprite_nt_addr = 0x2000 | (v & ~FineYScroll);
     // coarse scrolling registers are divided by 4 because attribute tables indexes 4x4 tile blocks
-    /*               */ /*base*/ /* nametable */  /*  coarse y / 4 */   /*  coarse x / 4 */
-    uint16_t attr_addr = 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07);
+    /*                      */ /*base*/ /* nametable */  /*  coarse y / 4 */   /*  coarse x / 4 */
+    m_sprite_attr_addr = 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07);
+}
 
-    for (size_t i { 0 }; i < 8; ++i)
-    {
-        auto data = m_secondary_oam[i];
-        uint16_t addr;
-        // 8x16 sprites have a different addressing mode
-        if (sprite_height() == 16)
-            addr = ((data.tile_index & 0b1) * 0x1000) + ((data.tile_index & ~0b1) * 0x10);
-        else
-            addr = ((m_ctrl&SpriteTableAddr) ? 0x1000 : 0x0000) + (data.tile_index * 0x10);
+void PPU::fetch_sprite_nt(unsigned idx)
+{
+    auto data = m_secondary_oam[idx];
+    uint16_t addr;
+    // 8x16 sprites have a different addressing mode
+    if (sprite_height() == 16)
+        addr = ((data.tile_index & 0b1) * 0x1000) + ((data.tile_index & ~0b1) * 0x10);
+    else
+        addr = ((m_ctrl&SpriteTableAddr) ? 0x1000 : 0x0000) + (data.tile_index * 0x10);
 
-        uint8_t sprY = m_current_line - data.y_pos;  // Line inside the sprite.
-        if (data.attributes & VerticalFlip) sprY ^= sprite_height() - 1;      // Vertical flip.
-        addr += sprY + (sprY & 8);  // Select the second tile if on 8x16.
+    uint8_t sprY = m_current_line - data.y_pos;  // Line inside the sprite.
+    if (data.attributes & VerticalFlip) sprY ^= sprite_height() - 1;      // Vertical flip.
+    addr += sprY + (sprY & 8);  // Select the second tile if on 8x16.
+    m_sprite_pattern_addr = addr;
 
-        /*       dummy      */ ppu_read(nt_addr  ); cycle(2); // dummy NT read
-        /*       dummy      */ ppu_read(attr_addr); cycle(2); // dummy AY read
-        uint8_t pattern_low  = ppu_read(addr + 0 ); cycle(2);
-        uint8_t pattern_high = ppu_read(addr + 8 ); cycle(2);
+    ppu_read(m_sprite_nt_addr);
+}
 
-        if (data.y_pos >= 0xEF)
-        {
-            m_prefetched_sprites[i].attributes = 0xFF; // mark as invalid
-        }
-        else
-        {
-            m_prefetched_sprites[i].attributes = data.attributes;
-            m_prefetched_sprites[i].x_pos = data.x_pos;
+void PPU::fetch_sprite_attr()
+{
+    ppu_read(m_sprite_attr_addr);
+}
 
-            m_prefetched_sprites[i].pattern_low  = pattern_low;
-            m_prefetched_sprites[i].pattern_high = pattern_high;
-        }
+void PPU::fetch_sprite_low()
+{
+    m_sprite_pattern_lo = chr_cache.read_low(m_sprite_pattern_addr);
+}
+
+void PPU::fetch_sprite_high()
+{
+    m_sprite_pattern_hi = chr_cache.read_high(m_sprite_pattern_addr);
+}
+
+void PPU::store_sprite(unsigned idx)
+{
+    auto data = m_secondary_oam[idx];
+    if (data.y_pos >= 0xEF)
+    {
+        m_prefetched_sprites[idx].attributes = 0xFF; // mark as invalid
+    }
+    else
+    {
+        m_prefetched_sprites[idx].attributes = data.attributes;
+        m_prefetched_sprites[idx].x_pos = data.x_pos;
+
+        m_prefetched_sprites[idx].pattern_low  = m_sprite_pattern_lo;
+        m_prefetched_sprites[idx].pattern_high = m_sprite_pattern_hi;
+        m_prefetched_sprites[idx].pixels = CHRCache::planar_to_chunky(m_sprite_pattern_lo, m_sprite_pattern_hi);
     }
 }
 
 void PPU::fetch_next_tile()
 {
-    constexpr uint16_t bg_base[2] = {0x0000, 0x1000};
-    uint16_t v = vram_addr();
+    begin_tile_fetch(); cycle(2);
+    fetch_tile_attr(); cycle(1);
+    fetch_tile_low(); cycle(2);
+    fetch_tile_high(); cycle(3);
+    end_tile_fetch();
+}
 
-    int coarse_x = v & CoarseX;
-    int coarse_y = (v & CoarseY) >> 5;
+void PPU::begin_tile_fetch()
+{
+    constexpr uint16_t bg_base[2] = {0x0000, 0x1000};
+    const uint16_t v = vram_addr();
+    m_tile_fetch_v = v;
 
     uint16_t nt_addr = 0x2000 | (v & ~FineYScroll);
 
-
     uint8_t nt_byte   = ppu_read(nt_addr  );
-    uint16_t pattern_addr = nt_byte*0x10 + bg_base[(m_ctrl>>4)&0b1] + ((v & FineYScroll) >> 12);
-    cycle(2);
+    m_tile_pattern_addr = nt_byte*0x10 + bg_base[(m_ctrl>>4)&0b1] + ((v & FineYScroll) >> 12);
+}
 
-    v = vram_addr();
+void PPU::fetch_tile_attr()
+{
+    const uint16_t v = vram_addr();
     // coarse scrolling registers are divided by 4 because attribute tables indexes 4x4 tile blocks
     /*               */ /*base*/ /* nametable */  /*  coarse  y/4  */   /*  coarse  x/4  */
     uint16_t attr_addr = 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07);
 
+    m_tile_attr = ppu_read(attr_addr);
+}
 
-    uint8_t attr_byte = ppu_read(attr_addr); cycle(1);
+void PPU::fetch_tile_low()
+{
+    m_prefetched_bg_lo = chr_cache.read_low(m_tile_pattern_addr);
+}
 
-    m_prefetched_bg_lo = ppu_read(pattern_addr  ); cycle(2);
-    m_prefetched_bg_hi = ppu_read(pattern_addr+8); cycle(3);
+void PPU::fetch_tile_high()
+{
+    m_prefetched_bg_hi = chr_cache.read_high(m_tile_pattern_addr);
+}
 
+void PPU::end_tile_fetch()
+{
+    int coarse_x = m_tile_fetch_v & CoarseX;
+    int coarse_y = (m_tile_fetch_v & CoarseY) >> 5;
+
+    uint8_t attr_byte = m_tile_attr;
     if (coarse_y & 0b10)
         attr_byte >>= 4;
     if (coarse_x & 0b10)
@@ -457,9 +1122,6 @@ void PPU::fetch_next_tile()
     {
         coarse_x_increment();
     }
-
-    //    if (nt_byte == 0x3A)
-    //        printf("tile 0x3A, pattern 0x%x/0x%x, scanline %d\n", m_prefetched_bg_lo, m_prefetched_bg_hi, m_current_line);
 }
 
 void PPU::oam_dma(const std::array<uint8_t, 256> &data)
@@ -65,13 +65,22 @@ void PPUCtrlRegs::reset()
     m_read_buffer = 0;
 }
 
+void PPUCtrlRegs::serialize(StateStream& stream)
+{
+    stream.io(m_decay);
+    stream.io(m_w);
+    stream.io(m_read_buffer);
+}
+
 data PPUCtrlRegs::read(address ptr)
 {
+    m_ppu.flush_scanline();
     return (this->*m_read_clbks[ptr % 8])();
 }
 
 void PPUCtrlRegs::write(address ptr, data value)
 {
+    m_ppu.flush_scanline();
     m_decay = value;
 
     (this->*m_write_clbks[ptr % 8])(value);
@@ -208,6 +217,14 @@ void PPUCtrlRegs::data_write(uint8_t val)
     }
 
     m_ppu.addr_space.write(address, val);
+    if (address < 0x2000)
+    {
+        m_ppu.chr_cache.write(address);
+    }
+    else if (address < 0x3F00)
+    {
+        m_ppu.nametable_write(address);
+    }
 
     if (m_ppu.m_ctrl & PPU::VRAMIncrement32)
     {
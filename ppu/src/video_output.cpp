@@ -0,0 +1,68 @@
+/*
+video_output.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "video_output.hpp"
+
+output_lut make_output_lut(PixelFormat format, const uint32_t* rgba_palette)
+{
+    // an emphasized channel keeps its level while the other two are dimmed
+    constexpr unsigned dimmed = 190; // /256, about the attenuation measured on NTSC consoles
+
+    output_lut lut {};
+    for (unsigned emphasis { 0 }; emphasis < 8; ++emphasis)
+    {
+        for (unsigned index { 0 }; index < 0x40; ++index)
+        {
+            uint8_t rgb[3];
+            std::memcpy(rgb, &rgba_palette[index], 3);
+            for (unsigned channel { 0 }; channel < 3; ++channel)
+            {
+                const bool dim = (emphasis & ~(1u << channel)) != 0; // another channel is emphasized
+                if (dim)
+                    rgb[channel] = rgb[channel] * dimmed / 256;
+            }
+
+            const uint8_t r = rgb[0], g = rgb[1], b = rgb[2];
+            uint32_t& color = lut[emphasis << 6 | index];
+            switch (format)
+            {
+                case PixelFormat::Indexed:
+                    color = index;
+                    break;
+                case PixelFormat::RGBA8888:
+                    color = 0xFF000000 | b << 16 | g << 8 | r;
+                    break;
+                case PixelFormat::BGRA8888:
+                    color = 0xFF000000 | r << 16 | g << 8 | b;
+                    break;
+                case PixelFormat::RGB565:
+                    color = (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3);
+                    break;
+            }
+        }
+    }
+
+    return lut;
+}
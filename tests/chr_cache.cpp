@@ -0,0 +1,94 @@
+/*
+chr_cache.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "gtest/gtest.h"
+
+#include "memory/include/memory.hpp"
+#include "ppu/include/chr_cache.hpp"
+
+namespace
+{
+
+TEST(CHRCache, PlanarToChunky)
+{
+    EXPECT_EQ(CHRCache::planar_to_chunky(0x00, 0x00), 0x0000);
+    EXPECT_EQ(CHRCache::planar_to_chunky(0x80, 0x00), 0x4000); // leftmost pixel, color 1
+    EXPECT_EQ(CHRCache::planar_to_chunky(0x00, 0x01), 0x0002); // rightmost pixel, color 2
+    EXPECT_EQ(CHRCache::planar_to_chunky(0xFF, 0xFF), 0xFFFF);
+}
+
+TEST(CHRCache, MatchesAddressSpace)
+{
+    std::vector<uint8_t> chr(0x4000);
+    for (size_t i { 0 }; i < chr.size(); ++i)
+        chr[i] = (i * 7 + (i >> 8)) & 0xFF;
+
+    RAMBankWindow<0x1000> low, high;
+    low.set_rom_base(chr.data(), chr.size());
+    high.set_rom_base(chr.data(), chr.size());
+    low.set_bank(0); high.set_bank(1);
+
+    AddressSpace space;
+    space.add_port(memory_port{&low , 0x0000});
+    space.add_port(memory_port{&high, 0x1000});
+
+    CHRCache cache { space };
+    cache.remap();
+
+    auto check = [&]
+    {
+        for (uint16_t tile { 0 }; tile < 0x200; ++tile)
+        {
+            for (uint16_t y { 0 }; y < 8; ++y)
+            {
+                const uint16_t addr = tile*16 + y;
+                ASSERT_EQ(cache.read_low (addr), space.read(addr)) << addr;
+                ASSERT_EQ(cache.read_high(addr), space.read(addr + 8)) << addr;
+                ASSERT_EQ(cache.pixels(addr), CHRCache::planar_to_chunky(space.read(addr), space.read(addr + 8))) << addr;
+            }
+        }
+    };
+    check();
+
+    // bank switch
+    low.set_bank(3);
+    cache.remap();
+    check();
+
+    // both windows on the same bank : a write through one of them is seen through the other
+    high.set_bank(3);
+    cache.remap();
+    check();
+    space.write(0x0123, 0x5A);
+    cache.write(0x0123);
+    EXPECT_EQ(cache.read_low(0x1123), 0x5A);
+    check();
+
+    // unaligned or out of the pattern tables : read through the address space
+    EXPECT_EQ(cache.read_low(0x0008), space.read(0x0008));
+    EXPECT_EQ(cache.read_high(0x0008), space.read(0x0010));
+}
+
+}
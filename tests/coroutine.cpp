@@ -0,0 +1,99 @@
+/*
+coroutine.cpp
+
+Copyright (c) 23 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <vector>
+
+#include "common/coroutine.hpp"
+
+namespace
+{
+
+struct co_counts
+{
+    unsigned starts { 0 };
+    unsigned steps { 0 };
+};
+
+// counts its steps on its own stack, which must survive the switches
+void count_steps()
+{
+    auto& counts = *static_cast<co_counts*>(get_co_arg());
+    ++counts.starts;
+    volatile unsigned steps = 0;
+    while (true)
+    {
+        counts.steps = ++steps;
+        co_yield();
+    }
+}
+
+TEST(Coroutine, Restart)
+{
+    coroutines_init();
+
+    // a single coroutine on a private stack, then two sharing one
+    for (size_t count : {1u, 2u})
+    {
+        coroutine_group group = make_co_group();
+        std::array<co_counts, 2> counts {};
+        std::vector<coroutine> cos;
+        for (size_t i { 0 }; i < count; ++i)
+            cos.push_back(make_co(group, count_steps, &counts[i]));
+
+        std::array<co_counts, 2> expected {};
+        const auto run_all = [&]
+        {
+            for (size_t i { 0 }; i < count; ++i)
+            {
+                run_co(cos[i]);
+                expected[i].starts += expected[i].steps == 0;
+                ++expected[i].steps;
+                ASSERT_EQ(counts[i].starts, expected[i].starts) << count << " coroutines, #" << i;
+                ASSERT_EQ(counts[i].steps, expected[i].steps) << count << " coroutines, #" << i;
+            }
+        };
+        for (unsigned round { 0 }; round < 3; ++round)
+            run_all();
+
+        // the last one resumed owns the stack, the others had theirs copied out : both start over from their function,
+        // the others resuming where they were
+        for (size_t restarted : {count - 1, size_t(0)})
+        {
+            restart_co(cos[restarted]);
+            expected[restarted].steps = 0;
+            for (unsigned round { 0 }; round < 3; ++round)
+                run_all();
+        }
+
+        for (auto& co : cos)
+            destroy_co(co);
+        destroy_co_group(group);
+    }
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+flat_bus.hpp
+
+Copyright (c) 07 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef FLAT_BUS_HPP
+#define FLAT_BUS_HPP
+
+#include <array>
+#include <cstdio>
+
+#include "cpu.hpp"
+
+// A flat 64KB memory accessed directly by the cpu, without going through callbacks
+struct flat_bus
+{
+    static constexpr cpu_type flavor = NES6502;
+    static constexpr cpu_dispatch dispatch = SwitchDispatch;
+
+    std::array<uint8_t, 0x10000>& mem;
+    bool rom { false }; // $8000-$FFFF isn't written to : the code there can be decoded
+
+    uint8_t read(uint16_t addr)
+    { return mem[addr]; }
+    void    write(uint16_t addr, uint8_t val)
+    { mem[addr] = val; }
+
+    void cycle()
+    { }
+    void idle_loop(unsigned)
+    { }
+    void instruction_boundary()
+    { }
+    void log(const char* str)
+    { fprintf(stderr, "%s", str); }
+
+    const uint8_t* code_page(uint16_t addr)
+    { return rom && addr >= 0x8000 ? &mem[addr] : nullptr; }
+    void latch(uint8_t)
+    { }
+    unsigned quiet_cycles() const
+    { return ~0u; }
+    const uint8_t* read_page(uint16_t addr)
+    { return &mem[addr & 0xFF00]; }
+    uint8_t* write_page(uint16_t addr)
+    { return !rom || addr < 0x8000 ? &mem[addr & 0xFF00] : nullptr; }
+};
+
+#endif // FLAT_BUS_HPP
@@ -28,8 +28,10 @@ SOFTWARE.
 #include <cstdio>
 
 #include "cpu.hpp"
+#include "cpu_impl.hpp"
 
 #include "detail/rom_loader.hpp"
+#include "detail/flat_bus.hpp"
 #include "nesloader.hpp"
 #include "common/parallel_stepper.hpp"
 
@@ -38,12 +40,12 @@ namespace
 
 static std::array<uint8_t, 0x10000> mem;
 
-static uint8_t cpu6502_read(uint16_t addr)
+static uint8_t cpu6502_read(void*, uint16_t addr)
 {
     return mem[addr];
 }
 
-static void cpu6502_write(uint16_t addr, uint8_t val)
+static void cpu6502_write(void*, uint16_t addr, uint8_t val)
 {
     mem[addr] = val;
 }
@@ -118,8 +120,12 @@ TEST(Cpu, NesTestRomTest)
 }
 
 static cpu6502 cpu(cpu6502_read, cpu6502_write, log);
+static basic_cpu6502<flat_bus> flat_bus_cpu(mem);
+static basic_cpu6502<flat_bus> decoding_cpu(mem, true);
+static basic_cpu6502<flat_bus> compiling_cpu(mem, true);
 
-TEST(Cpu, BlarggInstrTest)
+template <class Cpu>
+void blargg_instr_test(Cpu& cpu)
 {
     for (int i { 1 }; i <= 16; ++i)
     {
@@ -132,6 +138,8 @@ TEST(Cpu, BlarggInstrTest)
         memcpy(mem.data() + 0x8000, cart.prg_rom.data(), 0x4000);
         memcpy(mem.data() + 0xC000, cart.prg_rom.data() + 0x4000, 0x4000);
 
+        cpu.clear_decoded();
+        cpu.remap_code();
         cpu.reset();
 
         mem[0x6000] = 0x80;
@@ -160,4 +168,34 @@ TEST(Cpu, BlarggInstrTest)
     }
 }
 
+TEST(Cpu, BlarggInstrTest)
+{
+    blargg_instr_test(cpu);
+}
+
+TEST(Cpu, BlarggInstrTestFlatBus)
+{
+    blargg_instr_test(flat_bus_cpu);
+}
+
+// the code in ROM runs from its decoded instructions, the code the tests copy to RAM is interpreted
+TEST(Cpu, BlarggInstrTestDecoded)
+{
+    blargg_instr_test(decoding_cpu);
+    EXPECT_GT(decoding_cpu.code_stats.decoded, 0u);
+    EXPECT_GT(decoding_cpu.code_stats.interpreted, 0u);
+}
+
+// the hot code in ROM also runs natively, where it can
+TEST(Cpu, BlarggInstrTestCompiled)
+{
+    compiling_cpu.enable_jit(true);
+    if (!compiling_cpu.jit_enabled())
+        GTEST_SKIP() << "no native code on this host";
+
+    blargg_instr_test(compiling_cpu);
+    EXPECT_GT(compiling_cpu.code_stats.compiled, 0u);
+    EXPECT_GT(compiling_cpu.code_stats.decoded, 0u);
+}
+
 }
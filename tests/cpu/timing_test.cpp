@@ -30,6 +30,9 @@ SOFTWARE.
 #include <iomanip>
 
 #include "cpu.hpp"
+#include "cpu_impl.hpp"
+
+#include "detail/flat_bus.hpp"
 #include "common/parallel_stepper.hpp"
 
 namespace
@@ -37,12 +40,12 @@ namespace
 
 static std::array<uint8_t, 0x10000> mem;
 
-static uint8_t cpu6502_read(uint16_t addr)
+static uint8_t cpu6502_read(void*, uint16_t addr)
 {
     return mem[addr];
 }
 
-static void cpu6502_write(uint16_t addr, uint8_t val)
+static void cpu6502_write(void*, uint16_t addr, uint8_t val)
 {
     mem[addr] = val;
 }
@@ -111,8 +114,10 @@ static void log(const char* str)
     DO_TEST_8((base)+0x1E, 0x00, 7);
 
 static cpu6502 cpu(cpu6502_read, cpu6502_write, log);
+static basic_cpu6502<flat_bus> flat_bus_cpu(mem);
 
-TEST(Cpu, TimingInstructionTest)
+template <class Cpu>
+void timing_instruction_test(Cpu& cpu)
 {
 
     mem[0xFE] = 0xFF; // indirect target
@@ -137,7 +142,7 @@ TEST(Cpu, TimingInstructionTest)
     DO_TEST(0xF8, 2); // sed
     DO_TEST(0x78, 2); // sei
 
-    if constexpr (cpu6502::flavor == WDC65c02)
+    if constexpr (Cpu::flavor == WDC65c02)
     {
         DO_TEST(0x1A, 2); // inca
         DO_TEST(0x3A, 2); // deca
@@ -159,7 +164,7 @@ TEST(Cpu, TimingInstructionTest)
     DO_TEST(0x68, 4); // pla
     DO_TEST(0x28, 4); // plp
 
-    if constexpr (cpu6502::flavor == WDC65c02)
+    if constexpr (Cpu::flavor == WDC65c02)
     {
         DO_TEST(0xDA, 3); // phx
         DO_TEST(0x5A, 3); // phy
@@ -179,13 +184,13 @@ TEST(Cpu, TimingInstructionTest)
     BRANCH_TEST(0xD0, 0b0, 0b10); // bne
 
     DO_TEST_8(0x24, 0, 3); // bit zp
-    if constexpr (cpu6502::flavor == WDC65c02)
+    if constexpr (Cpu::flavor == WDC65c02)
     {
         DO_TEST_8(0x34, 0, 4); // bit zpx
     }
     DO_TEST_16(0x2C, 0, 4); // bit abs
 
-    if constexpr (cpu6502::flavor == WDC65c02)
+    if constexpr (Cpu::flavor == WDC65c02)
     {
         DO_TEST_8(0x89, 0, 2); // bit imm
         DO_TEST_16(0x3C, 0, 4); // bit abx
@@ -223,7 +228,7 @@ TEST(Cpu, TimingInstructionTest)
     DO_TEST_16(0x4C, 0, 3); // jmp
     DO_TEST_16(0x6C, 0, 5); // jmp ind
 
-    if constexpr (cpu6502::flavor == WDC65c02)
+    if constexpr (Cpu::flavor == WDC65c02)
     {
         DO_TEST_16(0x7C, 0, 6); // jmp absx
     }
@@ -277,4 +282,14 @@ TEST(Cpu, TimingInstructionTest)
     DO_TEST_16(0x8C, 0, 4);// sty abs
 }
 
+TEST(Cpu, TimingInstructionTest)
+{
+    timing_instruction_test(cpu);
+}
+
+TEST(Cpu, TimingInstructionTestFlatBus)
+{
+    timing_instruction_test(flat_bus_cpu);
+}
+
 }
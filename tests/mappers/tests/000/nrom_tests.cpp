@@ -60,20 +60,45 @@ namespace
 
 TEST(Ppu, NROMTest)
 {
+    NES::Console nes;
+
     for (auto test : test_list)
     {
-        NES::init();
-        assert(NES::load_cartridge("roms/000/" + test.path));
+        nes.init();
+        assert(nes.load_cartridge("roms/000/" + test.path));
 
-        NES::power_cycle();
+        nes.power_cycle();
 
         // run for ten frames
         for (size_t i { 0 }; i < 5; ++i)
         {
-            NES::run_frame();
+            nes.run_frame();
         }
 
-        EXPECT_EQ(screen_crc32(), test.crc_pass);
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass);
+    }
+}
+
+TEST(Ppu, NROMCatchUpTest)
+{
+    NES::Console nes;
+
+    for (auto test : test_list)
+    {
+        nes.init();
+        assert(nes.load_cartridge("roms/000/" + test.path));
+
+        nes.power_cycle();
+        nes.set_sync_mode(NES::SyncMode::CatchUp);
+
+        for (size_t i { 0 }; i < 5; ++i)
+        {
+            nes.run_frame();
+        }
+
+        nes.set_sync_mode(NES::SyncMode::Lockstep);
+
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass);
     }
 }
 
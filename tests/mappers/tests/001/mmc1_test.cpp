@@ -60,19 +60,21 @@ namespace
 
 TEST(Ppu, MMC1Test)
 {
+    NES::Console nes;
+
     for (auto test : test_list)
     {
-        NES::init();
-        assert(NES::load_cartridge("roms/001/" + test.path));
+        nes.init();
+        assert(nes.load_cartridge("roms/001/" + test.path));
 
-        NES::power_cycle();
+        nes.power_cycle();
 
         for (size_t i { 0 }; i < 100; ++i)
         {
-            NES::run_frame();
+            nes.run_frame();
         }
 
-        EXPECT_EQ(screen_crc32(), test.crc_pass) << test.path;
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
     }
 
     // run twice battery tests in order to setup save files
@@ -81,22 +83,46 @@ TEST(Ppu, MMC1Test)
         for (size_t i { 0 }; i < 2; ++i)
         {
             if (i == 1)
-                NES::load_game_battery_save_data();
+                nes.load_game_battery_save_data();
 
-            NES::init();
-            assert(NES::load_cartridge("roms/001/" + test.path));
+            nes.init();
+            assert(nes.load_cartridge("roms/001/" + test.path));
 
-            NES::power_cycle();
+            nes.power_cycle();
 
             for (size_t i { 0 }; i < 100; ++i)
             {
-                NES::run_frame();
+                nes.run_frame();
             }
 
             if (i == 0)
-                NES::save_game_battery_save_data();
+                nes.save_game_battery_save_data();
         }
     }
 }
 
+TEST(Ppu, MMC1CatchUpTest)
+{
+    NES::Console nes;
+
+    // bank switches go through mapper register writes, which must bring the ppu up to date
+    for (auto test : test_list)
+    {
+        nes.init();
+        assert(nes.load_cartridge("roms/001/" + test.path));
+
+        nes.power_cycle();
+        nes.set_sync_mode(NES::SyncMode::CatchUp);
+
+        for (size_t i { 0 }; i < 100; ++i)
+        {
+            nes.run_frame();
+        }
+
+        nes.set_sync_mode(NES::SyncMode::Lockstep);
+
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+    }
+}
+
 }
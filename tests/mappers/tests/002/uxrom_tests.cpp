@@ -50,34 +50,36 @@ namespace
 
 TEST(Ppu, UxROMTest)
 {
+    NES::Console nes;
+
     for (auto test : test_list)
     {
-        NES::init();
-        assert(NES::load_cartridge("roms/002/" + test.path));
+        nes.init();
+        assert(nes.load_cartridge("roms/002/" + test.path));
 
-        NES::power_cycle();
+        nes.power_cycle();
 
         // run for ten frames
         for (size_t i { 0 }; i < 50; ++i)
         {
-            NES::run_frame();
+            nes.run_frame();
         }
 
-        EXPECT_EQ(screen_crc32(), test.crc_pass);
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass);
     }
 
-    NES::init();
-    assert(NES::load_cartridge("roms/002/M2_P128K_V.nes"));
+    nes.init();
+    assert(nes.load_cartridge("roms/002/M2_P128K_V.nes"));
 
-    NES::power_cycle();
+    nes.power_cycle();
 
     // run for ten frames
     for (size_t i { 0 }; i < 100; ++i)
     {
-        NES::run_frame();
+        nes.run_frame();
     }
 
-    EXPECT_EQ(screen_crc32(), 0x2E00C88A);
+    EXPECT_EQ(screen_crc32(nes), 0x2E00C88A);
 }
 
 
@@ -51,20 +51,22 @@ namespace
 
 TEST(Ppu, CNROMTest)
 {
+    NES::Console nes;
+
     for (auto test : test_list)
     {
-        NES::init();
-        assert(NES::load_cartridge("roms/003/" + test.path));
+        nes.init();
+        assert(nes.load_cartridge("roms/003/" + test.path));
 
-        NES::power_cycle();
+        nes.power_cycle();
 
         // run for ten frames
         for (size_t i { 0 }; i < 45; ++i)
         {
-            NES::run_frame();
+            nes.run_frame();
         }
 
-        EXPECT_EQ(screen_crc32(), test.crc_pass);
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass);
     }
 }
 
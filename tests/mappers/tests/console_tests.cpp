@@ -0,0 +1,895 @@
+/*
+console_tests.cpp
+
+Copyright (c) 01 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "gtest/gtest.h"
+#include <array>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <thread>
+#include <vector>
+
+#include "common/coroutine.hpp"
+
+#include "nes.hpp"
+#include "core/include/rewind.hpp"
+#include "core/include/movie.hpp"
+#include "input/include/standard_controller.hpp"
+
+#include "../utils/screen_crc.hpp"
+
+#include "common/log.hpp"
+
+namespace
+{
+
+struct test_rom
+{
+    std::string path;
+    uint32_t crc_pass;
+};
+
+const test_rom test_list[] =
+{
+    { "001/serom.nes", 0x46D0A62E },
+    { "001/M1_P128K_C128K_W8K.nes", 0x71624440 },
+    { "001/M1_P128K_C32K.nes", 0xBA8B8C71 },
+    { "002/M2_P128K_V.nes", 0x2E00C88A },
+};
+
+void boot(NES::Console& nes, const std::string& path, Controller* controller = nullptr)
+{
+    nes.init();
+    assert(nes.load_cartridge("roms/" + path));
+    nes.input.controller_1 = controller;
+
+    nes.power_cycle();
+}
+
+// input getting the games past their title screens, then moving and jumping : 'branch' 1 goes left instead, 2 keeps
+// jumping, for runs that must differ
+void play(StandardController& controller, size_t frame, size_t branch = 0)
+{
+    controller.state = {};
+    controller.state.start = (frame % 120) >= 100 && (frame % 120) < 105;
+    controller.state.right = frame > 300 && branch != 1;
+    controller.state.left  = frame > 300 && branch == 1;
+    controller.state.a = (frame % 40) < 10 || branch == 2;
+}
+
+TEST(Console, InterleavedConsoles)
+{
+    global_logger.filter(WARNING);
+
+    std::vector<std::unique_ptr<NES::Console>> consoles;
+    for (auto test : test_list)
+    {
+        consoles.emplace_back(std::make_unique<NES::Console>());
+        boot(*consoles.back(), test.path);
+    }
+    consoles[1]->set_sync_mode(NES::SyncMode::CatchUp);
+
+    // consoles don't share any state, stepping them in turn must give the same results as running them alone
+    for (size_t i { 0 }; i < 100; ++i)
+    {
+        for (auto& nes : consoles)
+        {
+            nes->run_frame();
+        }
+    }
+
+    for (size_t i { 0 }; i < consoles.size(); ++i)
+    {
+        EXPECT_EQ(screen_crc32(*consoles[i]), test_list[i].crc_pass) << test_list[i].path;
+    }
+}
+
+TEST(Console, ThreadedConsoles)
+{
+    global_logger.filter(WARNING);
+
+    std::vector<uint32_t> crcs(std::size(test_list));
+    std::vector<std::thread> threads;
+    for (size_t i { 0 }; i < std::size(test_list); ++i)
+    {
+        threads.emplace_back([&crcs, i]
+        {
+            NES::Console nes;
+            boot(nes, test_list[i].path);
+
+            for (size_t frame { 0 }; frame < 100; ++frame)
+            {
+                nes.run_frame();
+            }
+
+            crcs[i] = screen_crc32(nes);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t i { 0 }; i < std::size(test_list); ++i)
+    {
+        EXPECT_EQ(crcs[i], test_list[i].crc_pass) << test_list[i].path;
+    }
+}
+
+TEST(Console, ConsoleMigration)
+{
+    global_logger.filter(WARNING);
+
+    NES::Console nes;
+    boot(nes, test_list[0].path);
+
+    // a console can be handed over to another thread between frames
+    for (size_t frame { 0 }; frame < 100; frame += 25)
+    {
+        std::thread([&nes]
+        {
+            for (size_t i { 0 }; i < 25; ++i)
+            {
+                nes.run_frame();
+            }
+        }).join();
+    }
+
+    EXPECT_EQ(screen_crc32(nes), test_list[0].crc_pass);
+}
+
+TEST(Console, IdleLoopSkipping)
+{
+    global_logger.filter(WARNING);
+
+    for (auto test : test_list)
+    {
+        NES::Console reference, nes;
+        reference.skip_idle_loops = false;
+        boot(reference, test.path);
+        boot(nes, test.path);
+
+        // skipping idle loops must not be observable, even when switching sync modes in the middle of a skip
+        for (size_t i { 0 }; i < 100*29781; ++i)
+        {
+            if (i % 7919 == 0)
+            {
+                nes.set_sync_mode(nes.sync_mode() == NES::SyncMode::Lockstep ? NES::SyncMode::CatchUp : NES::SyncMode::Lockstep);
+            }
+            reference.run_cpu_cycle();
+            nes.run_cpu_cycle();
+
+            if (i % 29781 == 0)
+            {
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << test.path << " at cycle " << i;
+            }
+        }
+
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+        EXPECT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path;
+        EXPECT_GT(nes.idle_cycles_skipped, 0u) << test.path;
+        EXPECT_EQ(reference.idle_cycles_skipped, 0u) << test.path;
+    }
+}
+
+TEST(Console, DecodedCode)
+{
+    global_logger.filter(WARNING);
+
+    for (auto test : test_list)
+    {
+        NES::Console reference, nes;
+        reference.decode_rom_code = false;
+        boot(reference, test.path);
+        boot(nes, test.path);
+
+        // running code decoded must not be observable, whether its fetch cycles are counted at once or not,
+        // and across the mapper switching the banks the code runs from
+        for (size_t i { 0 }; i < 100*29781; ++i)
+        {
+            if (i % 7919 == 0)
+            {
+                const auto mode = nes.sync_mode() == NES::SyncMode::Lockstep ? NES::SyncMode::CatchUp : NES::SyncMode::Lockstep;
+                reference.set_sync_mode(mode);
+                nes.set_sync_mode(mode);
+            }
+            reference.run_cpu_cycle();
+            nes.run_cpu_cycle();
+
+            if (i % 29781 == 0)
+            {
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << test.path << " at cycle " << i;
+            }
+        }
+
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+        EXPECT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << test.path;
+        EXPECT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path;
+        EXPECT_GT(nes.cpu.code_stats.decoded, 0u) << test.path;
+        EXPECT_EQ(reference.cpu.code_stats.decoded, 0u) << test.path;
+    }
+}
+
+TEST(Console, CompiledCode)
+{
+    global_logger.filter(WARNING);
+
+    for (auto test : test_list)
+    {
+        NES::Console reference, nes;
+        nes.compile_rom_code = true;
+        boot(reference, test.path);
+        boot(nes, test.path);
+        if (!nes.cpu.jit_enabled())
+            GTEST_SKIP() << "no native code on this host";
+
+        // running blocks of code natively must not be observable either ; they only run in catch-up mode, whose
+        // bursts last until the next event of the ppu
+        for (size_t frame { 0 }; frame < 100; ++frame)
+        {
+            const auto mode = frame % 25 < 5 ? NES::SyncMode::Lockstep : NES::SyncMode::CatchUp;
+            reference.set_sync_mode(mode);
+            nes.set_sync_mode(mode);
+            reference.run_frame();
+            nes.run_frame();
+
+            ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << test.path << " at frame " << frame;
+            ASSERT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path << " at frame " << frame;
+        }
+
+        EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+        EXPECT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << test.path;
+        EXPECT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path;
+        EXPECT_EQ(reference.idle_cycles_skipped, nes.idle_cycles_skipped) << test.path;
+        EXPECT_GT(nes.cpu.code_stats.compiled, 0u) << test.path;
+        EXPECT_EQ(reference.cpu.code_stats.compiled, 0u) << test.path;
+    }
+}
+
+TEST(Console, InstructionTests)
+{
+    global_logger.filter(WARNING);
+
+    for (bool compiled : {false, true})
+    for (auto rom : {"roms/blargg_tests/official_only.nes", "roms/blargg_tests/all_instrs.nes"})
+    {
+        NES::Console nes;
+        nes.init();
+        assert(nes.load_cartridge(rom));
+        nes.set_sync_mode(NES::SyncMode::CatchUp);
+        nes.compile_rom_code = compiled;
+        nes.power_cycle();
+
+        nes.cpu.write(0x6000, 0x80);
+        for (size_t frame { 0 }; frame < 5000 && nes.cpu.read(0x6000) == 0x80; ++frame)
+        {
+            nes.run_frame();
+        }
+
+        std::string output;
+        for (uint16_t addr { 0x6004 }; nes.cpu.read(addr); ++addr)
+        {
+            output += (char)nes.cpu.read(addr);
+        }
+        EXPECT_EQ(nes.cpu.read(0x6000), 0) << rom << (compiled ? " compiled" : "") << " : " << output;
+        if (compiled && nes.cpu.jit_enabled())
+            EXPECT_GT(nes.cpu.code_stats.compiled, 0u) << rom;
+    }
+}
+
+TEST(Console, PPUCoresMatch)
+{
+    global_logger.filter(WARNING);
+
+    for (auto sync : {NES::SyncMode::Lockstep, NES::SyncMode::CatchUp})
+    {
+        for (auto test : test_list)
+        {
+            NES::Console reference, nes;
+            reference.dot_ppu = false;
+            boot(reference, test.path);
+            boot(nes, test.path);
+            reference.set_sync_mode(sync);
+            nes.set_sync_mode(sync);
+
+            for (size_t frame { 0 }; frame < 100; ++frame)
+            {
+                reference.run_frame();
+                nes.run_frame();
+
+                ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << test.path << " at frame " << frame;
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << test.path << " at frame " << frame;
+            }
+
+            EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+            EXPECT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path;
+        }
+    }
+}
+
+TEST(Console, ScanlineRendererMatch)
+{
+    global_logger.filter(WARNING);
+
+    for (auto sync : {NES::SyncMode::Lockstep, NES::SyncMode::CatchUp})
+    {
+        for (auto test : test_list)
+        {
+            NES::Console reference, nes;
+            reference.ppu.scanline_renderer = false;
+            boot(reference, test.path);
+            boot(nes, test.path);
+            reference.set_sync_mode(sync);
+            nes.set_sync_mode(sync);
+
+            for (size_t frame { 0 }; frame < 100; ++frame)
+            {
+                reference.run_frame();
+                nes.run_frame();
+
+                ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << test.path << " at frame " << frame;
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << test.path << " at frame " << frame;
+            }
+
+            EXPECT_EQ(screen_crc32(nes), test.crc_pass) << test.path;
+            EXPECT_EQ(reference.cpu.cycles, nes.cpu.cycles) << test.path;
+            EXPECT_EQ(reference.ppu.stats.fast_scanlines, 0u) << test.path;
+            EXPECT_GT(nes.ppu.stats.fast_scanlines, 0u) << test.path;
+            EXPECT_EQ(nes.ppu.stats.fast_scanlines + nes.ppu.stats.dot_scanlines,
+                      reference.ppu.stats.dot_scanlines) << test.path;
+        }
+    }
+}
+
+TEST(Console, SimdComposition)
+{
+    global_logger.filter(WARNING);
+
+    if (!compose_pixels_simd)
+    {
+        GTEST_SKIP() << "SSE4.1 not supported";
+    }
+
+    for (bool scanline_renderer : {true, false})
+    {
+        for (auto rom : {"smb.nes", "excitebike.nes", "KungFu.nes", "metroid.nes", "mb.nes"})
+        {
+            NES::Console reference, nes;
+            boot(reference, rom);
+            boot(nes, rom);
+            for (NES::Console* console : {&reference, &nes})
+            {
+                console->set_sync_mode(NES::SyncMode::CatchUp);
+                console->ppu.scanline_renderer = scanline_renderer;
+            }
+            reference.ppu.simd_compose = false;
+
+            for (size_t frame { 0 }; frame < 300; ++frame)
+            {
+                reference.run_frame();
+                nes.run_frame();
+
+                ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << rom << " at frame " << frame;
+            }
+            EXPECT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << rom;
+        }
+    }
+}
+
+TEST(Console, DisplayOutput)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "full_palette.nes", "color_test.nes"})
+    {
+        NES::Console nes;
+        boot(nes, rom);
+
+        // indexed pixels in lines wider than the screen, and colors
+        constexpr size_t pitch = 300;
+        std::vector<uint8_t>  indexed(240*pitch);
+        std::vector<uint32_t> rgba(240*256);
+        const auto lut = make_output_lut(PixelFormat::RGBA8888, PPU::ppu_palette.data());
+
+        for (size_t frame { 0 }; frame < 120; ++frame)
+        {
+            nes.ppu.set_output(indexed.data(), PixelFormat::Indexed, pitch);
+            nes.run_frame();
+            for (size_t line { 0 }; line < 240; ++line)
+            {
+                ASSERT_TRUE(std::equal(&nes.ppu.framebuffer[line*256], &nes.ppu.framebuffer[line*256 + 256], &indexed[line*pitch]))
+                        << rom << " at frame " << frame << ", line " << line;
+            }
+
+            nes.ppu.set_output(rgba.data());
+            nes.run_frame();
+            nes.ppu.set_output(nullptr);
+            for (size_t i { 0 }; i < rgba.size(); ++i)
+            {
+                // any emphasis, as it isn't known here
+                bool found = false;
+                for (unsigned emphasis { 0 }; emphasis < 8; ++emphasis)
+                    found |= rgba[i] == lut[emphasis << 6 | nes.ppu.framebuffer[i]];
+                ASSERT_TRUE(found) << rom << " at frame " << frame << ", pixel " << i;
+            }
+        }
+    }
+}
+
+TEST(Console, RenderSkip)
+{
+    global_logger.filter(WARNING);
+
+    for (unsigned frameskip : {1u, 3u, PPU::skip_all_frames})
+    {
+        for (auto rom : {"smb.nes", "excitebike.nes", "KungFu.nes", "metroid.nes", "mb.nes"})
+        {
+            NES::Console reference, nes;
+            boot(reference, rom);
+            boot(nes, rom);
+            nes.ppu.frameskip = frameskip;
+
+            // skipping the pixels must not change how the game runs
+            constexpr size_t frames = 300;
+            for (size_t frame { 0 }; frame < frames; ++frame)
+            {
+                reference.run_frame();
+                nes.run_frame();
+
+                ASSERT_EQ(reference.cpu.cycles, nes.cpu.cycles) << rom << " at frame " << frame;
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << rom << " at frame " << frame;
+            }
+
+            EXPECT_EQ(reference.ppu.stats.skipped_frames, 0u) << rom;
+            const size_t expected = frameskip == PPU::skip_all_frames ? nes.ppu.frames : nes.ppu.frames*frameskip/(frameskip + 1);
+            EXPECT_NEAR(nes.ppu.stats.skipped_frames, expected, 1) << rom;
+        }
+    }
+}
+
+TEST(Console, BackgroundReuse)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "excitebike.nes", "KungFu.nes", "metroid.nes", "zelda.nes", "mb.nes"})
+    {
+        NES::Console reference, nes;
+        StandardController reference_pad, pad;
+        boot(reference, rom, &reference_pad);
+        boot(nes, rom, &pad);
+        reference.ppu.reuse_backgrounds = false;
+
+        for (size_t frame { 0 }; frame < 600; ++frame)
+        {
+            // get past the title screens, so that the games scroll and update their nametables
+            play(reference_pad, frame);
+            play(pad, frame);
+
+            reference.run_frame();
+            nes.run_frame();
+
+            ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << rom << " at frame " << frame;
+        }
+
+        EXPECT_EQ(reference.ppu.stats.reused_backgrounds, 0u) << rom;
+        EXPECT_GT(nes.ppu.stats.reused_backgrounds, 0u) << rom;
+        EXPECT_LT(nes.ppu.stats.reused_backgrounds, nes.ppu.stats.fast_scanlines) << rom;
+    }
+}
+
+
+TEST(Console, SaveStates)
+{
+    global_logger.filter(WARNING);
+
+    for (auto mode : {NES::SyncMode::Lockstep, NES::SyncMode::CatchUp})
+    {
+        for (auto rom : {"smb.nes", "excitebike.nes", "metroid.nes", "zelda.nes", "002/M2_P128K_V.nes", "003/M3_P32K_C32K_H.nes"})
+        {
+            NES::Console reference, nes, restored;
+            StandardController reference_pad, pad, restored_pad;
+            boot(reference, rom, &reference_pad);
+            boot(nes, rom, &pad);
+            boot(restored, rom, &restored_pad);
+            for (NES::Console* console : {&reference, &nes, &restored})
+                console->set_sync_mode(mode);
+
+            std::vector<uint8_t> state(nes.state_size()), snapshot(state.size()), replayed(state.size());
+            ASSERT_GT(state.size(), 0u);
+
+            // saving must not change how the game runs
+            for (size_t frame { 0 }; frame < 400; ++frame)
+            {
+                play(reference_pad, frame);
+                play(pad, frame);
+                play(restored_pad, frame);
+
+                reference.run_frame();
+                nes.run_frame();
+                ASSERT_EQ(reference.cpu.cycles, nes.cpu.cycles) << rom << " at frame " << frame;
+                ASSERT_EQ(reference.nes_ram.m_data, nes.nes_ram.m_data) << rom << " at frame " << frame;
+                ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << rom << " at frame " << frame;
+
+                // another console picks up from a state and runs the same from there on
+                if (frame > 200)
+                {
+                    restored.run_frame();
+                    ASSERT_EQ(nes.cpu.cycles, restored.cpu.cycles) << rom << " at frame " << frame;
+                    ASSERT_EQ(nes.nes_ram.m_data, restored.nes_ram.m_data) << rom << " at frame " << frame;
+                    ASSERT_EQ(nes.ppu.framebuffer, restored.ppu.framebuffer) << rom << " at frame " << frame;
+                }
+                if (frame == 200)
+                {
+                    ASSERT_EQ(nes.save_state(snapshot.data(), snapshot.size()), snapshot.size()) << rom;
+                    ASSERT_TRUE(restored.load_state(snapshot.data(), snapshot.size())) << rom;
+                }
+                else if (frame % 5 == 0)
+                {
+                    ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+                }
+            }
+
+            // going back to a state and replaying the same input leads to the exact same state
+            ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+            ASSERT_TRUE(nes.load_state(snapshot.data(), snapshot.size())) << rom;
+            for (size_t frame { 201 }; frame < 400; ++frame)
+            {
+                play(pad, frame);
+                nes.run_frame();
+            }
+            ASSERT_EQ(nes.save_state(replayed.data(), replayed.size()), replayed.size()) << rom;
+            EXPECT_EQ(state, replayed) << rom;
+
+            // states are only loaded into a console running the same game
+            EXPECT_FALSE(reference.load_state(state.data(), state.size() - 1)) << rom;
+            std::vector<uint8_t> corrupted = state;
+            corrupted[0] ^= 0xFF;
+            EXPECT_FALSE(reference.load_state(corrupted.data(), corrupted.size())) << rom;
+            EXPECT_EQ(reference.save_state(state.data(), state.size() - 1), 0u) << rom;
+        }
+    }
+
+    // nor with other controllers connected, a rejected load leaving the console as it was
+    NES::Console first_port, second_port;
+    StandardController first_pad, second_pad;
+    boot(first_port, "smb.nes");
+    boot(second_port, "smb.nes");
+    first_port.input.controller_1 = &first_pad;
+    second_port.input.controller_2 = &second_pad;
+    for (size_t frame { 0 }; frame < 100; ++frame)
+    {
+        first_port.run_frame();
+        if (frame < 60)
+            second_port.run_frame();
+    }
+
+    std::vector<uint8_t> other(first_port.state_size()), before(second_port.state_size()), after(before.size());
+    ASSERT_EQ(other.size(), before.size());
+    ASSERT_EQ(first_port.save_state(other.data(), other.size()), other.size());
+    ASSERT_EQ(second_port.save_state(before.data(), before.size()), before.size());
+    ASSERT_TRUE(second_port.load_state(before.data(), before.size()));
+    EXPECT_FALSE(second_port.load_state(other.data(), other.size()));
+    ASSERT_EQ(second_port.save_state(after.data(), after.size()), after.size());
+    EXPECT_EQ(before, after);
+}
+
+
+TEST(Console, Rewind)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "zelda.nes", "metroid.nes"})
+    {
+        NES::Console reference, nes;
+        StandardController reference_pad, pad;
+        boot(reference, rom, &reference_pad);
+        boot(nes, rom, &pad);
+
+        // small enough for the oldest states to be dropped
+        NES::RewindBuffer history(nes, 256*1024, 1000, 30);
+
+        constexpr size_t frames = 900;
+        std::vector<std::vector<uint8_t>> states(frames, std::vector<uint8_t>(nes.state_size()));
+        std::vector<uint32_t> screens(frames);
+        for (size_t frame { 0 }; frame < frames; ++frame)
+        {
+            play(reference_pad, frame);
+            play(pad, frame);
+            reference.run_frame();
+            nes.run_frame();
+
+            // the reference takes the same states as the captures
+            ASSERT_EQ(reference.save_state(states[frame].data(), states[frame].size()), states[frame].size());
+            screens[frame] = screen_crc32(reference);
+            ASSERT_TRUE(history.capture()) << rom << " at frame " << frame;
+            ASSERT_LE(history.bytes_used(), history.capacity()) << rom;
+        }
+        EXPECT_GT(history.stats.evicted, 0u) << rom;
+        EXPECT_LT(history.frames(), frames) << rom;
+        EXPECT_GT(history.frames(), 60u) << rom;
+
+        // a state saved right after a load is the state loaded
+        std::vector<uint8_t> state(nes.state_size());
+        size_t frame = frames - 1;
+        for (size_t count : {0, 1, 5, 29, 30, 31, 100})
+        {
+            const size_t kept = history.frames();
+            ASSERT_TRUE(history.rewind(count)) << rom;
+            ASSERT_EQ(history.frames(), kept - count) << rom;
+            frame -= count;
+            ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+            ASSERT_EQ(state, states[frame]) << rom << " rewinding to frame " << frame;
+        }
+        EXPECT_FALSE(history.rewind(history.frames())) << rom;
+
+        // back to the oldest state kept
+        frame -= history.frames() - 1;
+        ASSERT_TRUE(history.rewind(history.frames() - 1)) << rom;
+        ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+        ASSERT_EQ(state, states[frame]) << rom << " rewinding to frame " << frame;
+
+        // the game goes on the same from there, and can be rewound again
+        ASSERT_TRUE(history.rewind(0)) << rom;
+        const size_t restart = frame;
+        for (++frame; frame < frames; ++frame)
+        {
+            play(pad, frame);
+            nes.run_frame();
+            ASSERT_EQ(screen_crc32(nes), screens[frame]) << rom << " at frame " << frame;
+            ASSERT_TRUE(history.capture()) << rom;
+        }
+        ASSERT_TRUE(history.rewind(frames - 1 - restart - 10)) << rom;
+        ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+        EXPECT_EQ(state, states[restart + 10]) << rom;
+    }
+}
+
+
+TEST(Console, Clones)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "zelda.nes", "metroid.nes", "002/M2_P128K_V.nes"})
+    {
+        NES::Console root;
+        StandardController root_pad;
+        boot(root, rom, &root_pad);
+
+        // the clones run the cartridge already loaded
+        constexpr size_t branches = 3;
+        std::array<NES::Console, branches> clones;
+        std::array<StandardController, branches> pads;
+        for (size_t i { 0 }; i < branches; ++i)
+        {
+            clones[i].init();
+            ASSERT_TRUE(clones[i].load_cartridge(root.cart_data)) << rom;
+            clones[i].input.controller_1 = &pads[i];
+            clones[i].power_cycle();
+        }
+
+        for (size_t frame { 0 }; frame < 300; ++frame)
+        {
+            play(root_pad, frame);
+            root.run_frame();
+        }
+
+        // every branch gives the same result each time it is explored from the root
+        std::array<std::vector<uint8_t>, branches> results;
+        for (unsigned pass { 0 }; pass < 2; ++pass)
+        {
+            for (size_t i { 0 }; i < branches; ++i)
+            {
+                ASSERT_TRUE(clones[i].copy_state_from(root)) << rom;
+                for (size_t frame { 300 }; frame < 420; ++frame)
+                {
+                    play(pads[i], frame, i);
+                    clones[i].run_frame();
+                }
+
+                std::vector<uint8_t> state(clones[i].state_size());
+                ASSERT_EQ(clones[i].save_state(state.data(), state.size()), state.size()) << rom;
+                if (pass == 0)
+                    results[i] = state;
+                else
+                    EXPECT_EQ(state, results[i]) << rom << " branch " << i;
+            }
+        }
+
+        // the first branch is what the root would have done
+        for (size_t frame { 300 }; frame < 420; ++frame)
+        {
+            play(root_pad, frame);
+            root.run_frame();
+        }
+        std::vector<uint8_t> state(root.state_size());
+        ASSERT_EQ(root.save_state(state.data(), state.size()), state.size()) << rom;
+        EXPECT_EQ(state, results[0]) << rom;
+    }
+
+    // only a console running the same game can be cloned
+    NES::Console smb, zelda;
+    boot(smb, "smb.nes");
+    boot(zelda, "zelda.nes");
+    smb.run_frame();
+    zelda.run_frame();
+    EXPECT_FALSE(smb.copy_state_from(zelda));
+}
+
+
+TEST(Console, Movies)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "metroid.nes"})
+    {
+        NES::Movie movie;
+        {
+            NES::Console nes;
+            StandardController pad;
+            boot(nes, rom, &pad);
+            for (size_t frame { 0 }; frame < 400; ++frame)
+            {
+                play(pad, frame);
+                nes.run_frame();
+                movie.record(nes, pad.state);
+            }
+        }
+        ASSERT_TRUE(movie.save("movie_test.nmv")) << rom;
+
+        NES::Movie loaded;
+        ASSERT_TRUE(loaded.load("movie_test.nmv")) << rom;
+        ASSERT_EQ(loaded.rom_hash, movie.rom_hash) << rom;
+        ASSERT_EQ(loaded.frames.size(), movie.frames.size()) << rom;
+        for (size_t frame { 0 }; frame < movie.frames.size(); ++frame)
+        {
+            ASSERT_EQ(loaded.frames[frame].hash, movie.frames[frame].hash) << rom;
+            ASSERT_EQ(loaded.frames[frame].input.a, movie.frames[frame].input.a) << rom;
+            ASSERT_EQ(loaded.frames[frame].input.start, movie.frames[frame].input.start) << rom;
+            ASSERT_EQ(loaded.frames[frame].input.right, movie.frames[frame].input.right) << rom;
+        }
+
+        // the other cores play it back exactly
+        for (bool faster : {false, true})
+        {
+            NES::Console nes;
+            StandardController pad;
+            boot(nes, rom, &pad);
+            nes.set_sync_mode(faster ? NES::SyncMode::CatchUp : NES::SyncMode::Lockstep);
+
+            NES::MoviePlayer player(loaded, nes, pad);
+            while (player.run_frame()) {}
+            EXPECT_TRUE(player.finished()) << rom << " diverged at frame " << player.frame() - 1;
+            EXPECT_FALSE(player.diverged()) << rom;
+        }
+
+        // the first frame that differs is reported
+        NES::Movie altered = loaded;
+        altered.frames[250].hash ^= 1;
+        {
+            NES::Console nes;
+            StandardController pad;
+            boot(nes, rom, &pad);
+
+            NES::MoviePlayer player(altered, nes, pad);
+            while (player.run_frame()) {}
+            EXPECT_TRUE(player.diverged()) << rom;
+            EXPECT_EQ(player.frame() - 1, 250u) << rom;
+            EXPECT_FALSE(player.run_frame()) << rom;
+        }
+    }
+
+    // movies are only played back on the game they were recorded on
+    NES::Movie movie;
+    ASSERT_TRUE(movie.load("movie_test.nmv"));
+    NES::Console nes;
+    StandardController pad;
+    boot(nes, "zelda.nes", &pad);
+    NES::MoviePlayer player(movie, nes, pad);
+    EXPECT_TRUE(player.wrong_game());
+    EXPECT_FALSE(player.run_frame());
+
+    // nor loaded if they are truncated
+    std::vector<uint8_t> file;
+    {
+        std::ifstream in("movie_test.nmv", std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out("movie_test.nmv", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(file.data()), file.size() - 1);
+    }
+    EXPECT_FALSE(movie.load("movie_test.nmv"));
+    std::remove("movie_test.nmv");
+}
+
+
+TEST(Console, RunAhead)
+{
+    global_logger.filter(WARNING);
+
+    for (auto rom : {"smb.nes", "metroid.nes"})
+    {
+        for (unsigned frames_ahead : {1u, 3u})
+        {
+            NES::Console reference, nes, ahead;
+            StandardController reference_pad, pad, ahead_pad;
+            boot(reference, rom, &reference_pad);
+            boot(nes, rom, &pad);
+            boot(ahead, rom, &ahead_pad);
+            std::vector<uint8_t> state(nes.state_size()), expected(state.size());
+            size_t frames_shown_ahead { 0 };
+            for (size_t frame { 0 }; frame < 400; ++frame)
+            {
+                play(reference_pad, frame);
+                play(pad, frame);
+                reference.run_frame();
+                ASSERT_TRUE(nes.run_frame_ahead(frames_ahead)) << rom;
+                EXPECT_EQ(nes.ppu.frameskip, 0u) << rom;
+
+                // the game runs as it would without run-ahead
+                ASSERT_EQ(reference.save_state(expected.data(), expected.size()), expected.size()) << rom;
+                ASSERT_EQ(nes.save_state(state.data(), state.size()), state.size()) << rom;
+                ASSERT_EQ(state, expected) << rom << " at frame " << frame;
+
+                // but shows the frame the game would draw that many frames later with the same input
+                ASSERT_TRUE(ahead.load_state(expected.data(), expected.size())) << rom;
+                play(ahead_pad, frame);
+                for (unsigned i { 0 }; i < frames_ahead; ++i)
+                    ahead.run_frame();
+                ASSERT_EQ(ahead.ppu.framebuffer, nes.ppu.framebuffer) << rom << " at frame " << frame;
+
+                // hence its movie hash, the RAM being the one of the game, only matches the one the game would have
+                // without run-ahead when both frames look the same
+                const bool same_picture = reference.ppu.framebuffer == nes.ppu.framebuffer;
+                ASSERT_EQ(NES::Movie::hash(reference) == NES::Movie::hash(nes), same_picture) << rom << " at frame " << frame;
+                frames_shown_ahead += !same_picture;
+            }
+            EXPECT_GT(frames_shown_ahead, 0u) << rom;
+            EXPECT_GT(nes.run_ahead_seconds, 0) << rom;
+
+            reference.run_frame();
+            nes.run_frame();
+            EXPECT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << rom;
+        }
+    }
+
+    // when no state can be saved, as with the coroutine ppu, each frame is only run and drawn as by run_frame()
+    NES::Console reference, nes;
+    reference.dot_ppu = nes.dot_ppu = false;
+    boot(reference, "smb.nes");
+    boot(nes, "smb.nes");
+    for (size_t frame { 0 }; frame < 60; ++frame)
+    {
+        reference.run_frame();
+        ASSERT_FALSE(nes.run_frame_ahead(2));
+        ASSERT_EQ(reference.cpu.cycles, nes.cpu.cycles) << "at frame " << frame;
+        ASSERT_EQ(reference.ppu.framebuffer, nes.ppu.framebuffer) << "at frame " << frame;
+    }
+    EXPECT_EQ(nes.run_ahead_seconds, 0);
+}
+
+}
@@ -37,20 +37,21 @@ StandardController controller_1;
 
 bool do_blargg_test(const std::string& rom_path, std::string& output)
 {
-    NES::init();
-    assert(NES::load_cartridge(rom_path));
-    NES::input.controller_1 = &controller_1;
+    NES::Console nes;
+    nes.init();
+    assert(nes.load_cartridge(rom_path));
+    nes.input.controller_1 = &controller_1;
 
-    NES::power_cycle();
+    nes.power_cycle();
 
-    NES::cpu.write(0x6000, 0x80);
+    nes.cpu.write(0x6000, 0x80);
 
-    while(NES::cpu.read(0x6000) == 0x80)
+    while(nes.cpu.read(0x6000) == 0x80)
     {
-        NES::run_cpu_cycle();
+        nes.run_cpu_cycle();
     }
 
-    if (NES::cpu.read(0x6000) == 0)
+    if (nes.cpu.read(0x6000) == 0)
     {
         return true;
     }
@@ -58,7 +59,7 @@ bool do_blargg_test(const std::string& rom_path, std::string& output)
     {
         int txt_idx = 0x6004;
         char c;
-        while ((c = (char)NES::cpu.read(txt_idx++)))
+        while ((c = (char)nes.cpu.read(txt_idx++)))
             output += c;
         return false;
     }
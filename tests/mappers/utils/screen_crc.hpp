@@ -45,9 +45,9 @@ inline uint32_t crc32c(uint32_t crc, const unsigned char *buf, size_t len)
     return ~crc;
 }
 
-inline uint32_t screen_crc32()
+inline uint32_t screen_crc32(const NES::Console& nes)
 {
-    return crc32c(0, NES::ppu.framebuffer.data(), 240*256);
+    return crc32c(0, nes.ppu.framebuffer.data(), 240*256);
 }
 
 #endif // SCREEN_CRC_HPP
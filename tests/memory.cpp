@@ -1,8 +1,11 @@
 #include <array>
+#include <chrono>
+#include <iostream>
 
 #include "gtest/gtest.h"
 
 #include "memory/include/memory.hpp"
+#include "core/include/nes.hpp"
 
 namespace
 {
@@ -104,4 +107,138 @@ TEST(Memory, OpenBus) {
     EXPECT_EQ(s.read(0), 0xff);
 }
 
+TEST(Memory, BankSwitching) {
+    AddressSpace s;
+
+    std::array<data, 0x400> rom;
+    for (size_t i { 0 }; i < rom.size(); ++i)
+        rom[i] = i / 0x100;
+
+    ROMBankWindow<0x100> window;
+    window.set_rom_base(rom.data(), rom.size());
+    s.add_port(memory_port{&window, 0x8000});
+
+    for (size_t bank { 0 }; bank < window.bank_count(); ++bank)
+    {
+        window.set_bank(bank);
+        EXPECT_EQ(s.read(0x8000), bank);
+        EXPECT_EQ(s.read(0x80FF), bank);
+    }
+
+    // ROM windows ignore writes
+    s.write(0x8000, 0xAA);
+    EXPECT_EQ(s.read(0x8000), 3);
+
+    window.set_valid(false);
+    s.write(0x8000, 0x55);
+    EXPECT_EQ(s.read(0x8000), 0x55); // open bus
+}
+
+TEST(Memory, DirectPages) {
+    AddressSpace s;
+
+    std::array<data, 0x400> rom;
+    for (size_t i { 0 }; i < rom.size(); ++i)
+        rom[i] = i / 0x100;
+
+    ROMBankWindow<0x200> window;
+    window.set_rom_base(rom.data(), rom.size());
+    RAM<0x100> ram;
+    s.add_port(memory_port{&window, 0x8000});
+    s.add_port(memory_port{&ram, 0x0000});
+
+    // ROM pages are exposed, and follow bank switches
+    ASSERT_NE(s.direct_page(0x8123), nullptr);
+    EXPECT_EQ(s.direct_page(0x8123), rom.data() + 0x100);
+    window.set_bank(1);
+    EXPECT_EQ(s.direct_page(0x8000), rom.data() + 0x200);
+    EXPECT_EQ(s.direct_page(0x8100)[0], 3);
+
+    // only RAM writes are plain stores, anything else may remap memory
+    EXPECT_EQ(s.direct_page(0x0000), ram.m_data.data());
+    EXPECT_TRUE (s.ram_write(0x0000));
+    EXPECT_FALSE(s.ram_write(0x8000));
+    EXPECT_EQ(s.direct_page(0x4000), nullptr);
+    EXPECT_FALSE(s.ram_write(0x4000));
+    EXPECT_EQ(s.ram_page(0x00FF), ram.m_data.data());
+    EXPECT_EQ(s.ram_page(0x8000), nullptr);
+
+    // only read-only pages hold code which can be decoded once
+    EXPECT_EQ(s.rom_page(0x81FF), rom.data() + 0x300);
+    EXPECT_EQ(s.rom_page(0x0000), nullptr);
+    EXPECT_EQ(s.rom_page(0x4000), nullptr);
+
+    window.set_valid(false);
+    EXPECT_EQ(s.direct_page(0x8000), nullptr);
+    EXPECT_EQ(s.rom_page(0x8000), nullptr);
+}
+
+// the dispatch AddressSpace used before its page tables : a scan of the sorted port list on every access
+struct PortScanSpace : public AddressSpace
+{
+    PortScanSpace(const AddressSpace& space) : AddressSpace(space) {}
+
+    const memory_port* find_port(address addr, const std::vector<memory_port>& port_list) const
+    {
+        auto it = port_list.begin();
+        while (it != port_list.end() && it->base_address <= addr)
+            ++it;
+        if (it == port_list.begin())
+            return nullptr;
+
+        --it;
+        return it->module->valid() && addr < it->base_address + it->module->size() ? &*it : nullptr;
+    }
+
+    data scan_read(address ptr)
+    {
+        const memory_port* port = find_port(ptr, m_read_ports);
+        return port ? m_last_bus_value = port->module->read(ptr - port->base_address) : m_last_bus_value;
+    }
+    void scan_write(address ptr, data value)
+    {
+        m_last_bus_value = value;
+        if (const memory_port* port = find_port(ptr, m_write_ports))
+            port->module->write(ptr - port->base_address, value);
+    }
+};
+
+// M accesses/s of a typical instruction stream : code fetches from PRG-ROM, zero page/stack accesses and mirrored RAM
+template <typename Read, typename Write>
+double nes_map_throughput(Read&& read, Write&& write, unsigned& sum)
+{
+    const std::array<address, 8> read_pattern { 0x8000, 0x0010, 0x01FD, 0xC123, 0x0800, 0xFFFC, 0x1F00, 0x8421 };
+
+    constexpr size_t iterations = 4'000'000;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i { 0 }; i < iterations; ++i)
+    {
+        for (address addr : read_pattern)
+            sum += read(addr + (i & 0xFF));
+        write(0x0200 + (i & 0xFF), sum & 0xFF);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return iterations * (read_pattern.size() + 1) / elapsed.count() / 1e6;
+}
+
+TEST(Memory, NESMapThroughput) {
+    NES::Console nes;
+    nes.init();
+    ASSERT_TRUE(nes.load_cartridge("roms/000/M0_P32K_C8K_V.nes"));
+
+    // the same map, dispatched as it was before the page tables
+    PortScanSpace scan(nes.cpu_space);
+
+    unsigned sum = 0, scan_sum = 0;
+    const double paged = nes_map_throughput([&](address ptr) { return nes.cpu_space.read(ptr); },
+                                            [&](address ptr, data val) { nes.cpu_space.write(ptr, val); }, sum);
+    const double scanned = nes_map_throughput([&](address ptr) { return scan.scan_read(ptr); },
+                                              [&](address ptr, data val) { scan.scan_write(ptr, val); }, scan_sum);
+    EXPECT_EQ(sum, scan_sum);
+
+    std::cout << "[ BENCH    ] NES CPU map : " << paged << " M accesses/s with the page tables, "
+              << scanned << " M accesses/s with the port scan (checksum " << (sum & 0xFF) << ")\n";
+}
+
 }
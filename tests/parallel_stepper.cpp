@@ -25,6 +25,9 @@ SOFTWARE.
 
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <iostream>
+
 #include "common/parallel_stepper.hpp"
 #include "clock.hpp"
 
@@ -51,6 +54,33 @@ struct StepperClockCounter : public DividedClockReceiver<R> {
     unsigned int counter = 0;
 };
 
+// keeps some of its stack alive across the yield, like a cpu in the middle of an instruction
+template<unsigned int R>
+struct StepperStackUser : public DividedClockReceiver<R> {
+    void on_active_clock() override
+    {
+        volatile uint8_t frame[256];
+        frame[counter % sizeof(frame)] = counter;
+        counter++;
+        co_yield();
+        frame[0] = frame[1];
+    };
+    unsigned int counter = 0;
+};
+
+const char* mode_name(StepperStacks::Mode mode)
+{
+    return mode == StepperStacks::Shared ? "shared" : "private";
+}
+
+template <typename Func>
+double seconds_for(Func&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 TEST(ParallelStepper, Clocks)
 {
     StepperClockCounter<1> foo;
@@ -65,4 +95,57 @@ TEST(ParallelStepper, Clocks)
     EXPECT_EQ(bar.counter, 1000);
 }
 
+TEST(ParallelStepper, PrivateStacks)
+{
+    StepperStackUser<1> foo;
+    StepperStackUser<3> bar;
+
+    ParallelStepper stepper{StepperStacks{StepperStacks::Private, 16*1024}, foo, bar};
+
+    for (size_t i { 0 }; i < 3000; ++i)
+        stepper.step();
+    stepper.reset();
+    for (size_t i { 0 }; i < 3000; ++i)
+        stepper.step();
+
+    EXPECT_EQ(foo.counter, 6000);
+    EXPECT_EQ(bar.counter, 2000);
+}
+
+// Not a pass/fail test : prints the cost of a coroutine switch and of stepping through a frame with each stack mode
+TEST(ParallelStepper, StackModesBenchmark)
+{
+    for (auto mode : {StepperStacks::Shared, StepperStacks::Private})
+    {
+        const StepperStacks stacks { mode, default_co_stack_size };
+
+        // every step resumes both coroutines, which yield right back : 4 switches
+        StepperStackUser<1> foo, bar;
+        ParallelStepper switch_stepper{stacks, foo, bar};
+        constexpr size_t switch_steps = 1000000;
+        const double switch_time = seconds_for([&]
+        {
+            for (size_t i { 0 }; i < switch_steps; ++i)
+                switch_stepper.step();
+        });
+        EXPECT_EQ(foo.counter, switch_steps);
+
+        // the console's clocks : a cpu cycle every 12 master clocks, a ppu dot every 4, 29781 cpu cycles per frame
+        StepperStackUser<12> cpu;
+        StepperStackUser<4>  ppu;
+        ParallelStepper frame_stepper{stacks, cpu, ppu};
+        constexpr size_t frames = 60, cpu_cycles_per_frame = 29781;
+        const double frame_time = seconds_for([&]
+        {
+            for (size_t i { 0 }; i < frames*cpu_cycles_per_frame; ++i)
+                frame_stepper.step_whole();
+        });
+        EXPECT_EQ(cpu.counter, frames*cpu_cycles_per_frame);
+        EXPECT_EQ(ppu.counter, 3*frames*cpu_cycles_per_frame);
+
+        std::cout << mode_name(mode) << " stacks : " << switch_time * 1e9 / (4*switch_steps) << " ns per switch, "
+                  << frame_time * 1e6 / frames << " us per frame" << std::endl;
+    }
+}
+
 }
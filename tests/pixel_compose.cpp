@@ -0,0 +1,68 @@
+/*
+pixel_compose.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include <array>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "ppu/include/pixel_compose.hpp"
+
+namespace
+{
+
+TEST(PixelCompose, SimdMatchesScalar)
+{
+    if (!compose_pixels_simd)
+    {
+        GTEST_SKIP() << "SSE4.1 not supported";
+    }
+
+    std::mt19937 rng(0x2C02);
+    std::array<uint8_t, 32> palette;
+    for (auto& color : palette)
+        color = rng() & 0x3F;
+
+    for (size_t run { 0 }; run < 100000; ++run)
+    {
+        std::array<uint8_t, 8> sprites;
+        for (auto& sprite : sprites)
+        {
+            const unsigned pattern = rng() % 4;
+            sprite = pattern ? (0x10 | (rng() % 4)*4 | pattern | (rng() % 4) << 5) : 0;
+        }
+        const pixel_span span { uint16_t(rng()), uint16_t(rng()), sprites.data() };
+        const uint8_t grey_mask = (run % 2) ? 0x30 : 0xFF;
+
+        std::array<uint8_t, 8> scalar_out, simd_out;
+        const uint8_t scalar_hits = compose_pixels_scalar(span, palette.data(), grey_mask, scalar_out.data());
+        const uint8_t simd_hits   = compose_pixels_simd  (span, palette.data(), grey_mask, simd_out.data());
+
+        ASSERT_EQ(scalar_out, simd_out) << run;
+        ASSERT_EQ(scalar_hits, simd_hits) << run;
+    }
+}
+
+}
@@ -48,13 +48,13 @@ const std::string tests[] =
     "cpu_dummy_writes_ppumem.nes",
 };
 
-TEST(Ppu, DummyRWTest)
+TEST_P(Ppu, DummyRWTest)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/dummy_rw/" + test_rom, output))
+        if (!do_blargg_test("roms/dummy_rw/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                           << "'" << output << "'\n"
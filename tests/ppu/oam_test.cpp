@@ -36,13 +36,13 @@ const std::string tests[] =
     //"oam_stress.nes", // really long test
 };
 
-TEST(Ppu, OAMTest)
+TEST_P(Ppu, OAMTest)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/oam_tests/" + test_rom, output))
+        if (!do_blargg_test("roms/oam_tests/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                    << "'" << output << "'\n"
@@ -46,13 +46,13 @@ const std::string tests[] =
     "ppu_open_bus.nes",
 };
 
-TEST(Ppu, OpenBusTest)
+TEST_P(Ppu, OpenBusTest)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/open_bus/" + test_rom, output))
+        if (!do_blargg_test("roms/open_bus/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                    << "'" << output << "'\n"
@@ -37,13 +37,13 @@ const std::string tests[] =
     "ppu_open_bus.nes",
 };
 
-TEST(Ppu, PaletteTest)
+TEST_P(Ppu, PaletteTest)
 {
 //    std::string output;
 //    for (const auto& test_rom : tests)
 //    {
 //  output.clear();
-//        if (!do_blargg_test("roms/open_bus/" + test_rom, output))
+//        if (!do_blargg_test("roms/open_bus/" + test_rom, output, GetParam()))
 //        {
 //            ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
 //                   << "'" << output << "'\n"
@@ -44,13 +44,13 @@ const std::string tests[] =
     "10-timing_order.nes"
 };
 
-TEST(Ppu, Sprite0Test)
+TEST_P(Ppu, Sprite0Test)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/sprite_0_tests/" + test_rom, output))
+        if (!do_blargg_test("roms/sprite_0_tests/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                    << "'" << output << "'\n"
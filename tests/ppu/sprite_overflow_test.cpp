@@ -39,13 +39,13 @@ const std::string tests[] =
     "05-emulator.nes",
 };
 
-TEST(Ppu, SpriteOverflowTest)
+TEST_P(Ppu, SpriteOverflowTest)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/sprite_overflow_tests/" + test_rom, output))
+        if (!do_blargg_test("roms/sprite_overflow_tests/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                    << "'" << output << "'\n"
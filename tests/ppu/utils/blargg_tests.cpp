@@ -37,32 +37,45 @@ SOFTWARE.
 
 StandardController controller_1;
 
-bool do_blargg_test(const std::string& rom_path, std::string& output)
+INSTANTIATE_TEST_SUITE_P(SyncModes, Ppu, ::testing::Values(NES::SyncMode::Lockstep, NES::SyncMode::CatchUp),
+                         [](const ::testing::TestParamInfo<NES::SyncMode>& info)
+                         { return info.param == NES::SyncMode::Lockstep ? "Lockstep" : "CatchUp"; });
+
+bool do_blargg_test(const std::string& rom_path, std::string& output, NES::SyncMode mode)
 {
     global_logger.filter(WARNING);
 
-    NES::init();
-    assert(NES::load_cartridge(rom_path));
-    NES::input.controller_1 = &controller_1;
+    NES::Console nes;
+    nes.init();
+    assert(nes.load_cartridge(rom_path));
+    nes.input.controller_1 = &controller_1;
 
-    NES::power_cycle();
+    nes.power_cycle();
+    nes.set_sync_mode(mode);
 
-    NES::cpu.write(0x6000, 0x80);
+    nes.cpu.write(0x6000, 0x80);
 
-    while(NES::cpu.read(0x6000) == 0x80)
+    // the tests take a few seconds at most
+    constexpr size_t timeout = 60*1789773;
+    while(nes.cpu.read(0x6000) == 0x80 && nes.cpu.cycles < timeout)
     {
-        NES::run_cpu_cycle();
+        nes.run_cpu_cycle();
     }
 
-    if (NES::cpu.read(0x6000) == 0)
+    if (nes.cpu.read(0x6000) == 0)
     {
         return true;
     }
+    else if (nes.cpu.read(0x6000) == 0x80)
+    {
+        output = "timed out";
+        return false;
+    }
     else
     {
         int txt_idx = 0x6004;
         char c;
-        while ((c = (char)NES::cpu.read(txt_idx++)))
+        while (txt_idx < 0x8000 && (c = (char)nes.cpu.read(txt_idx++)))
             output += c;
         return false;
     }
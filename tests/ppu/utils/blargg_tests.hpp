@@ -27,6 +27,14 @@ SOFTWARE.
 
 #include <string>
 
-bool do_blargg_test(const std::string& rom_path, std::string& output);
+#include "gtest/gtest.h"
+
+#include "nes.hpp"
+
+// Runs a test rom until it reports its result at $6000 : false if it failed, with the message it left in output
+bool do_blargg_test(const std::string& rom_path, std::string& output, NES::SyncMode mode = NES::SyncMode::Lockstep);
+
+// the ppu tests run once with each way of scheduling the ppu
+class Ppu : public ::testing::TestWithParam<NES::SyncMode> {};
 
 #endif // BLARGG_TESTS_HPP
@@ -44,13 +44,13 @@ const std::string tests[] =
     "10-even_odd_timing.nes"
 };
 
-TEST(Ppu, VbiTest)
+TEST_P(Ppu, VbiTest)
 {
     std::string output;
     for (const auto& test_rom : tests)
     {
         output.clear();
-        if (!do_blargg_test("roms/vbi_tests/" + test_rom, output))
+        if (!do_blargg_test("roms/vbi_tests/" + test_rom, output, GetParam()))
         {
             ADD_FAILURE() << "Test '" << test_rom << "' failed : \n"
                    << "'" << output << "'\n"
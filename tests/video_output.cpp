@@ -0,0 +1,82 @@
+/*
+video_output.cpp
+
+Copyright (c) 19 Yann BOUCHER (yann)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "gtest/gtest.h"
+
+#include "ppu/include/ppu.hpp"
+#include "ppu/include/video_output.hpp"
+
+namespace
+{
+
+TEST(VideoOutput, Formats)
+{
+    const auto rgba   = make_output_lut(PixelFormat::RGBA8888, PPU::ppu_palette.data());
+    const auto bgra   = make_output_lut(PixelFormat::BGRA8888, PPU::ppu_palette.data());
+    const auto rgb565 = make_output_lut(PixelFormat::RGB565,   PPU::ppu_palette.data());
+    const auto indexed = make_output_lut(PixelFormat::Indexed, PPU::ppu_palette.data());
+
+    for (unsigned index { 0 }; index < 0x40; ++index)
+    {
+        const uint32_t color = PPU::ppu_palette[index];
+        const uint8_t r = color, g = color >> 8, b = color >> 16;
+
+        EXPECT_EQ(rgba[index], color | 0xFF000000);
+        EXPECT_EQ(bgra[index], 0xFF000000 | r << 16 | g << 8 | b);
+        EXPECT_EQ(rgb565[index], uint32_t((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3)));
+        for (unsigned emphasis { 0 }; emphasis < 8; ++emphasis)
+            EXPECT_EQ(indexed[emphasis << 6 | index], index);
+    }
+}
+
+TEST(VideoOutput, Emphasis)
+{
+    const auto lut = make_output_lut(PixelFormat::RGBA8888, PPU::ppu_palette.data());
+    const unsigned white = 0x30;
+    const auto channel = [&](unsigned emphasis, unsigned channel) { return (lut[emphasis << 6 | white] >> channel*8) & 0xFF; };
+
+    for (unsigned c { 0 }; c < 3; ++c)
+    {
+        // an emphasized channel is kept, the others are dimmed
+        EXPECT_EQ(channel(1 << c, c), channel(0, c));
+        EXPECT_LT(channel(1 << ((c + 1) % 3), c), channel(0, c));
+        // all of them are dimmed when all three are emphasized
+        EXPECT_LT(channel(0b111, c), channel(0, c));
+    }
+}
+
+TEST(VideoOutput, ConvertPixels)
+{
+    const auto lut = make_output_lut(PixelFormat::RGB565, PPU::ppu_palette.data());
+    const std::array<uint8_t, 4> indexes { 0x00, 0x0F, 0x21, 0x30 };
+
+    std::array<uint16_t, 5> out {};
+    convert_pixels(PixelFormat::RGB565, &lut[0b010 << 6], indexes.data(), indexes.size(), reinterpret_cast<uint8_t*>(out.data()));
+    for (size_t i { 0 }; i < indexes.size(); ++i)
+        EXPECT_EQ(out[i], lut[0b010 << 6 | indexes[i]]);
+    EXPECT_EQ(out[4], 0); // nothing written past count
+}
+
+}